@@ -0,0 +1,437 @@
+// bench_v2.cpp - microbenchmarks for the backend hot paths
+//
+// Built by `make bench`. state_v2.cpp is compiled into this program
+// (instead of obj/state_v2.o) so its file-local functions can be timed
+// directly, with no poller, persister or HTTP server running.
+//
+// Runs in a fresh temp directory: config defaults, an empty rain state
+// and a synthetic ten-year daily_weather table. Every result is one JSON
+// object per line, so runs can be kept and diffed between releases.
+//
+//   ./bench_v2 [--min-ms N] [--filter text] [--out file] [--keep]
+
+#include "../src/state_v2.cpp"
+
+#include <sys/utsname.h>
+
+using namespace state_v2;
+
+namespace {
+
+// =========================================
+// Harness
+// =========================================
+
+struct Options {
+    int         min_ms = 300;       // minimum measured time per benchmark
+    std::string filter;             // run names containing this only
+    std::string out;                // also append results to this file
+    bool        keep   = false;     // leave the temp directory behind
+};
+
+Options       g_opt;
+std::FILE    *g_out = nullptr;
+
+std::string iso_now()
+{
+    char buf[32];
+    std::time_t now = std::time(nullptr);
+    std::tm tm = {};
+    gmtime_r(&now, &tm);
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
+}
+
+void emit(const json &j)
+{
+    std::string line = j.dump();
+    std::fprintf(stdout, "%s\n", line.c_str());
+    std::fflush(stdout);
+    if (g_out) {
+        std::fprintf(g_out, "%s\n", line.c_str());
+        std::fflush(g_out);
+    }
+}
+
+// Time fn once per iteration until min_ms has passed (at least 10
+// iterations). bytes is the output size of one call, 0 if not relevant.
+template <typename Fn>
+void run(const std::string &name, Fn fn, std::size_t bytes = 0)
+{
+    if (!g_opt.filter.empty() && name.find(g_opt.filter) == std::string::npos)
+        return;
+
+    for (int i = 0; i < 3; i++) fn();       // warm caches and statements
+
+    std::vector<std::uint64_t> ns;
+    ns.reserve(4096);
+    std::uint64_t budget = (std::uint64_t)g_opt.min_ms * 1000000ull;
+    std::uint64_t start  = metrics_v2::now_ns();
+    std::uint64_t total  = 0;
+    while (ns.size() < 10 || (total < budget && ns.size() < 2000000)) {
+        std::uint64_t t0 = metrics_v2::now_ns();
+        fn();
+        std::uint64_t d = metrics_v2::now_ns() - t0;
+        ns.push_back(d);
+        total = metrics_v2::now_ns() - start;
+    }
+
+    std::uint64_t sum = 0;
+    for (std::uint64_t v : ns) sum += v;
+    std::sort(ns.begin(), ns.end());
+    auto pct = [&](double p) { return ns[(std::size_t)(p * (double)(ns.size() - 1))]; };
+
+    json r;
+    r["bench"]   = name;
+    r["iters"]   = ns.size();
+    r["mean_ns"] = (double)sum / (double)ns.size();
+    r["min_ns"]  = ns.front();
+    r["p50_ns"]  = pct(0.50);
+    r["p90_ns"]  = pct(0.90);
+    r["p99_ns"]  = pct(0.99);
+    r["max_ns"]  = ns.back();
+    if (bytes)
+        r["bytes"] = bytes;
+    emit(r);
+}
+
+// =========================================
+// Fixtures
+// =========================================
+
+// Ten years of daily rows ending yesterday, in one transaction. Values
+// follow a seasonal curve with noise; rain falls on ~30% of days and a
+// few early rows have no wind, like databases from before it was logged.
+int seed_history(int days)
+{
+    std::time_t now   = std::time(nullptr);
+    std::time_t today = now - now % 86400;
+
+    sqlite3_exec(g_db, "BEGIN", nullptr, nullptr, nullptr);
+    sqlite3_stmt *stmt = nullptr;
+    sqlite3_prepare_v2(g_db,
+        "INSERT OR REPLACE INTO daily_weather "
+        "(day_ts, temp_high_c, temp_low_c, humidity_high, humidity_low, rain_in,"
+        " wind_mean_m_s, wind_gust_m_s) VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+        -1, &stmt, nullptr);
+
+    unsigned rng = 12345;
+    auto rnd = [&rng]() { rng = rng * 1103515245u + 12345u; return (double)((rng >> 8) & 0xffff) / 65535.0; };
+
+    for (int d = days; d >= 1; d--) {
+        std::time_t ts = today - (std::time_t)d * 86400;
+        double season = std::sin(2.0 * M_PI * (double)(ts / 86400 % 365) / 365.0);
+        double high   = 18.0 + 12.0 * season + 4.0 * rnd();
+        double low    = high - 6.0 - 6.0 * rnd();
+
+        sqlite3_bind_int64 (stmt, 1, (sqlite3_int64)ts);
+        sqlite3_bind_double(stmt, 2, high);
+        sqlite3_bind_double(stmt, 3, low);
+        sqlite3_bind_double(stmt, 4, 70.0 + 30.0 * rnd());
+        sqlite3_bind_double(stmt, 5, 20.0 + 40.0 * rnd());
+        sqlite3_bind_double(stmt, 6, rnd() < 0.3 ? 0.02 + 1.5 * rnd() * rnd() : 0.0);
+        if (d > days - 200) {
+            sqlite3_bind_null(stmt, 7);
+            sqlite3_bind_null(stmt, 8);
+        } else {
+            sqlite3_bind_double(stmt, 7, 1.0 + 3.0 * rnd());
+            sqlite3_bind_double(stmt, 8, 5.0 + 10.0 * rnd());
+        }
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(g_db, "COMMIT", nullptr, nullptr, nullptr);
+
+    g_history_last_day_ts = (long long)(today - 86400);
+    g_history_rev         = (std::uint64_t)days;
+    return days;
+}
+
+// rtl_433 WS90 frames with distinct sensor times and a slowly rising
+// rain counter, pre-parsed like the poller parses them before the lock
+std::vector<json> make_frames(std::size_t n)
+{
+    std::vector<json> frames;
+    frames.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        json j;
+        j["time"]          = "2025-12-08T18:" + std::to_string(10 + i / 60 % 50) +
+                             ":" + std::to_string(10 + i % 50) + "." + std::to_string(i);
+        j["model"]         = "Fineoffset-WS90";
+        j["id"]            = 52127;
+        j["battery_ok"]    = 1;
+        j["battery_mV"]    = 3180;
+        j["temperature_C"] = 4.8 + 0.01 * (double)(i % 100);
+        j["humidity"]      = 82;
+        j["wind_dir_deg"]  = (int)(i * 7 % 360);
+        j["wind_avg_m_s"]  = 1.8;
+        j["wind_max_m_s"]  = 4.4;
+        j["uvi"]           = 0.0;
+        j["light_lux"]     = 2725.0;
+        j["flags"]         = 130;
+        j["rain_mm"]       = 118.9 + 0.1 * (double)(i / 4);
+        j["supercap_V"]    = 5.4;
+        j["firmware"]      = 126;
+        frames.push_back(std::move(j));
+    }
+    return frames;
+}
+
+std::size_t drain(HistoryStream *hs, std::string &body)
+{
+    body.clear();
+    while (history_next(hs, body)) {}
+    history_close(hs);
+    return body.size();
+}
+
+// =========================================
+// Benchmarks
+// =========================================
+
+void bench_ingest()
+{
+    std::vector<json> frames = make_frames(4096);
+    std::size_t i = 0;
+    run("process_ws90_json_locked", [&]() {
+        metrics_v2::TimedLock guard(g_lock);
+        process_ws90_json_locked(frames[i++ % frames.size()]);
+    });
+
+    // A repeated frame: the poller sees this between sensor updates
+    run("process_ws90_json_locked.repeat", [&]() {
+        metrics_v2::TimedLock guard(g_lock);
+        process_ws90_json_locked(frames[0]);
+    });
+
+    run("publish_primary_locked", []() {
+        metrics_v2::TimedLock guard(g_lock);
+        publish_primary_locked();
+    });
+}
+
+void bench_snapshot()
+{
+    std::size_t bytes = build_current_json().dump().size();
+    run("build_current_json", []() {
+        json j = build_current_json();
+        (void)j;
+    }, bytes);
+    run("build_current_json.dump", []() {
+        std::string s = build_current_json().dump();
+        (void)s;
+    }, bytes);
+    run("stations_json", []() {
+        std::string s = stations_json();
+        (void)s;
+    });
+}
+
+void bench_astro()
+{
+    std::time_t now = std::time(nullptr);
+    run("compute_solar_and_moon", [now]() {
+        json j = compute_solar_and_moon(now);
+        (void)j;
+    });
+    run("astro_for_day.cached", [now]() {
+        auto p = astro_for_day(now);
+        (void)p;
+    });
+}
+
+void bench_hourly()
+{
+    // A full hour of rain: one delta per WS90 sample
+    WeatherStateV2 st;
+    init_state_defaults(st);
+    std::time_t now = std::time(nullptr);
+    auto refill = [&st, now]() {
+        st.deltas.clear();
+        for (int s = 0; s < HOURLY_WINDOW_SEC; s += 9)
+            st.deltas.push(now - HOURLY_WINDOW_SEC + s, 0.0004);
+    };
+
+    refill();
+    run("recompute_hourly", [&st, now]() { recompute_hourly(st, now); });
+
+    // Half the window expires in one call, then it is refilled
+    run("recompute_hourly.expire", [&]() {
+        refill();
+        recompute_hourly(st, now + HOURLY_WINDOW_SEC / 2);
+    });
+}
+
+void bench_history()
+{
+    struct Case {
+        const char   *name;
+        unsigned      series;
+        int           days;
+        HistoryFormat format;
+    };
+    const unsigned ALL = HISTORY_TEMP | HISTORY_HUMIDITY | HISTORY_RAIN | HISTORY_WIND;
+    static const Case CASES[] = {
+        { "history_temperature_json.30d",   HISTORY_TEMP,     30,  HISTORY_FORMAT_ROWS },
+        { "history_temperature_json.365d",  HISTORY_TEMP,     365, HISTORY_FORMAT_ROWS },
+        { "history_temperature_json.all",   HISTORY_TEMP,     0,   HISTORY_FORMAT_ROWS },
+        { "history_humidity_json.365d",     HISTORY_HUMIDITY, 365, HISTORY_FORMAT_ROWS },
+        { "history_humidity_json.all",      HISTORY_HUMIDITY, 0,   HISTORY_FORMAT_ROWS },
+        { "history_rain_json.365d",         HISTORY_RAIN,     365, HISTORY_FORMAT_ROWS },
+        { "history_rain_json.all",          HISTORY_RAIN,     0,   HISTORY_FORMAT_ROWS },
+        { "history_json.30d",               ALL,              30,  HISTORY_FORMAT_ROWS },
+        { "history_json.365d",              ALL,              365, HISTORY_FORMAT_ROWS },
+        { "history_json.all",               ALL,              0,   HISTORY_FORMAT_ROWS },
+        { "history_json.all.columnar",      ALL,              0,   HISTORY_FORMAT_COLUMNAR },
+        { "history_json.all.csv",           ALL,              0,   HISTORY_FORMAT_CSV },
+    };
+
+    std::string body;
+    body.reserve(1 << 20);
+    for (const Case &c : CASES) {
+        HistoryQuery q;
+        q.days = c.days;
+        std::size_t bytes = drain(history_open(c.series, q, c.format), body);
+        run(c.name, [&]() {
+            drain(history_open(c.series, q, c.format), body);
+        }, bytes);
+    }
+
+    // One keyset page: the history page's "older" button
+    HistoryQuery page;
+    page.limit     = 100;
+    page.before_ts = g_history_last_day_ts.load() - 1000LL * 86400;
+    std::size_t bytes = drain(history_open(ALL, page), body);
+    run("history_json.page100", [&]() {
+        drain(history_open(ALL, page), body);
+    }, bytes);
+}
+
+// Each payload once per data change: what a cache miss costs
+void bench_compress()
+{
+    struct Case {
+        const char           *name;
+        compress_v2::Encoding enc;
+        bool                  history;
+    };
+    static const Case CASES[] = {
+        { "compress.weather.gzip",     compress_v2::ENC_GZIP,   false },
+        { "compress.weather.br",       compress_v2::ENC_BROTLI, false },
+        { "compress.history_all.gzip", compress_v2::ENC_GZIP,   true },
+        { "compress.history_all.br",   compress_v2::ENC_BROTLI, true },
+    };
+
+    std::string weather = build_current_json().dump();
+    std::string history;
+    drain(history_open(HISTORY_TEMP | HISTORY_HUMIDITY | HISTORY_RAIN | HISTORY_WIND,
+                       HistoryQuery(), HISTORY_FORMAT_ROWS), history);
+
+    std::string out;
+    for (const Case &c : CASES) {
+        const std::string &body = c.history ? history : weather;
+        compress_v2::compress(c.enc, body, out);
+        run(c.name, [&]() { compress_v2::compress(c.enc, body, out); }, out.size());
+    }
+}
+
+bool parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--min-ms" && more)      g_opt.min_ms = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--filter" && more) g_opt.filter = argv[++i];
+        else if (a == "--out" && more)    g_opt.out    = argv[++i];
+        else if (a == "--keep")           g_opt.keep   = true;
+        else {
+            std::fprintf(stderr,
+                "usage: %s [--min-ms N] [--filter text] [--out file] [--keep]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_args(argc, argv))
+        return 2;
+
+    if (!g_opt.out.empty()) {
+        g_out = std::fopen(g_opt.out.c_str(), "a");
+        if (!g_out) {
+            std::fprintf(stderr, "bench: cannot open %s\n", g_opt.out.c_str());
+            return 1;
+        }
+    }
+
+    // The backend uses /state when it exists; a bench must not touch it
+    if (access("/state", F_OK) == 0) {
+        std::fprintf(stderr, "bench: /state exists, refusing to run next to a live backend\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_v2.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        std::perror("bench: temp dir");
+        return 1;
+    }
+
+    // Setup logs go to stderr; results are the only stdout
+    utils::write_file("config.json", "{\"latitude\": 35.0, \"longitude\": -97.0}\n");
+    load_config();
+    init_state_defaults(g_state);
+    init_db();
+    if (!g_db || !g_rdb) {
+        std::fprintf(stderr, "bench: database setup failed in %s\n", dir);
+        return 1;
+    }
+
+    int rows = seed_history(3653);
+
+    // Readers need a published state, as after init()
+    {
+        metrics_v2::TimedLock guard(g_lock);
+        publish_primary_locked();
+    }
+
+    struct utsname un = {};
+    uname(&un);
+    json meta;
+    meta["suite"]      = "backend_v2";
+    meta["time"]       = iso_now();
+    meta["host"]       = un.nodename;
+    meta["machine"]    = un.machine;
+    meta["kernel"]     = un.release;
+    meta["cpus"]       = std::thread::hardware_concurrency();
+    meta["compiler"]   = __VERSION__;
+    meta["sqlite"]     = sqlite3_libversion();
+    meta["min_ms"]     = g_opt.min_ms;
+    meta["history_rows"] = rows;
+    emit(meta);
+
+    bench_ingest();
+    bench_snapshot();
+    bench_astro();
+    bench_hourly();
+    bench_history();
+    bench_compress();
+
+    close_history_reader();
+    sqlite3_close(g_db);
+    g_db = nullptr;
+    if (g_out) std::fclose(g_out);
+
+    if (!g_opt.keep) {
+        const char *files[] = { "weather_history_v2.sqlite3", "weather_history_v2.sqlite3-wal",
+                                "weather_history_v2.sqlite3-shm", "rain_state_v2.json",
+                                "rain_state_v2.bin", "config.json" };
+        for (const char *f : files) unlink(f);
+        if (chdir("/") == 0) rmdir(dir);
+    }
+    return 0;
+}
@@ -0,0 +1,376 @@
+// load_v2.cpp - HTTP concurrency load generator for the backend
+//
+// Built by `make load`. Each connection is one thread running
+// back-to-back GETs on a keep-alive socket for the given time, cycling
+// through the --url list, and reconnecting when the server closes. The
+// result is one JSON object on stdout (and appended to --out): request
+// and error counts, status codes, throughput and latency percentiles.
+//
+//   ./load_v2 --url http://127.0.0.1:8889/api/v2/weather [--url ...]
+//             [--connections N] [--seconds S] [--header "Name: value"]
+//             [--out file]
+//
+// /api/v2/stream never ends and is not a valid target.
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <strings.h>
+
+#include "json.hpp"
+
+using nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Target {
+    std::string host;
+    std::string port = "80";
+    std::string path = "/";
+    std::string url;
+};
+
+struct Options {
+    std::vector<Target>      targets;
+    std::vector<std::string> headers;
+    int         connections = 16;
+    int         seconds     = 10;
+    std::string out;
+};
+
+struct Worker {
+    std::vector<std::uint32_t> latency_us;
+    std::map<int, std::uint64_t> status;
+    std::uint64_t errors      = 0;
+    std::uint64_t connects    = 0;
+    std::uint64_t body_bytes  = 0;
+};
+
+Options g_opt;
+std::atomic<bool> g_stop{false};
+
+// http://host[:port][/path]
+bool parse_url(const char *url, Target &t)
+{
+    if (std::strncmp(url, "http://", 7) != 0)
+        return false;
+    const char *p = url + 7;
+    const char *slash = std::strchr(p, '/');
+    std::string hostport = slash ? std::string(p, slash - p) : std::string(p);
+    if (slash)
+        t.path = slash;
+    size_t colon = hostport.rfind(':');
+    if (colon != std::string::npos) {
+        t.host = hostport.substr(0, colon);
+        t.port = hostport.substr(colon + 1);
+    } else {
+        t.host = hostport;
+    }
+    t.url = url;
+    return !t.host.empty() && !t.port.empty();
+}
+
+int connect_to(const Target &t)
+{
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(t.host.c_str(), t.port.c_str(), &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        timeval tv = {5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+bool send_all(int fd, const std::string &s)
+{
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        off += (size_t)n;
+    }
+    return true;
+}
+
+// Buffered reader over one connection; buf keeps bytes of the next reply
+struct Conn {
+    int         fd = -1;
+    std::string buf;
+
+    bool fill()
+    {
+        char tmp[16384];
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0)
+            return false;
+        buf.append(tmp, (size_t)n);
+        return true;
+    }
+
+    // Up to and including CRLF, without it
+    bool line(std::string &out)
+    {
+        size_t pos;
+        while ((pos = buf.find("\r\n")) == std::string::npos)
+            if (!fill()) return false;
+        out.assign(buf, 0, pos);
+        buf.erase(0, pos + 2);
+        return true;
+    }
+
+    bool skip(size_t n)
+    {
+        while (buf.size() < n)
+            if (!fill()) return false;
+        buf.erase(0, n);
+        return true;
+    }
+};
+
+// Read one response. Returns the status, 0 on a broken connection.
+// Sets keep_alive false when the server is closing.
+int read_response(Conn &c, std::uint64_t &body_bytes, bool &keep_alive)
+{
+    std::string l;
+    if (!c.line(l))
+        return 0;
+    int status = 0;
+    if (std::sscanf(l.c_str(), "HTTP/%*s %d", &status) != 1)
+        return 0;
+    keep_alive = l.compare(0, 8, "HTTP/1.1") == 0;
+
+    long long length = -1;
+    bool chunked = false;
+    for (;;) {
+        if (!c.line(l))
+            return 0;
+        if (l.empty())
+            break;
+        if (strncasecmp(l.c_str(), "Content-Length:", 15) == 0)
+            length = std::atoll(l.c_str() + 15);
+        else if (strncasecmp(l.c_str(), "Transfer-Encoding:", 18) == 0 &&
+                 strcasestr(l.c_str() + 18, "chunked"))
+            chunked = true;
+        else if (strncasecmp(l.c_str(), "Connection:", 11) == 0)
+            keep_alive = !strcasestr(l.c_str() + 11, "close");
+    }
+
+    if (status == 204 || status == 304) {
+        length = 0;
+        chunked = false;
+    }
+
+    if (chunked) {
+        for (;;) {
+            if (!c.line(l))
+                return 0;
+            size_t n = std::strtoul(l.c_str(), nullptr, 16);
+            if (n == 0) {
+                // Trailers, then the empty line
+                do { if (!c.line(l)) return 0; } while (!l.empty());
+                break;
+            }
+            if (!c.skip(n + 2))
+                return 0;
+            body_bytes += n;
+        }
+    } else if (length >= 0) {
+        if (!c.skip((size_t)length))
+            return 0;
+        body_bytes += (std::uint64_t)length;
+    } else {
+        // Body runs to EOF
+        body_bytes += c.buf.size();
+        c.buf.clear();
+        while (c.fill()) { body_bytes += c.buf.size(); c.buf.clear(); }
+        keep_alive = false;
+    }
+    return status;
+}
+
+void worker_main(Worker &w, size_t first)
+{
+    std::vector<std::string> reqs;
+    for (const Target &t : g_opt.targets) {
+        std::string r = "GET " + t.path + " HTTP/1.1\r\nHost: " + t.host + ":" + t.port +
+                        "\r\nUser-Agent: load_v2\r\n";
+        for (const std::string &h : g_opt.headers)
+            r += h + "\r\n";
+        r += "\r\n";
+        reqs.push_back(std::move(r));
+    }
+
+    Conn c;
+    size_t next = first;
+    while (!g_stop.load(std::memory_order_relaxed)) {
+        size_t ti = next++ % g_opt.targets.size();
+        if (c.fd < 0) {
+            c.fd = connect_to(g_opt.targets[ti]);
+            c.buf.clear();
+            if (c.fd < 0) {
+                w.errors++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            w.connects++;
+        }
+
+        Clock::time_point t0 = Clock::now();
+        bool keep_alive = true;
+        int status = send_all(c.fd, reqs[ti]) ? read_response(c, w.body_bytes, keep_alive) : 0;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+
+        if (status == 0) {
+            w.errors++;
+        } else {
+            w.status[status]++;
+            w.latency_us.push_back((std::uint32_t)std::min<long long>(us, 0xffffffffLL));
+        }
+        if (status == 0 || !keep_alive) {
+            close(c.fd);
+            c.fd = -1;
+        }
+    }
+    if (c.fd >= 0)
+        close(c.fd);
+}
+
+bool parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--url" && more) {
+            Target t;
+            if (!parse_url(argv[++i], t)) {
+                std::fprintf(stderr, "load: bad url %s (http://host[:port]/path)\n", argv[i]);
+                return false;
+            }
+            g_opt.targets.push_back(t);
+        } else if (a == "--connections" && more) {
+            g_opt.connections = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--seconds" && more) {
+            g_opt.seconds = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--header" && more) {
+            g_opt.headers.push_back(argv[++i]);
+        } else if (a == "--out" && more) {
+            g_opt.out = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return !g_opt.targets.empty();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_args(argc, argv)) {
+        std::fprintf(stderr,
+            "usage: %s --url http://host:port/path [--url ...] [--connections N]\n"
+            "       [--seconds S] [--header \"Name: value\"] [--out file]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Worker> workers((size_t)g_opt.connections);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < workers.size(); i++)
+        threads.emplace_back(worker_main, std::ref(workers[i]), i);
+
+    std::this_thread::sleep_for(std::chrono::seconds(g_opt.seconds));
+    g_stop = true;
+    for (std::thread &t : threads)
+        t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<std::uint32_t> lat;
+    std::map<int, std::uint64_t> status;
+    std::uint64_t errors = 0, connects = 0, bytes = 0;
+    for (const Worker &w : workers) {
+        lat.insert(lat.end(), w.latency_us.begin(), w.latency_us.end());
+        for (const auto &kv : w.status) status[kv.first] += kv.second;
+        errors   += w.errors;
+        connects += w.connects;
+        bytes    += w.body_bytes;
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) {
+        return lat.empty() ? 0.0 : lat[(size_t)(p * (double)(lat.size() - 1))] / 1000.0;
+    };
+    double sum_us = 0;
+    for (std::uint32_t v : lat) sum_us += v;
+
+    char when[32];
+    std::time_t now = std::time(nullptr);
+    std::tm tm = {};
+    gmtime_r(&now, &tm);
+    std::strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    json r;
+    r["suite"]       = "load_v2";
+    r["time"]        = when;
+    r["urls"]        = json::array();
+    for (const Target &t : g_opt.targets) r["urls"].push_back(t.url);
+    r["connections"] = g_opt.connections;
+    r["seconds"]     = elapsed;
+    r["requests"]    = lat.size();
+    r["errors"]      = errors;
+    r["connects"]    = connects;
+    r["rps"]         = (double)lat.size() / elapsed;
+    r["body_bytes"]  = bytes;
+    json codes = json::object();
+    for (const auto &kv : status) codes[std::to_string(kv.first)] = kv.second;
+    r["status"]      = codes;
+    r["mean_ms"]     = lat.empty() ? 0.0 : sum_us / (double)lat.size() / 1000.0;
+    r["p50_ms"]      = pct(0.50);
+    r["p90_ms"]      = pct(0.90);
+    r["p99_ms"]      = pct(0.99);
+    r["max_ms"]      = lat.empty() ? 0.0 : lat.back() / 1000.0;
+
+    std::string line = r.dump();
+    std::printf("%s\n", line.c_str());
+    if (!g_opt.out.empty()) {
+        std::FILE *f = std::fopen(g_opt.out.c_str(), "a");
+        if (f) {
+            std::fprintf(f, "%s\n", line.c_str());
+            std::fclose(f);
+        }
+    }
+    return (lat.empty() && errors) ? 1 : 0;
+}
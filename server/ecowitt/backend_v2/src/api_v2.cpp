@@ -1,18 +1,30 @@
 #include "api_v2.hpp"
 #include "state_v2.hpp"
+#include "stream_v2.hpp"
+#include "config.hpp"
+#include "astro.hpp"
+#include "samples_v2.hpp"
+#include "summary_v2.hpp"
+#include "metrics_v2.hpp"
+#include "compress_v2.hpp"
 #include <microhttpd.h>
 #include <string>
+#include <memory>
 #include <cstring>
+#include <algorithm>
 #include <cstdlib>   // std::strtol
+#include <ctime>
 #include <strings.h> // strcasecmp
 
 // ----------------- paging helpers -----------------
 
 // Reasonable defaults; tweak if you want
+// (limit default and cap come from config: history_default_limit/_max_limit)
 static constexpr int DEFAULT_DAYS   = 30;    // 0 means "no time filter"
-static constexpr int DEFAULT_LIMIT  = 100;
 static constexpr int DEFAULT_OFFSET = 0;
-static constexpr int MAX_LIMIT      = 365;
+
+// History reply block: below this a reply goes out in one buffer
+static constexpr size_t HISTORY_BLOCK_SIZE = 32 * 1024;
 
 // Parse integer query parameter with clamping (case-sensitive name)
 [[maybe_unused]]
@@ -105,12 +117,53 @@ static int get_query_int_ci(MHD_Connection *conn,
     return static_cast<int>(v);
 }
 
+// Parse a unix timestamp query parameter (64-bit, no clamping)
+static long long get_query_ts_ci(MHD_Connection *conn,
+                                 const char *name,
+                                 long long default_value)
+{
+    const char *val = get_query_value_ci(conn, name);
+    if (!val || !*val)
+        return default_value;
+
+    char *end = nullptr;
+    long long v = std::strtoll(val, &end, 10);
+    return (end == val) ? default_value : v;
+}
+
+// ----------------- request metrics -----------------
+
+// The route being served on this MHD thread, and the body bytes its
+// replies have queued so far; api_v2::route records both when it returns
+static thread_local metrics_v2::Endpoint t_endpoint    = metrics_v2::EP_OTHER;
+static thread_local std::uint64_t        t_reply_bytes = 0;
+
 // ----------------- reply_json -----------------
 
+// Required headers for browsers
+static void add_json_headers(struct MHD_Response *res,
+                             const char *content_type = "application/json")
+{
+    MHD_add_response_header(res, "Content-Type", content_type);
+    MHD_add_response_header(res, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(res, "Access-Control-Allow-Methods", "GET, OPTIONS");
+    MHD_add_response_header(res, "Access-Control-Allow-Headers", "Content-Type, If-None-Match");
+    MHD_add_response_header(res, "Access-Control-Expose-Headers", "ETag, X-Snapshot-Version");
+}
+
+// Validators: clients must revalidate, and get the tag to do it with
+static void add_etag_headers(struct MHD_Response *res, const std::string &etag)
+{
+    if (etag.empty()) return;
+    MHD_add_response_header(res, "ETag", etag.c_str());
+    MHD_add_response_header(res, "Cache-Control", "no-cache");
+}
+
 // Send a JSON response with full CORS headers
 static MHD_Result reply_json(struct MHD_Connection *conn,
                              const std::string &json,
-                             unsigned int status = MHD_HTTP_OK)
+                             unsigned int status = MHD_HTTP_OK,
+                             const std::string &etag = std::string())
 {
     struct MHD_Response *res = MHD_create_response_from_buffer(
         json.size(),
@@ -119,11 +172,9 @@ static MHD_Result reply_json(struct MHD_Connection *conn,
     );
     if (!res) return MHD_NO;
 
-    // Required headers for browsers
-    MHD_add_response_header(res, "Content-Type", "application/json");
-    MHD_add_response_header(res, "Access-Control-Allow-Origin", "*");
-    MHD_add_response_header(res, "Access-Control-Allow-Methods", "GET, OPTIONS");
-    MHD_add_response_header(res, "Access-Control-Allow-Headers", "Content-Type");
+    add_json_headers(res);
+    add_etag_headers(res, etag);
+    t_reply_bytes += json.size();
 
     int q = MHD_queue_response(conn, status, res);
     MHD_destroy_response(res);
@@ -131,17 +182,403 @@ static MHD_Result reply_json(struct MHD_Connection *conn,
     return (q == MHD_YES) ? MHD_YES : MHD_NO;
 }
 
+// ----------------- reply_shared -----------------
+
+// Owner of a body served in place: a snapshot, astro table, summary or
+// cached compressed result
+using BodyRef = std::shared_ptr<const void>;
+
+// MHD calls this once the last connection using the response is done
+static void release_body(void *cls)
+{
+    delete static_cast<BodyRef *>(cls);
+}
+
+// Serve body straight from its buffer (no copy). The response holds a
+// reference to owner so the body outlives any newer publish. enc is
+// the coding body is already in.
+static MHD_Result reply_shared(struct MHD_Connection *conn,
+                               const BodyRef &owner,
+                               const std::string &body,
+                               compress_v2::Encoding enc,
+                               const std::string &etag,
+                               const char *content_type = "application/json",
+                               const char *vary = "Accept-Encoding",
+                               const std::string &version = std::string())
+{
+    BodyRef *hold = new BodyRef(owner);
+
+    struct MHD_Response *res = MHD_create_response_from_buffer_with_free_callback_cls(
+        body.size(),
+        (void *)body.data(),
+        &release_body,
+        hold
+    );
+    if (!res) {
+        delete hold;
+        return MHD_NO;
+    }
+
+    add_json_headers(res, content_type);
+    add_etag_headers(res, etag);
+    if (const char *coding = compress_v2::name(enc)) {
+        MHD_add_response_header(res, "Content-Encoding", coding);
+        metrics_v2::add(metrics_v2::C_COMPRESSED);
+    }
+    MHD_add_response_header(res, "Vary", vary);
+    if (!version.empty())
+        MHD_add_response_header(res, "X-Snapshot-Version", version.c_str());
+    t_reply_bytes += body.size();
+
+    int q = MHD_queue_response(conn, MHD_HTTP_OK, res);
+    MHD_destroy_response(res);
+
+    return (q == MHD_YES) ? MHD_YES : MHD_NO;
+}
+
+// ----------------- reply_history -----------------
+
+// Streamed history body. MHD pulls it block by block; each refill asks
+// state_v2 for the next chunk of rows into the same buffer, so memory
+// stays at one chunk however many days were asked for.
+struct HistoryReply {
+    state_v2::HistoryStream *hs   = nullptr;
+    std::string              buf;
+    size_t                   off  = 0;
+    bool                     more = true;
+    metrics_v2::Endpoint     ep   = metrics_v2::EP_OTHER;   // streamed bytes go here
+};
+
+static ssize_t history_reader(void *cls, uint64_t /*pos*/, char *out, size_t max)
+{
+    HistoryReply *r = static_cast<HistoryReply *>(cls);
+
+    while (r->off >= r->buf.size()) {
+        if (!r->more)
+            return MHD_CONTENT_READER_END_OF_STREAM;
+        r->buf.clear();             // keeps its capacity
+        r->off  = 0;
+        r->more = state_v2::history_next(r->hs, r->buf);
+    }
+
+    size_t n = std::min(max, r->buf.size() - r->off);
+    std::memcpy(out, r->buf.data() + r->off, n);
+    r->off += n;
+    metrics_v2::add_bytes(r->ep, n);
+    return static_cast<ssize_t>(n);
+}
+
+static void history_free(void *cls)
+{
+    HistoryReply *r = static_cast<HistoryReply *>(cls);
+    state_v2::history_close(r->hs);
+    delete r;
+}
+
+static const char *HISTORY_VARY = "Accept, Accept-Encoding";
+
+static const char *history_content_type(state_v2::HistoryFormat format)
+{
+    return format == state_v2::HISTORY_FORMAT_CSV ? "text/csv; charset=utf-8"
+                                                  : "application/json";
+}
+
+// Uncompressed replies that fit in one block (most pages) are served from the
+// buffer they were written into, with a Content-Length; longer ranges
+// switch to the streamed callback. Either way the response owns r.
+static MHD_Result reply_history_stream(struct MHD_Connection *conn,
+                                       unsigned series,
+                                       const state_v2::HistoryQuery &q,
+                                       state_v2::HistoryFormat format,
+                                       const std::string &etag)
+{
+    HistoryReply *r = new HistoryReply;
+    r->hs = state_v2::history_open(series, q, format);
+    r->buf.reserve(HISTORY_BLOCK_SIZE);
+
+    while (r->more && r->buf.size() < HISTORY_BLOCK_SIZE)
+        r->more = state_v2::history_next(r->hs, r->buf);
+
+    struct MHD_Response *res;
+    r->ep = t_endpoint;
+    if (!r->more) {
+        t_reply_bytes += r->buf.size();
+        res = MHD_create_response_from_buffer_with_free_callback_cls(
+            r->buf.size(),
+            (void *)r->buf.data(),
+            &history_free,
+            r
+        );
+    } else {
+        res = MHD_create_response_from_callback(
+            MHD_SIZE_UNKNOWN,
+            HISTORY_BLOCK_SIZE,
+            &history_reader,
+            r,
+            &history_free
+        );
+    }
+    if (!res) {
+        history_free(r);
+        return MHD_NO;
+    }
+
+    add_json_headers(res, history_content_type(format));
+    add_etag_headers(res, etag);
+    MHD_add_response_header(res, "Vary", HISTORY_VARY);
+
+    int ret = MHD_queue_response(conn, MHD_HTTP_OK, res);
+    MHD_destroy_response(res);
+
+    return (ret == MHD_YES) ? MHD_YES : MHD_NO;
+}
+
+// format=rows|columnar|csv, else Accept: text/csv, else rows.
+// Returns false on an unknown format= value.
+static bool get_history_format(struct MHD_Connection *conn,
+                               state_v2::HistoryFormat &format)
+{
+    format = state_v2::HISTORY_FORMAT_ROWS;
+
+    const char *f = get_query_value_ci(conn, "format");
+    if (f && *f) {
+        if      (strcasecmp(f, "rows")     == 0 ||
+                 strcasecmp(f, "json")     == 0) format = state_v2::HISTORY_FORMAT_ROWS;
+        else if (strcasecmp(f, "columnar") == 0) format = state_v2::HISTORY_FORMAT_COLUMNAR;
+        else if (strcasecmp(f, "csv")      == 0) format = state_v2::HISTORY_FORMAT_CSV;
+        else return false;
+        return true;
+    }
+
+    const char *accept = MHD_lookup_connection_value(conn, MHD_HEADER_KIND, "Accept");
+    if (accept && strcasestr(accept, "text/csv"))
+        format = state_v2::HISTORY_FORMAT_CSV;
+    return true;
+}
+
+// ----------------- conditional GET -----------------
+
+// True if the request's If-None-Match list contains etag (or "*").
+// Uses the weak comparison RFC 7232 prescribes for If-None-Match, so a
+// proxy that downgrades our tag to W/"..." still gets 304s.
+static bool etag_matches(struct MHD_Connection *conn, const std::string &etag)
+{
+    const char *inm = MHD_lookup_connection_value(conn,
+                                                  MHD_HEADER_KIND,
+                                                  "If-None-Match");
+    if (!inm || !*inm || etag.empty())
+        return false;
+
+    const char *p = inm;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (!*p) break;
+
+        if (*p == '*') return true;
+        if (std::strncmp(p, "W/", 2) == 0) p += 2;
+
+        const char *start = p;
+        if (*p == '"') {
+            const char *close = std::strchr(p + 1, '"');
+            p = close ? close + 1 : p + std::strlen(p);
+        } else {
+            while (*p && *p != ',') p++;
+        }
+
+        size_t len = static_cast<size_t>(p - start);
+        if (len == etag.size() && std::strncmp(start, etag.data(), len) == 0)
+            return true;
+    }
+    return false;
+}
+
+// 304 with the validator and CORS headers, no body
+static MHD_Result reply_not_modified(struct MHD_Connection *conn,
+                                     const std::string &etag,
+                                     const char *vary = "Accept-Encoding")
+{
+    struct MHD_Response *res = MHD_create_response_from_buffer(
+        0, nullptr, MHD_RESPMEM_PERSISTENT);
+    if (!res) return MHD_NO;
+
+    MHD_add_response_header(res, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(res, "Access-Control-Expose-Headers", "ETag, X-Snapshot-Version");
+    add_etag_headers(res, etag);
+    MHD_add_response_header(res, "Vary", vary);
+
+    int q = MHD_queue_response(conn, MHD_HTTP_NOT_MODIFIED, res);
+    MHD_destroy_response(res);
+
+    return (q == MHD_YES) ? MHD_YES : MHD_NO;
+}
+
+// ----------------- compression -----------------
+
+static compress_v2::Encoding request_encoding(struct MHD_Connection *conn)
+{
+    return compress_v2::negotiate(
+        MHD_lookup_connection_value(conn, MHD_HEADER_KIND, "Accept-Encoding"));
+}
+
+// A published document (snapshot, astro table, summary): 304 if the
+// client has the representation it would get, else that representation,
+// compressed variants coming from the document itself
+static MHD_Result reply_cached(struct MHD_Connection *conn,
+                               const BodyRef &owner,
+                               const std::string &body,
+                               const compress_v2::Variants &variants,
+                               const std::string &etag,
+                               const std::string &version = std::string())
+{
+    compress_v2::Encoding enc = request_encoding(conn);
+    std::string tag = compress_v2::etag_for(etag, enc);
+    if (etag_matches(conn, tag))
+        return reply_not_modified(conn, tag);
+
+    const std::string *out = variants.get(enc, body);
+    if (!out) {     // identity asked for, or compressing failed
+        enc = compress_v2::ENC_IDENTITY;
+        out = &body;
+        tag = etag;
+    }
+    return reply_shared(conn, owner, *out, enc, tag, "application/json",
+                        "Accept-Encoding", version);
+}
+
+// A query result that missed the shared cache: compress raw, cache it
+// under key and serve it. etag is the identity tag. Falls back to raw
+// if compressing fails.
+static MHD_Result reply_result(struct MHD_Connection *conn,
+                               const std::string &key,
+                               compress_v2::Encoding enc,
+                               std::string raw,
+                               const std::string &etag,
+                               const char *content_type,
+                               const char *vary)
+{
+    auto z = std::make_shared<std::string>();
+    if (compress_v2::compress(enc, raw, *z)) {
+        std::shared_ptr<const std::string> body(std::move(z));
+        compress_v2::cache_put(key, body);
+        return reply_shared(conn, body, *body, enc, compress_v2::etag_for(etag, enc),
+                            content_type, vary);
+    }
+    auto body = std::make_shared<const std::string>(std::move(raw));
+    return reply_shared(conn, body, *body, compress_v2::ENC_IDENTITY, etag, content_type, vary);
+}
+
+// Compressed history keeps the whole body, so it is built in one go
+// rather than streamed; keyed by endpoint, query, format and ETag
+static MHD_Result reply_history(struct MHD_Connection *conn,
+                                unsigned series,
+                                const state_v2::HistoryQuery &q,
+                                state_v2::HistoryFormat format,
+                                const std::string &etag,
+                                compress_v2::Encoding enc)
+{
+    if (enc == compress_v2::ENC_IDENTITY)
+        return reply_history_stream(conn, series, q, format, etag);
+
+    std::string key = "h" + std::to_string((int)t_endpoint) +
+                      "|" + std::to_string(series) +
+                      "|" + std::to_string(q.days) +
+                      "|" + std::to_string(q.limit) +
+                      "|" + std::to_string(q.offset) +
+                      "|" + std::to_string(q.after_ts) +
+                      "|" + std::to_string(q.before_ts) +
+                      "|" + std::to_string((int)format) +
+                      "|" + std::to_string((int)enc) + "|" + etag;
+    if (auto z = compress_v2::cache_get(key))
+        return reply_shared(conn, z, *z, enc, compress_v2::etag_for(etag, enc),
+                            history_content_type(format), HISTORY_VARY);
+
+    std::string raw;
+    state_v2::HistoryStream *hs = state_v2::history_open(series, q, format);
+    while (state_v2::history_next(hs, raw)) {}
+    state_v2::history_close(hs);
+
+    return reply_result(conn, key, enc, std::move(raw), etag,
+                        history_content_type(format), HISTORY_VARY);
+}
+
+// ----------------- POST /ws90 (push ingestion) -----------------
+
+// The only write path. Off unless ws90_mode is "push"; when a token is
+// configured the sender must present it in X-WS90-Token.
+static MHD_Result handle_ws90_push(struct MHD_Connection *conn,
+                                   const api_v2::Upload *upload)
+{
+    auto cfg = current_config();
+    if (cfg->ws90_mode != "push") {
+        return reply_json(conn,
+                          "{\"error\":\"push ingestion disabled\"}",
+                          MHD_HTTP_FORBIDDEN);
+    }
+
+    if (!cfg->ws90_push_token.empty()) {
+        const char *tok = MHD_lookup_connection_value(conn,
+                                                      MHD_HEADER_KIND,
+                                                      "X-WS90-Token");
+        if (!tok || cfg->ws90_push_token != tok) {
+            return reply_json(conn,
+                              "{\"error\":\"bad token\"}",
+                              MHD_HTTP_UNAUTHORIZED);
+        }
+    }
+
+    if (!upload || upload->too_large) {
+        return reply_json(conn,
+                          "{\"error\":\"body too large\"}",
+                          MHD_HTTP_CONTENT_TOO_LARGE);
+    }
+
+    if (!state_v2::ingest_ws90_json(upload->body)) {
+        return reply_json(conn,
+                          "{\"error\":\"not a WS90 frame\"}",
+                          MHD_HTTP_BAD_REQUEST);
+    }
+
+    return reply_json(conn, "", MHD_HTTP_NO_CONTENT);
+}
+
+// ----------------- GET /metrics -----------------
+
+static MHD_Result reply_metrics(struct MHD_Connection *conn)
+{
+    std::string body = metrics_v2::render();
+
+    struct MHD_Response *res = MHD_create_response_from_buffer(
+        body.size(),
+        (void *)body.c_str(),
+        MHD_RESPMEM_MUST_COPY
+    );
+    if (!res) return MHD_NO;
+
+    add_json_headers(res, "text/plain; version=0.0.4; charset=utf-8");
+    t_reply_bytes += body.size();
+
+    int q = MHD_queue_response(conn, MHD_HTTP_OK, res);
+    MHD_destroy_response(res);
+
+    return (q == MHD_YES) ? MHD_YES : MHD_NO;
+}
+
 // ----------------- api_v2::route with paging -----------------
 
-int api_v2::route(MHD_Connection *conn,
-                  const char *url,
-                  const char *method)
+static int route_request(MHD_Connection *conn,
+                         const char *url,
+                         const char *method,
+                         const api_v2::Upload *upload)
 {
     // Browser preflight: return empty response with CORS headers only
     if (std::strcmp(method, "OPTIONS") == 0) {
         return reply_json(conn, "", MHD_HTTP_NO_CONTENT);
     }
 
+    if (std::strcmp(method, "POST") == 0 && std::strcmp(url, "/ws90") == 0) {
+        return handle_ws90_push(conn, upload);
+    }
+
     if (std::strcmp(method, "GET") != 0) {
         return reply_json(conn,
                           "{\"error\":\"method not allowed\"}",
@@ -152,10 +589,13 @@ int api_v2::route(MHD_Connection *conn,
     const char *days_raw   = get_query_value_ci(conn, "days");
     const char *limit_raw  = get_query_value_ci(conn, "limit");
     const char *offset_raw = get_query_value_ci(conn, "offset");
+    const char *after_raw  = get_query_value_ci(conn, "after_ts");
+    const char *before_raw = get_query_value_ci(conn, "before_ts");
 
     bool has_days   = (days_raw   && *days_raw);
     bool has_limit  = (limit_raw  && *limit_raw);
     bool has_offset = (offset_raw && *offset_raw);
+    bool has_cursor = (after_raw && *after_raw) || (before_raw && *before_raw);
 
     // Sentinels:
     //  - days=limit=offset = -1  => simple SELECT (no filter, no limit)
@@ -165,40 +605,176 @@ int api_v2::route(MHD_Connection *conn,
     int limit  = -1;
     int offset = -1;
 
-    if (!has_days && !has_limit && !has_offset) {
+    if (!has_days && !has_limit && !has_offset && !has_cursor) {
         // No options at all -> simple SELECT
         days = limit = offset = -1;
 
-    } else if (has_days && !has_limit && !has_offset) {
+    } else if (has_days && !has_limit && !has_offset && !has_cursor) {
         // days only -> time filter only, no limit/offset
         days   = get_query_int_ci(conn, "days", 0, 0, 3650);  // 0 = no time filter
         limit  = -1;
         offset = -1;
 
     } else {
-        // Any limit/offset present -> paged mode
+        // Any limit/offset/cursor present -> paged mode
+        auto cfg = current_config();
         days   = get_query_int_ci(conn, "days",   0,              0, 3650);     // 0 = no time filter
-        limit  = get_query_int_ci(conn, "limit",  DEFAULT_LIMIT,  1, MAX_LIMIT);
+        limit  = get_query_int_ci(conn, "limit",  cfg->history_default_limit,
+                                  1, cfg->history_max_limit);
         offset = get_query_int_ci(conn, "offset", DEFAULT_OFFSET, 0, 1000000);
     }
 
     if (std::strcmp(url, "/api/v2/weather") == 0) {
-        return reply_json(conn, state_v2::current_weather_json());
+        auto snap = state_v2::current_snapshot();
+        if (!snap) {
+            return reply_json(conn,
+                              "{\"error\":\"no snapshot yet\"}",
+                              MHD_HTTP_SERVICE_UNAVAILABLE);
+        }
+        return reply_cached(conn, snap, snap->body, snap->variants, snap->etag,
+                            std::to_string(snap->version));
+
+    } else if (std::strcmp(url, "/metrics") == 0) {
+        return reply_metrics(conn);
+
+    } else if (std::strcmp(url, "/api/v2/stations") == 0) {
+        // Every tracked WS90; small and built on demand
+        return reply_json(conn, state_v2::stations_json(), MHD_HTTP_OK);
+
+    } else if (std::strcmp(url, "/api/v2/stream") == 0) {
+        return stream_v2::open(conn);
+
+    } else if (std::strcmp(url, "/api/v2/astro") == 0) {
+        // Sun/moon table for charts; default is a year from today
+        int n = get_query_int_ci(conn, "days", 365, 1, 366);
+        auto table = astro_table(std::time(nullptr), n);
+        return reply_cached(conn, table, table->body, table->variants, table->etag);
+
+    } else if (std::strcmp(url, "/api/v2/summary") == 0) {
+        // Records, monthly/yearly totals and normals; rebuilt per logged day
+        auto sum = summary_v2::current();
+        if (!sum) {
+            return reply_json(conn,
+                              "{\"error\":\"no summary yet\"}",
+                              MHD_HTTP_SERVICE_UNAVAILABLE);
+        }
+        return reply_cached(conn, sum, sum->body, sum->variants, sum->etag);
+    }
 
-    } else if (std::strcmp(url, "/api/v2/history/temperature") == 0) {
+    if (std::strcmp(url, "/api/v2/history/samples") == 0) {
+        // Raw samples. Defaults: the last 24 h, from rounded to the
+        // minute so the ETag holds still between new rows.
+        // days=N is shorthand for from=now-N days. points=N switches to
+        // rollup buckets, so any span answers in bounded time and size.
+        long long now  = (long long)std::time(nullptr);
+        int       ndays = get_query_int_ci(conn, "days", 1, 1, 36500);
+        long long to   = get_query_ts_ci(conn, "to", now);
+        long long from = get_query_ts_ci(conn, "from", (now - ndays * 86400LL) / 60 * 60);
+        int       n    = get_query_int_ci(conn, "limit", 10000, 1, 50000);
+        int       pts  = get_query_int_ci(conn, "points", 0, 0, 5000);
+        const char *fields = get_query_value_ci(conn, "fields");
+
+        compress_v2::Encoding enc = request_encoding(conn);
+        std::string tag  = samples_v2::etag(from);
+        std::string ztag = compress_v2::etag_for(tag, enc);
+        if (etag_matches(conn, ztag))
+            return reply_not_modified(conn, ztag);
+
+        // A default "to" (now) is left out of the key: while the ETag
+        // holds, clients are told the body has not changed anyway
+        std::string key;
+        if (enc != compress_v2::ENC_IDENTITY) {
+            const char *to_raw = get_query_value_ci(conn, "to");
+            key = "s" + std::to_string(from) +
+                  "|" + (to_raw && *to_raw ? std::to_string(to) : std::string("now")) +
+                  "|" + std::to_string(n) + "|" + std::to_string(pts) +
+                  "|" + std::to_string((int)enc) + "|" + tag +
+                  "|" + (fields ? fields : "");
+            if (auto z = compress_v2::cache_get(key))
+                return reply_shared(conn, z, *z, enc, ztag);
+        }
+
+        std::string body, err;
+        if (!samples_v2::query_json(from, to, fields ? fields : "", n, pts, body, err)) {
+            nlohmann::json e;
+            e["error"] = err;
+            return reply_json(conn, e.dump(), MHD_HTTP_BAD_REQUEST);
+        }
+        if (enc != compress_v2::ENC_IDENTITY)
+            return reply_result(conn, key, enc, std::move(body), tag,
+                                "application/json", "Accept-Encoding");
+        auto plain = std::make_shared<const std::string>(std::move(body));
+        return reply_shared(conn, plain, *plain, compress_v2::ENC_IDENTITY, tag);
+    }
+
+    bool is_history = (std::strncmp(url, "/api/v2/history/", 16) == 0) ||
+                      (std::strcmp(url, "/api/v2/history") == 0);
+    std::string etag = is_history ? state_v2::history_etag() : std::string();
+
+    state_v2::HistoryFormat format = state_v2::HISTORY_FORMAT_ROWS;
+    if (is_history && !get_history_format(conn, format)) {
         return reply_json(conn,
-                          state_v2::history_temperature_json(days, limit, offset));
+                          "{\"error\":\"unknown format\"}",
+                          MHD_HTTP_BAD_REQUEST);
+    }
+    // One tag per representation, since Accept can pick the format
+    if (format == state_v2::HISTORY_FORMAT_COLUMNAR)
+        etag.insert(etag.size() - 1, "-c");
+    else if (format == state_v2::HISTORY_FORMAT_CSV)
+        etag.insert(etag.size() - 1, "-s");
+
+    compress_v2::Encoding enc = is_history ? request_encoding(conn) : compress_v2::ENC_IDENTITY;
+    if (is_history) {
+        std::string tag = compress_v2::etag_for(etag, enc);
+        if (etag_matches(conn, tag))
+            return reply_not_modified(conn, tag, HISTORY_VARY);
+    }
+
+    state_v2::HistoryQuery hq;
+    hq.days      = days;
+    hq.limit     = limit;
+    hq.offset    = offset;
+    hq.after_ts  = get_query_ts_ci(conn, "after_ts",  -1);
+    hq.before_ts = get_query_ts_ci(conn, "before_ts", -1);
+
+    if (std::strcmp(url, "/api/v2/history") == 0) {
+        // Any mix of series from one pass: ?series=temp,humidity,rain,wind
+        const char *series_raw = get_query_value_ci(conn, "series");
+        unsigned series = 0;
+        if (!state_v2::parse_history_series(series_raw ? series_raw : "", series)) {
+            return reply_json(conn,
+                              "{\"error\":\"unknown series\"}",
+                              MHD_HTTP_BAD_REQUEST);
+        }
+        return reply_history(conn, series, hq, format, etag, enc);
+
+    } else if (std::strcmp(url, "/api/v2/history/temperature") == 0) {
+        return reply_history(conn, state_v2::HISTORY_TEMP, hq, format, etag, enc);
 
     } else if (std::strcmp(url, "/api/v2/history/humidity") == 0) {
-        return reply_json(conn,
-                          state_v2::history_humidity_json(days, limit, offset));
+        return reply_history(conn, state_v2::HISTORY_HUMIDITY, hq, format, etag, enc);
 
     } else if (std::strcmp(url, "/api/v2/history/rain") == 0) {
-        return reply_json(conn,
-                          state_v2::history_rain_json(days, limit, offset));
+        return reply_history(conn, state_v2::HISTORY_RAIN, hq, format, etag, enc);
     }
 
     return reply_json(conn,
                       "{\"error\":\"unknown endpoint\"}",
                       MHD_HTTP_NOT_FOUND);
 }
+
+// Every request is timed and its body bytes counted under its endpoint
+int api_v2::route(MHD_Connection *conn,
+                  const char *url,
+                  const char *method,
+                  const Upload *upload)
+{
+    std::uint64_t t0 = metrics_v2::now_ns();
+    t_endpoint    = metrics_v2::endpoint_of(url, method);
+    t_reply_bytes = 0;
+
+    int r = route_request(conn, url, method, upload);
+
+    metrics_v2::request(t_endpoint, metrics_v2::now_ns() - t0, t_reply_bytes);
+    return r;
+}
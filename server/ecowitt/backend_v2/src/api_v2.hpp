@@ -1,6 +1,19 @@
 #pragma once
 #include <microhttpd.h>
+#include <cstddef>
+#include <string>
 
 namespace api_v2 {
-int route(struct MHD_Connection *conn, const char *url, const char *method);
+
+// Largest request body accepted (one rtl_433 frame is well under 1 KB)
+static constexpr size_t MAX_UPLOAD_SIZE = 8192;
+
+// Request body collected by http_server across MHD callbacks
+struct Upload {
+    std::string body;
+    bool        too_large = false;
+};
+
+int route(struct MHD_Connection *conn, const char *url, const char *method,
+          const Upload *upload = nullptr);
 }
@@ -2,43 +2,39 @@
 #include "config.hpp"
 #include "sunset.h"
 #include "lunar.hpp"
+#include "utils.hpp"
 
 #include <ctime>
 #include <cmath>
 #include <string>
+#include <mutex>
 
 using nlohmann::json;
 
+static const int SECONDS_PER_DAY = 86400;
+static const int MAX_TABLE_DAYS  = 366;
+
+static time_t utc_midnight(time_t now)
+{
+    return now - (now % SECONDS_PER_DAY);
+}
+
 // Convert "minutes after UTC midnight" to absolute Unix timestamp
-static time_t utc_minutes_to_ts(time_t now, double mins)
+static time_t utc_minutes_to_ts(time_t midnight_utc, double mins)
 {
-    std::tm gm = {};
-    gmtime_r(&now, &gm);
-    gm.tm_hour = 0;
-    gm.tm_min  = 0;
-    gm.tm_sec  = 0;
-    time_t midnight_utc = timegm(&gm);
     return midnight_utc + (time_t)(mins * 60.0);
 }
 
-json compute_solar_and_moon(time_t now)
+// One UTC day on an already positioned SunSet
+static json compute_day(SunSet &ss, time_t midnight)
 {
     json out;
 
-    // -------------------------------
-    // Config (UTC always)
-    // -------------------------------
-    double lat = g_cfg.latitude;
-    double lon = g_cfg.longitude;
-
     // -------------------------------
     // Sunrise / sunset (UTC)
     // -------------------------------
-    SunSet ss;
-    ss.setPosition(lat, lon, 0);
-
     std::tm gm = {};
-    gmtime_r(&now, &gm);
+    gmtime_r(&midnight, &gm);
     ss.setCurrentDate(gm.tm_year + 1900, gm.tm_mon + 1, gm.tm_mday);
 
     double sr_utc_min  = ss.calcSunriseUTC();
@@ -46,10 +42,10 @@ json compute_solar_and_moon(time_t now)
     double csr_utc_min = ss.calcCivilSunrise();
     double css_utc_min = ss.calcCivilSunset();
 
-    time_t sunrise_ts     = utc_minutes_to_ts(now, sr_utc_min);
-    time_t sunset_ts      = utc_minutes_to_ts(now, ss_utc_min);
-    time_t civil_rise_ts  = utc_minutes_to_ts(now, csr_utc_min);
-    time_t civil_set_ts   = utc_minutes_to_ts(now, css_utc_min);
+    time_t sunrise_ts     = utc_minutes_to_ts(midnight, sr_utc_min);
+    time_t sunset_ts      = utc_minutes_to_ts(midnight, ss_utc_min);
+    time_t civil_rise_ts  = utc_minutes_to_ts(midnight, csr_utc_min);
+    time_t civil_set_ts   = utc_minutes_to_ts(midnight, css_utc_min);
 
     // -------------------------------
     // Moon phase (your real API)
@@ -92,7 +88,7 @@ json compute_solar_and_moon(time_t now)
     moon["visible"]    = ph.visible;
 
     out["gmt_offset"]  = 0;
-    out["midnight_ts"] = utc_minutes_to_ts(now, 0);
+    out["midnight_ts"] = midnight;
     out["time_zone"]   = "UTC";
     out["sun"]         = sun;
     out["moon"]        = moon;
@@ -103,3 +99,102 @@ json compute_solar_and_moon(time_t now)
 
     return out;
 }
+
+json compute_solar_and_moon(time_t now)
+{
+    // -------------------------------
+    // Config (UTC always)
+    // -------------------------------
+    SunSet ss;
+    auto cfg = current_config();
+    ss.setPosition(cfg->latitude, cfg->longitude, 0);
+
+    return compute_day(ss, utc_midnight(now));
+}
+
+// =========================================
+// Per-day cache
+// =========================================
+
+// Everything computed here is a pure function of (UTC day, lat, lon),
+// so both caches are keyed on exactly that.
+struct AstroKey {
+    time_t midnight = 0;
+    double lat      = NAN;
+    double lon      = NAN;
+    int    days     = 0;
+
+    bool operator==(const AstroKey &o) const {
+        return midnight == o.midnight && lat == o.lat && lon == o.lon && days == o.days;
+    }
+};
+
+static std::mutex                         g_astro_mu;    // guards everything below
+static AstroKey                           g_day_key;
+static std::shared_ptr<const json>        g_day;
+static AstroKey                           g_table_key;
+static std::shared_ptr<const AstroTable>  g_table;
+
+static AstroKey current_key(time_t now, int days)
+{
+    auto cfg = current_config();   // one copy: lat and lon from the same file
+    AstroKey k;
+    k.midnight = utc_midnight(now);
+    k.lat      = cfg->latitude;
+    k.lon      = cfg->longitude;
+    k.days     = days;
+    return k;
+}
+
+std::shared_ptr<const json> astro_for_day(time_t now)
+{
+    AstroKey k = current_key(now, 1);
+
+    std::lock_guard<std::mutex> guard(g_astro_mu);
+    if (!g_day || !(g_day_key == k)) {
+        SunSet ss;
+        ss.setPosition(k.lat, k.lon, 0);
+        g_day     = std::make_shared<const json>(compute_day(ss, k.midnight));
+        g_day_key = k;
+    }
+    return g_day;
+}
+
+std::shared_ptr<const AstroTable> astro_table(time_t now, int days)
+{
+    if (days < 1)              days = 1;
+    if (days > MAX_TABLE_DAYS) days = MAX_TABLE_DAYS;
+
+    AstroKey k = current_key(now, days);
+
+    std::lock_guard<std::mutex> guard(g_astro_mu);
+    if (g_table && g_table_key == k)
+        return g_table;
+
+    // One SunSet for the whole batch; only the date changes per row
+    SunSet ss;
+    ss.setPosition(k.lat, k.lon, 0);
+
+    json out;
+    out["start_ts"]  = k.midnight;
+    out["time_zone"] = "UTC";
+    out["days"]      = json::array();
+    for (int i = 0; i < days; ++i)
+        out["days"].push_back(compute_day(ss, k.midnight + (time_t)i * SECONDS_PER_DAY));
+
+    auto t  = std::make_shared<AstroTable>();
+    t->body = out.dump();
+    t->etag = "\"a" + std::to_string((long long)k.midnight) + "-" + std::to_string(days) +
+              "-" + std::to_string(utils::crc32(t->body.data(), t->body.size())) + "\"";
+
+    g_table     = t;
+    g_table_key = k;
+    return g_table;
+}
+
+void astro_invalidate()
+{
+    std::lock_guard<std::mutex> guard(g_astro_mu);
+    g_day.reset();
+    g_table.reset();
+}
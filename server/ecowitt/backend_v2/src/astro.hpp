@@ -2,7 +2,10 @@
 #define ASTRO_HPP
 
 #include <ctime>
+#include <memory>
+#include <string>
 #include "json.hpp"
+#include "compress_v2.hpp"
 
 // The backend exposes one function that produces:
 //   - UTC sunrise/sunset timestamps
@@ -14,4 +17,20 @@
 
 nlohmann::json compute_solar_and_moon(std::time_t now);
 
+// Same fragment, computed once per UTC day and shared. Recomputed when
+// midnight_ts rolls over or config lat/lon differ from the cached key.
+std::shared_ptr<const nlohmann::json> astro_for_day(std::time_t now);
+
+// Pre-serialized /api/v2/astro table: one fragment per UTC day for
+// `days` days (1..366) starting today. Cached until the key changes.
+struct AstroTable {
+    std::string body;
+    std::string etag;
+    compress_v2::Variants variants;
+};
+std::shared_ptr<const AstroTable> astro_table(std::time_t now, int days);
+
+// Drop both caches (config reload)
+void astro_invalidate();
+
 #endif // ASTRO_HPP
@@ -0,0 +1,224 @@
+#include "compress_v2.hpp"
+#include "metrics_v2.hpp"
+
+#include <zlib.h>
+#include <brotli/encode.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <strings.h>
+#include <unordered_map>
+
+namespace compress_v2 {
+
+// zlib's default level (6)
+static const int ZLIB_LEVEL     = Z_DEFAULT_COMPRESSION;
+
+// At 5 brotli runs at about zlib's speed on history bodies and still
+// comes out smaller; the top qualities cost many times the CPU for a
+// few percent more
+static const int BROTLI_QUALITY = 5;
+
+// Compressed query results kept; all ten years of history, every
+// series, is ~250 KB gzipped
+static const size_t CACHE_MAX_BYTES   = 4 * 1024 * 1024;
+static const size_t CACHE_MAX_ENTRIES = 128;
+
+// =========================================
+// Negotiation
+// =========================================
+
+static bool is_sep(char c)
+{
+    return c == ',' || c == ';' || c == ' ' || c == '\t';
+}
+
+Encoding negotiate(const char *h)
+{
+    if (!h)
+        return ENC_IDENTITY;
+
+    double q[ENC_COUNT]    = {};
+    bool   seen[ENC_COUNT] = {};
+    double any = -1;            // "*"
+
+    const char *p = h;
+    while (*p) {
+        while (*p == ',' || *p == ' ' || *p == '\t') p++;
+        const char *tok = p;
+        while (*p && !is_sep(*p)) p++;
+        size_t len = (size_t)(p - tok);
+
+        double qv = 1.0;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                p++;
+                while (*p == ' ' || *p == '\t') p++;
+                if (strncasecmp(p, "q=", 2) == 0)
+                    qv = std::strtod(p + 2, nullptr);
+            }
+            while (*p && *p != ',' && *p != ';') p++;
+        }
+
+        auto is = [&](const char *s) {
+            return len == std::strlen(s) && strncasecmp(tok, s, len) == 0;
+        };
+        int e = -1;
+        if (is("br"))                          e = ENC_BROTLI;
+        else if (is("gzip") || is("x-gzip"))   e = ENC_GZIP;
+        else if (is("deflate"))                e = ENC_DEFLATE;
+        else if (is("*"))                      any = qv;
+
+        if (e >= 0) {
+            q[e]    = qv;
+            seen[e] = true;
+        }
+    }
+
+    Encoding best   = ENC_IDENTITY;
+    double   best_q = 0;
+    for (Encoding e : { ENC_BROTLI, ENC_GZIP, ENC_DEFLATE }) {
+        double v = seen[e] ? q[e] : (any > 0 ? any : 0);
+        if (v > best_q) {
+            best   = e;
+            best_q = v;
+        }
+    }
+    return best;
+}
+
+const char *name(Encoding e)
+{
+    switch (e) {
+    case ENC_GZIP:    return "gzip";
+    case ENC_DEFLATE: return "deflate";
+    case ENC_BROTLI:  return "br";
+    default:          return nullptr;
+    }
+}
+
+std::string etag_for(const std::string &etag, Encoding e)
+{
+    static const char *const SUFFIX[ENC_COUNT] = { "", "-gz", "-df", "-br" };
+    if (e == ENC_IDENTITY || etag.size() < 2)
+        return etag;
+    std::string tag = etag;
+    tag.insert(tag.size() - 1, SUFFIX[e]);
+    return tag;
+}
+
+// =========================================
+// Compression
+// =========================================
+
+// gzip is deflate in a gzip wrapper, HTTP "deflate" in a zlib one
+static bool zlib_compress(const std::string &body, std::string &out, bool gzip)
+{
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, ZLIB_LEVEL, Z_DEFLATED, gzip ? 15 + 16 : 15,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&zs, (uLong)body.size()));
+    zs.next_in   = (Bytef *)body.data();
+    zs.avail_in  = (uInt)body.size();
+    zs.next_out  = (Bytef *)&out[0];
+    zs.avail_out = (uInt)out.size();
+
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+
+static bool brotli_compress(const std::string &body, std::string &out)
+{
+    size_t n = BrotliEncoderMaxCompressedSize(body.size());
+    if (n == 0)
+        return false;
+    out.resize(n);
+    if (!BrotliEncoderCompress(BROTLI_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               body.size(), (const uint8_t *)body.data(),
+                               &n, (uint8_t *)&out[0]))
+        return false;
+    out.resize(n);
+    return true;
+}
+
+bool compress(Encoding e, const std::string &body, std::string &out)
+{
+    std::uint64_t t0 = metrics_v2::now_ns();
+    bool ok = false;
+    switch (e) {
+    case ENC_GZIP:    ok = zlib_compress(body, out, true);  break;
+    case ENC_DEFLATE: ok = zlib_compress(body, out, false); break;
+    case ENC_BROTLI:  ok = brotli_compress(body, out);      break;
+    default:          break;
+    }
+    metrics_v2::observe(metrics_v2::T_COMPRESS, metrics_v2::now_ns() - t0);
+    return ok;
+}
+
+const std::string *Variants::get(Encoding e, const std::string &body) const
+{
+    if (e <= ENC_IDENTITY || e >= ENC_COUNT)
+        return nullptr;
+    std::call_once(once_[e], [&] {
+        ok_[e] = compress(e, body, data_[e]);
+        if (!ok_[e]) data_[e].clear();
+    });
+    return ok_[e] ? &data_[e] : nullptr;
+}
+
+// =========================================
+// Result cache
+// =========================================
+
+struct Entry {
+    std::shared_ptr<const std::string> body;
+    std::list<std::string>::iterator   lru;
+};
+
+static std::mutex                             g_mu;      // guards the block below
+static std::unordered_map<std::string, Entry> g_cache;
+static std::list<std::string>                 g_lru;     // front = most recent
+static size_t                                 g_bytes = 0;
+
+std::shared_ptr<const std::string> cache_get(const std::string &key)
+{
+    std::lock_guard<std::mutex> guard(g_mu);
+    auto it = g_cache.find(key);
+    if (it == g_cache.end())
+        return nullptr;
+    g_lru.splice(g_lru.begin(), g_lru, it->second.lru);
+    return it->second.body;
+}
+
+void cache_put(const std::string &key, std::shared_ptr<const std::string> body)
+{
+    if (!body || body->size() > CACHE_MAX_BYTES / 4)
+        return;
+
+    std::lock_guard<std::mutex> guard(g_mu);
+    auto it = g_cache.find(key);
+    if (it != g_cache.end()) {
+        g_bytes -= it->second.body->size();
+        g_lru.erase(it->second.lru);
+        g_cache.erase(it);
+    }
+
+    g_lru.push_front(key);
+    g_bytes += body->size();
+    g_cache.emplace(key, Entry{ std::move(body), g_lru.begin() });
+
+    while (g_bytes > CACHE_MAX_BYTES || g_cache.size() > CACHE_MAX_ENTRIES) {
+        auto old = g_cache.find(g_lru.back());
+        g_bytes -= old->second.body->size();
+        g_cache.erase(old);
+        g_lru.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+
+// HTTP response compression (Content-Encoding: br, gzip, deflate).
+//
+// Bodies are compressed whole and once. Published documents (weather
+// snapshot, astro table, summary) carry their compressed variants next
+// to the serialized body, built by the first request that asks for
+// each. Query results (history, samples) go in a small shared cache
+// keyed by the query and its ETag. Either way a payload is compressed
+// once per data change, not once per request.
+
+namespace compress_v2 {
+
+enum Encoding { ENC_IDENTITY, ENC_GZIP, ENC_DEFLATE, ENC_BROTLI, ENC_COUNT };
+
+// Best coding an Accept-Encoding header allows. q-values are honored;
+// on a tie br beats gzip beats deflate. ENC_IDENTITY for null/none.
+Encoding negotiate(const char *accept_encoding);
+
+// Content-Encoding token, nullptr for identity
+const char *name(Encoding e);
+
+// Strong ETag of the e-coded representation ("-gz" etc. before the
+// closing quote); etag unchanged for identity or when empty
+std::string etag_for(const std::string &etag, Encoding e);
+
+// Compress body into out. False on failure.
+bool compress(Encoding e, const std::string &body, std::string &out);
+
+// Compressed variants of one immutable body, embedded in the object
+// that owns the body and living as long as it does.
+class Variants {
+public:
+    // The e-coded body, built on first use; nullptr if that failed
+    const std::string *get(Encoding e, const std::string &body) const;
+
+private:
+    mutable std::once_flag once_[ENC_COUNT];
+    mutable std::string    data_[ENC_COUNT];
+    mutable bool           ok_[ENC_COUNT] = {};
+};
+
+// Shared cache of compressed query results. The key must cover all the
+// body depends on, its ETag included, so entries never go stale, they
+// just stop being asked for; the least recently used go first.
+std::shared_ptr<const std::string> cache_get(const std::string &key);
+void cache_put(const std::string &key, std::shared_ptr<const std::string> body);
+
+}
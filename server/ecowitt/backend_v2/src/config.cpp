@@ -1,36 +1,259 @@
 #include "config.hpp"
 #include "json.hpp"
 #include "utils.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 using json = nlohmann::json;
 
-// Global instance
-Config g_cfg;
+// =========================================
+// Loading
+// =========================================
+
+// Swapped with std::atomic_store/load, like the weather snapshot
+static std::shared_ptr<const Config> g_cfg = std::make_shared<const Config>();
+
+std::shared_ptr<const Config> current_config()
+{
+    return std::atomic_load(&g_cfg);
+}
+
+static void publish(const Config &c)
+{
+    std::atomic_store(&g_cfg, std::shared_ptr<const Config>(std::make_shared<const Config>(c)));
+}
+
+// Parse raw into c (which starts out as defaults). Throws on bad JSON.
+static void parse_config(const std::string &raw, Config &c)
+{
+    json j = json::parse(raw);
+
+    c.latitude  = j.value("latitude", 0.0);
+    c.longitude = j.value("longitude", 0.0);
+    c.tz_offset = j.value("tz_offset", 0);
+    c.tz_name   = j.value("tz_name", "UTC");
+
+    c.http_mode                   = j.value("http_mode", "auto");
+    c.http_threads                = j.value("http_threads", 4);
+    c.http_connection_limit       = j.value("http_connection_limit", 128);
+    c.http_per_ip_limit           = j.value("http_per_ip_limit", 0);
+    c.http_connection_timeout_sec = j.value("http_connection_timeout_sec", 30);
+
+    c.state_flush_interval_sec    = j.value("state_flush_interval_sec", 60);
+    c.state_format                = j.value("state_format", "json");
+
+    c.samples_enabled             = j.value("samples_enabled", true);
+    c.samples_flush_interval_sec  = j.value("samples_flush_interval_sec", 60);
+
+    c.ws90_mode                   = j.value("ws90_mode", "poll");
+    c.ws90_url                    = j.value("ws90_url", c.ws90_url);
+    c.ws90_poll_interval_sec      = std::max(1, j.value("ws90_poll_interval_sec", 10));
+    c.ws90_max_body_size          = std::min(1 << 20, std::max(1024, j.value("ws90_max_body_size", 8192)));
+    c.ws90_push_token             = j.value("ws90_push_token", "");
+    c.ws90_station_id             = j.value("ws90_station_id", 0);
+    c.ws90_stations               = j.value("ws90_stations", std::vector<int>{});
+
+    c.rain_event_gap_min          = std::max(1, j.value("rain_event_gap_min", 30));
+
+    c.history_max_limit           = std::max(1, j.value("history_max_limit", 365));
+    c.history_default_limit       = std::min(c.history_max_limit,
+                                             std::max(1, j.value("history_default_limit", 100)));
+    c.loaded = true;
+}
 
 bool load_config(const std::string &path)
 {
     std::string raw;
     if (!utils::read_file(path, raw)) {
         std::cerr << "config.json missing, using defaults\n";
-        g_cfg.loaded = false;
+        publish(Config());
         return false;
     }
 
     try {
-        json j = json::parse(raw);
-
-        g_cfg.latitude  = j.value("latitude", 0.0);
-        g_cfg.longitude = j.value("longitude", 0.0);
-        g_cfg.tz_offset = j.value("tz_offset", 0);
-        g_cfg.tz_name   = j.value("tz_name", "UTC");
-
-        g_cfg.loaded = true;
+        Config c;
+        parse_config(raw, c);
+        publish(c);
         return true;
     }
     catch (...) {
         std::cerr << "config.json invalid, using defaults\n";
-        g_cfg.loaded = false;
+        publish(Config());
+        return false;
+    }
+}
+
+// A restart setting reverts to its running value
+template <typename T>
+static void keep_running(const char *name, const T &running, T &next)
+{
+    if (next != running) {
+        std::cerr << "config reload: " << name << " changed, restart to apply\n";
+        next = running;
+    }
+}
+
+bool reload_config(const std::string &path)
+{
+    std::string raw;
+    Config next;
+    if (!utils::read_file(path, raw)) {
+        std::cerr << "config reload: " << path << " missing, keeping current config\n";
         return false;
     }
+    try {
+        parse_config(raw, next);
+    }
+    catch (...) {
+        std::cerr << "config reload: " << path << " invalid, keeping current config\n";
+        return false;
+    }
+
+    auto cur = current_config();
+    keep_running("http_mode",                   cur->http_mode,                   next.http_mode);
+    keep_running("http_threads",                cur->http_threads,                next.http_threads);
+    keep_running("http_connection_limit",       cur->http_connection_limit,       next.http_connection_limit);
+    keep_running("http_per_ip_limit",           cur->http_per_ip_limit,           next.http_per_ip_limit);
+    keep_running("http_connection_timeout_sec", cur->http_connection_timeout_sec, next.http_connection_timeout_sec);
+    keep_running("samples_enabled",             cur->samples_enabled,             next.samples_enabled);
+    keep_running("ws90_mode",                   cur->ws90_mode,                   next.ws90_mode);
+    keep_running("ws90_station_id",             cur->ws90_station_id,             next.ws90_station_id);
+    keep_running("ws90_stations",               cur->ws90_stations,               next.ws90_stations);
+
+    publish(next);
+    std::cerr << "config reloaded from " << path << "\n";
+    return true;
+}
+
+// =========================================
+// Watcher
+//
+// One thread blocks in poll() on an inotify descriptor for the config
+// file's directory and on a self-pipe. SIGHUP writes to the pipe;
+// stop writes to it after setting g_watch_stop.
+// =========================================
+
+static std::thread       g_watcher;
+static std::atomic<int>  g_wake_fd{-1};         // write end, read by the signal handler
+static int               g_wake_rd = -1;
+static std::atomic<bool> g_watch_stop{false};
+
+// Editors save in several steps (truncate+write, or write temp+rename);
+// reload once the burst has been quiet this long
+static const int SETTLE_MS = 200;
+
+// Drain pending inotify events; true if any names the config file
+static bool drain_events(int fd, const std::string &name)
+{
+    bool hit = false;
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            return hit;
+        for (ssize_t off = 0; off < n; ) {
+            const inotify_event *ev = reinterpret_cast<const inotify_event*>(buf + off);
+            if (ev->len && name == ev->name)
+                hit = true;
+            off += (ssize_t)(sizeof(inotify_event) + ev->len);
+        }
+    }
+}
+
+static void drain_pipe()
+{
+    char b[64];
+    while (read(g_wake_rd, b, sizeof(b)) > 0) {}
+}
+
+static void watch_thread_func(std::string path, std::function<void()> on_reload)
+{
+    std::string dir  = ".";
+    std::string name = path;
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos) {
+        dir  = slash ? path.substr(0, slash) : "/";
+        name = path.substr(slash + 1);
+    }
+
+    int in = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (in >= 0 && inotify_add_watch(in, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(in);
+        in = -1;
+    }
+    if (in < 0)
+        std::cerr << "config: cannot watch " << dir << " (" << std::strerror(errno)
+                  << "), reload on SIGHUP only\n";
+
+    while (!g_watch_stop.load()) {
+        pollfd fds[2] = { { g_wake_rd, POLLIN, 0 }, { in, POLLIN, 0 } };
+        if (poll(fds, in >= 0 ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (g_watch_stop.load())
+            break;
+
+        bool reload = false;
+        if (fds[0].revents & POLLIN) {
+            drain_pipe();
+            reload = true;
+        }
+        if (in >= 0 && (fds[1].revents & POLLIN) && drain_events(in, name)) {
+            reload = true;
+            pollfd q = { in, POLLIN, 0 };
+            while (poll(&q, 1, SETTLE_MS) > 0)
+                drain_events(in, name);
+        }
+
+        if (reload && reload_config(path) && on_reload)
+            on_reload();
+    }
+
+    if (in >= 0)
+        close(in);
+}
+
+void config_watch_start(const std::string &path, std::function<void()> on_reload)
+{
+    int p[2];
+    if (g_watcher.joinable() || pipe2(p, O_NONBLOCK | O_CLOEXEC) != 0)
+        return;
+    g_wake_rd = p[0];
+    g_wake_fd.store(p[1]);
+    g_watch_stop = false;
+    g_watcher = std::thread(watch_thread_func, path, std::move(on_reload));
+}
+
+void config_watch_stop()
+{
+    if (!g_watcher.joinable())
+        return;
+    g_watch_stop = true;
+    config_request_reload();
+    g_watcher.join();
+
+    close(g_wake_fd.exchange(-1));
+    close(g_wake_rd);
+    g_wake_rd = -1;
+}
+
+void config_request_reload()
+{
+    int fd = g_wake_fd.load();
+    if (fd >= 0) {
+        char c = 1;
+        ssize_t r = write(fd, &c, 1);   // full pipe: a wakeup is already pending
+        (void)r;
+    }
 }
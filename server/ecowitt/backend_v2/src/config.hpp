@@ -1,20 +1,74 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
-// Simple global configuration loaded from config.json
+// Configuration loaded from config.json.
+//
+// The live copy is immutable and replaced as a whole on reload, so a
+// caller that takes current_config() once sees one consistent set of
+// values for as long as it holds the pointer. Settings marked
+// "restart" keep their startup values across a reload.
 struct Config {
     double latitude  = 0.0;     // degrees
     double longitude = 0.0;     // degrees
     int    tz_offset = 0;       // hours from UTC, e.g. -6
     std::string tz_name;        // "CST", etc.
+
+    // HTTP server (libmicrohttpd); restart
+    std::string http_mode = "auto";     // "auto", "epoll", "poll", "select"
+    int    http_threads              = 4;    // thread pool size, 1 = single thread
+    int    http_connection_limit     = 128;  // total concurrent connections
+    int    http_per_ip_limit         = 0;    // per client IP, 0 = unlimited
+    int    http_connection_timeout_sec = 30; // idle connection timeout, 0 = none
+
+    // State persistence
+    int    state_flush_interval_sec  = 60;   // max age of unsaved state
+    std::string state_format = "json";      // "json" or "binary" checkpoint
+
+    // Raw sample store (samples table)
+    bool   samples_enabled           = true; // restart
+    int    samples_flush_interval_sec = 60;  // one transaction per interval
+
+    // WS90 ingestion
+    std::string ws90_mode = "poll";         // "poll" GETs ws90, "push" accepts POST /ws90; restart
+    std::string ws90_url  = "http://172.17.0.1:7890";  // ws90_api base URL (poll mode)
+    int    ws90_poll_interval_sec = 10;     // poll period, and snapshot refresh in push mode
+    int    ws90_max_body_size     = 8192;   // longer poll replies are cut (1 KB .. 1 MB)
+    std::string ws90_push_token;            // required X-WS90-Token when non-empty
+    int    ws90_station_id = 0;             // primary WS90 id, 0 = any; restart
+    std::vector<int> ws90_stations;         // more WS90 ids to track (live only); restart
+
+    // Rain
+    int    rain_event_gap_min = 30;         // dry minutes that end a rain event
+
+    // /api/v2/history paging
+    int    history_default_limit = 100;     // rows when limit is not given
+    int    history_max_limit     = 365;     // cap on ?limit=
+
     bool   loaded    = false;
 };
 
-// Global instance
-extern Config g_cfg;
+// The current configuration; defaults until load_config() runs
+std::shared_ptr<const Config> current_config();
 
 // Load configuration from JSON file.
 // Returns true if loaded successfully, false if file missing or invalid.
-// On failure, g_cfg is filled with sane defaults.
+// On failure, the defaults are published.
 bool load_config(const std::string &path = "config.json");
+
+// Re-read the file and swap it in. Restart settings keep their running
+// values (with a warning for each that changed). A missing or invalid
+// file leaves the running configuration in place and returns false.
+bool reload_config(const std::string &path = "config.json");
+
+// Reload whenever the file is rewritten or replaced (inotify on its
+// directory) or config_request_reload() is called, then call on_reload
+// from the watcher thread.
+void config_watch_start(const std::string &path, std::function<void()> on_reload);
+void config_watch_stop();
+
+// Async-signal-safe; for SIGHUP. No-op while no watcher runs.
+void config_request_reload();
@@ -1,8 +1,14 @@
 #include "http_server.hpp"
 #include "api_v2.hpp"
+#include "config.hpp"
+#include "stream_v2.hpp"
 #include <microhttpd.h>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <atomic>
+
+static std::atomic<bool> g_stop{false};   // lock-free, so safe from a signal handler
 
 static MHD_Result handle_request(void *cls,
                                  struct MHD_Connection *conn,
@@ -15,11 +21,29 @@ static MHD_Result handle_request(void *cls,
 {
     (void)cls;
     (void)version;
-    (void)upload_data;
-    (void)upload_data_size;
-    (void)con_cls;
 
-    int r = api_v2::route(conn, url, method);
+    int r;
+
+    if (std::strcmp(method, "POST") == 0) {
+        // MHD delivers the body over several calls: the first only
+        // sets up per-request state, the last has no data left.
+        api_v2::Upload *up = static_cast<api_v2::Upload *>(*con_cls);
+        if (!up) {
+            *con_cls = new api_v2::Upload;
+            return MHD_YES;
+        }
+        if (*upload_data_size != 0) {
+            if (up->body.size() + *upload_data_size > api_v2::MAX_UPLOAD_SIZE)
+                up->too_large = true;   // keep draining, answer 413 at the end
+            else
+                up->body.append(upload_data, *upload_data_size);
+            *upload_data_size = 0;
+            return MHD_YES;
+        }
+        r = api_v2::route(conn, url, method, up);
+    } else {
+        r = api_v2::route(conn, url, method);
+    }
 
     // MHD_queue_response returns MHD_YES or MHD_NO as int
     // api_v2::route just forwards that. Normalize to MHD_Result.
@@ -30,28 +54,111 @@ static MHD_Result handle_request(void *cls,
     }
 }
 
-int http_server::start_server(int port) {
-    struct MHD_Daemon *daemon = MHD_start_daemon(
-        MHD_USE_SELECT_INTERNALLY,
+// Frees the POST body buffer, however the request ended
+static void request_completed(void *cls,
+                              struct MHD_Connection *conn,
+                              void **con_cls,
+                              enum MHD_RequestTerminationCode toe)
+{
+    (void)cls;
+    (void)conn;
+    (void)toe;
+
+    delete static_cast<api_v2::Upload *>(*con_cls);
+    *con_cls = nullptr;
+}
+
+// =========================================
+// Daemon configuration
+// =========================================
+
+// Map config http_mode to the MHD internal-thread polling flag
+static unsigned int polling_flags(const std::string &mode)
+{
+    if (mode == "select")
+        return MHD_USE_SELECT_INTERNALLY;
+    if (mode == "poll")
+        return MHD_USE_POLL_INTERNALLY;
+    if (mode == "epoll") {
+        if (MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES)
+            return MHD_USE_EPOLL_INTERNALLY;
+        std::cerr << "http_mode=epoll not supported by this libmicrohttpd, using auto\n";
+    } else if (mode != "auto") {
+        std::cerr << "unknown http_mode '" << mode << "', using auto\n";
+    }
+    // epoll on Linux, poll/select elsewhere
+    return MHD_USE_AUTO_INTERNAL_THREAD;
+}
+
+static struct MHD_Daemon *start_daemon(int port, unsigned int flags, unsigned int threads)
+{
+    // Suspend/resume is needed by /api/v2/stream
+    flags |= MHD_ALLOW_SUSPEND_RESUME;
+
+    auto cfg = current_config();
+    unsigned int conn_limit = cfg->http_connection_limit > 0
+                              ? (unsigned int)cfg->http_connection_limit : 128u;
+    unsigned int per_ip     = cfg->http_per_ip_limit > 0
+                              ? (unsigned int)cfg->http_per_ip_limit : 0u;
+    unsigned int timeout    = cfg->http_connection_timeout_sec > 0
+                              ? (unsigned int)cfg->http_connection_timeout_sec : 0u;
+
+    return MHD_start_daemon(
+        flags,
         port,
         nullptr,
         nullptr,
         &handle_request,
         nullptr,
+        MHD_OPTION_THREAD_POOL_SIZE,       threads,
+        MHD_OPTION_CONNECTION_LIMIT,       conn_limit,
+        MHD_OPTION_PER_IP_CONNECTION_LIMIT, per_ip,
+        MHD_OPTION_CONNECTION_TIMEOUT,     timeout,
+        MHD_OPTION_NOTIFY_COMPLETED,       &request_completed, nullptr,
         MHD_OPTION_END
     );
+}
+
+int http_server::start_server(int port) {
+    auto cfg = current_config();
+    unsigned int flags   = polling_flags(cfg->http_mode);
+    unsigned int threads = cfg->http_threads > 1 ? (unsigned int)cfg->http_threads : 1u;
+
+    struct MHD_Daemon *daemon = start_daemon(port, flags, threads);
+
+    if (!daemon && (flags != MHD_USE_AUTO_INTERNAL_THREAD || threads > 1)) {
+        // Combination not supported by this build; fall back to the safe default
+        std::cerr << "HTTP server: mode=" << cfg->http_mode << " threads=" << threads
+                  << " failed, retrying single-threaded auto mode" << std::endl;
+        flags   = MHD_USE_AUTO_INTERNAL_THREAD;
+        threads = 1;
+        daemon  = start_daemon(port, flags, threads);
+    }
 
     if (!daemon) {
         std::cerr << "Failed to start HTTP server on port " << port << std::endl;
         return 1;
     }
 
-    std::cout << "HTTP server running on port " << port << std::endl;
+    std::cout << "HTTP server running on port " << port
+              << " (mode=" << cfg->http_mode
+              << ", threads=" << threads
+              << ", max_conn=" << cfg->http_connection_limit
+              << ", timeout=" << cfg->http_connection_timeout_sec << "s"
+              << ", ws90=" << cfg->ws90_mode << ")" << std::endl;
 
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(600));
+    while (!g_stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
 
+    std::cout << "HTTP server stopping" << std::endl;
+
+    // MHD must not be stopped with suspended connections
+    stream_v2::shutdown();
     MHD_stop_daemon(daemon);
     return 0;
 }
+
+void http_server::request_stop() {
+    g_stop.store(true);
+}
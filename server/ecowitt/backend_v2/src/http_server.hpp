@@ -4,5 +4,9 @@
 #include <chrono>
 
 namespace http_server {
+// Runs until request_stop(), then stops the daemon and returns 0.
 int start_server(int port);
+
+// Async-signal-safe; makes start_server() return.
+void request_stop();
 }
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Append-only JSON serializer for large, flat replies.
+//
+// Writes straight into a caller-owned std::string, so a reused buffer
+// stops allocating once it has grown to a chunk's size. No DOM, no
+// per-key allocation. It does not validate structure: callers emit
+// keys inside objects and values where a value belongs.
+//
+// Doubles use the shortest round-trip form (same text nlohmann emits);
+// NaN and infinities are written as null.
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string &out) : out_(out) {}
+
+    void begin_object() { sep(); out_ += '{'; push(); }
+    void end_object()   { pop(); out_ += '}'; }
+    void begin_array()  { sep(); out_ += '['; push(); }
+    void end_array()    { pop(); out_ += ']'; }
+
+    // Object key. k is written as-is: keys here are fixed identifiers.
+    void key(const char *k) {
+        sep();
+        out_ += '"';
+        out_ += k;
+        out_ += "\":";
+        after_key_ = true;
+    }
+
+    void null() { sep(); out_ += "null"; }
+
+    void value(bool b) { sep(); out_ += b ? "true" : "false"; }
+
+    void value(int v) { value(static_cast<long long>(v)); }
+
+    void value(long long v) { sep(); number(out_, v); }
+
+    void value(double v) {
+        if (!std::isfinite(v)) { null(); return; }
+        sep();
+        number(out_, v);
+    }
+
+    void value(const char *s) { value(std::string(s)); }
+
+    void value(const std::string &s) {
+        sep();
+        out_ += '"';
+        for (char c : s) {
+            switch (c) {
+            case '"':  out_ += "\\\""; break;
+            case '\\': out_ += "\\\\"; break;
+            case '\n': out_ += "\\n";  break;
+            case '\r': out_ += "\\r";  break;
+            case '\t': out_ += "\\t";  break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    out_ += "\\u00";
+                    out_ += hex[(c >> 4) & 0xf];
+                    out_ += hex[c & 0xf];
+                } else {
+                    out_ += c;
+                }
+            }
+        }
+        out_ += '"';
+    }
+
+    // key + value in one call
+    template <typename T>
+    void field(const char *k, const T &v) { key(k); value(v); }
+    void field_null(const char *k) { key(k); null(); }
+
+    // Continue a container whose opening was written by an earlier
+    // writer (one chunk of a streamed array): the next value gets a
+    // leading comma when has_items is true.
+    void resume(bool has_items) { push(); first_[depth_ - 1] = !has_items; }
+
+    // Bare number text, also used for CSV and packed arrays
+    static void number(std::string &out, long long v) {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, r.ptr);
+    }
+
+    static void number(std::string &out, double v) {
+        char buf[32];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, r.ptr);
+        // Keep doubles recognizable as such, like nlohmann ("32.0")
+        bool integral = true;
+        for (const char *p = buf; p != r.ptr; ++p)
+            if (*p == '.' || *p == 'e' || *p == 'n' || *p == 'i') { integral = false; break; }
+        if (integral) out += ".0";
+    }
+
+private:
+    static const int MAX_DEPTH = 16;
+
+    void sep() {
+        if (after_key_) { after_key_ = false; return; }
+        if (depth_ > 0) {
+            if (!first_[depth_ - 1]) out_ += ',';
+            first_[depth_ - 1] = false;
+        }
+    }
+    void push() { if (depth_ < MAX_DEPTH) first_[depth_++] = true; }
+    void pop()  { if (depth_ > 0) --depth_; }
+
+    std::string &out_;
+    bool first_[MAX_DEPTH] = {};
+    int  depth_     = 0;
+    bool after_key_ = false;
+};
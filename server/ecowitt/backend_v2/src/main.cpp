@@ -1,13 +1,62 @@
 #include <cstdio>
+#include <csignal>
+#include <cstring>
+#include <string>
 #include "state_v2.hpp"
 #include "http_server.hpp"
+#include "config.hpp"
 
 static const int DEFAULT_PORT = 8889;
 
-int main()
+// SIGTERM (docker stop) / SIGINT: shut down cleanly so state is flushed
+static void on_signal(int sig)
 {
+    (void)sig;
+    http_server::request_stop();
+}
+
+// SIGHUP (docker kill -s HUP): re-read config.json
+static void on_hup(int sig)
+{
+    (void)sig;
+    config_request_reload();
+}
+
+static void print_usage(const char *prog)
+{
+    std::fprintf(stderr,
+        "Usage:\n"
+        "  %s                            run the backend\n"
+        "  %s --backfill <file> [--utc]  add missing history from an rtl_433\n"
+        "                                JSON log (- for stdin) and exit\n",
+        prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *backfill = nullptr;
+    bool utc = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--backfill") == 0 && i + 1 < argc) {
+            backfill = argv[++i];
+        } else if (std::strcmp(argv[i], "--utc") == 0) {
+            utc = true;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Batch mode: no poller, no HTTP server
+    if (backfill)
+        return state_v2::backfill(backfill, utc) ? 0 : 1;
+
     std::puts("ecowitt_backend_v2 starting up");
 
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGINT,  on_signal);
+    std::signal(SIGHUP,  on_hup);
+
     // Initialize state, DB, poller, etc.
     state_v2::init();
 
@@ -15,8 +64,13 @@ int main()
     int port = DEFAULT_PORT;
     if (http_server::start_server(port) != 0) {
         std::fprintf(stderr, "Failed to start HTTP server on port %d\n", port);
+        state_v2::shutdown();
         return 1;
     }
 
-    return 0; // we only get here if server_start returned cleanly
+    // Server stopped on signal: stop the poller and flush state
+    state_v2::shutdown();
+    std::puts("ecowitt_backend_v2 stopped");
+
+    return 0;
 }
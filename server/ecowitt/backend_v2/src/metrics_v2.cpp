@@ -0,0 +1,218 @@
+#include "metrics_v2.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace metrics_v2 {
+
+// =========================================
+// Storage
+// =========================================
+
+// Upper bounds in ns, shared by every histogram: 10 us .. 10 s
+static const std::uint64_t BOUNDS_NS[] = {
+    10000ull, 25000ull, 50000ull, 100000ull, 250000ull, 500000ull,
+    1000000ull, 2500000ull, 5000000ull, 10000000ull, 25000000ull, 50000000ull,
+    100000000ull, 250000000ull, 500000000ull,
+    1000000000ull, 2500000000ull, 5000000000ull, 10000000000ull,
+};
+static constexpr size_t NBOUNDS = sizeof(BOUNDS_NS) / sizeof(BOUNDS_NS[0]);
+
+struct Histogram {
+    std::atomic<std::uint64_t> buckets[NBOUNDS + 1] = {};   // last is +Inf
+    std::atomic<std::uint64_t> sum_ns{0};
+    std::atomic<std::uint64_t> count{0};
+
+    void observe(std::uint64_t ns)
+    {
+        size_t i = 0;
+        while (i < NBOUNDS && ns > BOUNDS_NS[i]) i++;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+static const char *const ENDPOINT_NAMES[EP_COUNT] = {
+    "weather", "stations", "stream", "astro", "summary",
+    "history_samples", "history", "history_temperature",
+    "history_humidity", "history_rain", "ws90_push", "metrics",
+    "other",
+};
+
+struct TimerInfo {
+    const char *name;
+    const char *help;
+};
+
+static const TimerInfo TIMERS[T_COUNT] = {
+    { "ecowitt_state_lock_wait_seconds",   "Time spent waiting for the state lock" },
+    { "ecowitt_state_lock_hold_seconds",   "Time the state lock was held" },
+    { "ecowitt_state_save_seconds",        "Duration of one state checkpoint write" },
+    { "ecowitt_history_step_seconds",      "sqlite3_step time of one daily history query" },
+    { "ecowitt_samples_step_seconds",      "sqlite3_step time of one samples query" },
+    { "ecowitt_ws90_poll_connect_seconds", "TCP connect time of a ws90 poll (0 when reused)" },
+    { "ecowitt_ws90_poll_total_seconds",   "Total time of a ws90 poll" },
+    { "ecowitt_http_compress_seconds",     "Time to compress one response body" },
+};
+
+static const TimerInfo COUNTERS[C_COUNT] = {
+    { "ecowitt_ws90_polls_total",        "ws90 polls that got an HTTP reply" },
+    { "ecowitt_ws90_polls_reused_total", "ws90 polls that reused the connection" },
+    { "ecowitt_ws90_poll_errors_total",  "ws90 polls that failed or were not 200" },
+    { "ecowitt_samples_total",           "Fresh samples applied to the primary station" },
+    { "ecowitt_http_compressed_total",   "Responses sent with a Content-Encoding" },
+};
+
+static Histogram                  g_requests[EP_COUNT];
+static std::atomic<std::uint64_t> g_bytes[EP_COUNT];
+static Histogram                  g_timers[T_COUNT];
+static std::atomic<std::uint64_t> g_counters[C_COUNT];
+static std::atomic<std::int64_t>  g_sample_ts{0};
+
+// =========================================
+// Recording
+// =========================================
+
+Endpoint endpoint_of(const char *url, const char *method)
+{
+    static const struct { const char *url; Endpoint ep; } ROUTES[] = {
+        { "/api/v2/weather",             EP_WEATHER },
+        { "/api/v2/stations",            EP_STATIONS },
+        { "/api/v2/stream",              EP_STREAM },
+        { "/api/v2/astro",               EP_ASTRO },
+        { "/api/v2/summary",             EP_SUMMARY },
+        { "/api/v2/history/samples",     EP_HISTORY_SAMPLES },
+        { "/api/v2/history",             EP_HISTORY },
+        { "/api/v2/history/temperature", EP_HISTORY_TEMPERATURE },
+        { "/api/v2/history/humidity",    EP_HISTORY_HUMIDITY },
+        { "/api/v2/history/rain",        EP_HISTORY_RAIN },
+        { "/metrics",                    EP_METRICS },
+    };
+
+    if (std::strcmp(method, "POST") == 0 && std::strcmp(url, "/ws90") == 0)
+        return EP_WS90_PUSH;
+    for (const auto &r : ROUTES)
+        if (std::strcmp(url, r.url) == 0) return r.ep;
+    return EP_OTHER;
+}
+
+void request(Endpoint ep, std::uint64_t ns, std::uint64_t bytes)
+{
+    g_requests[ep].observe(ns);
+    g_bytes[ep].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void add_bytes(Endpoint ep, std::uint64_t bytes)
+{
+    g_bytes[ep].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void observe(Timer t, std::uint64_t ns)
+{
+    g_timers[t].observe(ns);
+}
+
+void add(Counter c, std::uint64_t n)
+{
+    g_counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+void set_sample_ts(std::time_t ts)
+{
+    g_sample_ts.store((std::int64_t)ts, std::memory_order_relaxed);
+}
+
+// =========================================
+// Exposition
+// =========================================
+
+static void header(std::string &out, const char *name, const char *help, const char *type)
+{
+    out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+    out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+}
+
+static void append_seconds(std::string &out, std::uint64_t ns)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", (double)ns / 1e9);
+    out += buf;
+}
+
+// Buckets are read one by one while writers keep adding, so a scrape
+// can be off by the few observations that landed mid-read; the next
+// scrape catches up. Cumulative counts are made monotonic regardless.
+static void histogram(std::string &out, const char *name,
+                      const std::string &labels, const Histogram &h)
+{
+    std::string pre = labels.empty() ? std::string() : labels + ",";
+    std::uint64_t cum = 0;
+
+    for (size_t i = 0; i <= NBOUNDS; i++) {
+        cum += h.buckets[i].load(std::memory_order_relaxed);
+        out += name; out += "_bucket{"; out += pre; out += "le=\"";
+        if (i < NBOUNDS) append_seconds(out, BOUNDS_NS[i]);
+        else             out += "+Inf";
+        out += "\"} ";
+        out += std::to_string(cum);
+        out += '\n';
+    }
+
+    std::string lb = labels.empty() ? std::string() : "{" + labels + "}";
+    out += name; out += "_sum"; out += lb; out += ' ';
+    append_seconds(out, h.sum_ns.load(std::memory_order_relaxed));
+    out += '\n';
+    out += name; out += "_count"; out += lb; out += ' ';
+    out += std::to_string(cum);
+    out += '\n';
+}
+
+std::string render()
+{
+    std::string out;
+    out.reserve(48 * 1024);
+
+    header(out, "ecowitt_http_request_duration_seconds",
+           "Time to route a request and queue its response", "histogram");
+    for (int ep = 0; ep < EP_COUNT; ep++) {
+        std::string labels = std::string("endpoint=\"") + ENDPOINT_NAMES[ep] + "\"";
+        histogram(out, "ecowitt_http_request_duration_seconds", labels, g_requests[ep]);
+    }
+
+    header(out, "ecowitt_http_response_bytes_total",
+           "Response body bytes served", "counter");
+    for (int ep = 0; ep < EP_COUNT; ep++) {
+        out += "ecowitt_http_response_bytes_total{endpoint=\"";
+        out += ENDPOINT_NAMES[ep];
+        out += "\"} ";
+        out += std::to_string(g_bytes[ep].load(std::memory_order_relaxed));
+        out += '\n';
+    }
+
+    for (int t = 0; t < T_COUNT; t++) {
+        header(out, TIMERS[t].name, TIMERS[t].help, "histogram");
+        histogram(out, TIMERS[t].name, std::string(), g_timers[t]);
+    }
+
+    for (int c = 0; c < C_COUNT; c++) {
+        header(out, COUNTERS[c].name, COUNTERS[c].help, "counter");
+        out += COUNTERS[c].name;
+        out += ' ';
+        out += std::to_string(g_counters[c].load(std::memory_order_relaxed));
+        out += '\n';
+    }
+
+    // NaN until the first sample
+    header(out, "ecowitt_ws90_sample_age_seconds",
+           "Seconds since the newest primary sample was received", "gauge");
+    std::int64_t ts = g_sample_ts.load(std::memory_order_relaxed);
+    out += "ecowitt_ws90_sample_age_seconds ";
+    out += ts ? std::to_string((long long)std::time(nullptr) - ts) : std::string("NaN");
+    out += '\n';
+
+    return out;
+}
+
+}
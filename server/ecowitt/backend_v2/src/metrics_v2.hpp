@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+// Prometheus metrics for /metrics.
+//
+// Every metric is a fixed set of relaxed atomics: a counter is one word,
+// a histogram is one word per bucket plus a count and a sum. Recording
+// is a clock read and a few fetch_adds, never a lock or an allocation,
+// so the hot paths can be timed without moving their own latency.
+// Buckets are fixed at compile time.
+
+namespace metrics_v2 {
+
+// One label value per route in api_v2::route
+enum Endpoint {
+    EP_WEATHER, EP_STATIONS, EP_STREAM, EP_ASTRO, EP_SUMMARY,
+    EP_HISTORY_SAMPLES, EP_HISTORY, EP_HISTORY_TEMPERATURE,
+    EP_HISTORY_HUMIDITY, EP_HISTORY_RAIN, EP_WS90_PUSH, EP_METRICS,
+    EP_OTHER,
+    EP_COUNT
+};
+
+// Duration histograms outside the request path
+enum Timer {
+    T_LOCK_WAIT,        // waiting for g_lock
+    T_LOCK_HOLD,        // holding g_lock
+    T_SAVE_STATE,       // one state checkpoint write
+    T_HISTORY_STEP,     // sqlite3_step total of one daily history query
+    T_SAMPLES_STEP,     // sqlite3_step total of one samples query
+    T_POLL_CONNECT,     // CURLINFO_CONNECT_TIME of a ws90 poll
+    T_POLL_TOTAL,       // CURLINFO_TOTAL_TIME of a ws90 poll
+    T_COMPRESS,         // compressing one response body (once per body and coding)
+    T_COUNT
+};
+
+enum Counter {
+    C_POLLS,            // ws90 polls completed at the HTTP level
+    C_POLLS_REUSED,     // ... that reused the connection
+    C_POLL_ERRORS,      // transport errors and non-200 replies
+    C_SAMPLES,          // fresh samples applied to the primary station
+    C_COMPRESSED,       // responses sent with a Content-Encoding
+    C_COUNT
+};
+
+inline std::uint64_t now_ns()
+{
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Endpoint endpoint_of(const char *url, const char *method);
+
+// One finished route call: its duration and the body bytes it queued
+void request(Endpoint ep, std::uint64_t ns, std::uint64_t bytes);
+
+// Body bytes produced after the route call returned (streamed replies)
+void add_bytes(Endpoint ep, std::uint64_t bytes);
+
+void observe(Timer t, std::uint64_t ns);
+void add(Counter c, std::uint64_t n = 1);
+
+// Receive time of the newest primary sample, for the sample age gauge
+void set_sample_ts(std::time_t ts);
+
+// The whole exposition, Prometheus text format 0.0.4
+std::string render();
+
+// lock_guard for g_lock that records how long it took to get and was held
+class TimedLock {
+public:
+    explicit TimedLock(std::mutex &m) : m_(m)
+    {
+        std::uint64_t t0 = now_ns();
+        m_.lock();
+        held_ = now_ns();
+        observe(T_LOCK_WAIT, held_ - t0);
+    }
+    ~TimedLock()
+    {
+        std::uint64_t t1 = now_ns();
+        m_.unlock();
+        observe(T_LOCK_HOLD, t1 - held_);
+    }
+    TimedLock(const TimedLock &) = delete;
+    TimedLock &operator=(const TimedLock &) = delete;
+
+private:
+    std::mutex   &m_;
+    std::uint64_t held_ = 0;
+};
+
+}
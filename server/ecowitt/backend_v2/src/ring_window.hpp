@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ctime>
+
+// Fixed-capacity, time-ordered rolling window with a running sum.
+//
+// Entries live in an inline ring, so nothing allocates after
+// construction. push() is O(1); expire() is O(1) amortized (each entry
+// is removed at most once). When the ring is full the oldest entry is
+// evicted, which bounds memory even if timestamps stall.
+//
+// V must be default-constructible and support += and -=  (double, or a
+// small struct of accumulators for vector/peak windows).
+
+template <typename V, std::size_t N>
+class RingWindow {
+public:
+    static_assert(N > 0, "RingWindow needs a non-zero capacity");
+
+    struct Entry {
+        std::time_t ts{};
+        V           value{};
+    };
+
+    // Append a sample. Timestamps are expected to be non-decreasing.
+    void push(std::time_t ts, const V &v) {
+        if (count_ == N)
+            pop_front();
+        buf_[(head_ + count_) % N] = Entry{ts, v};
+        ++count_;
+        sum_ += v;
+    }
+
+    // Drop entries with now - ts > window (same rule as the old vector scan)
+    void expire(std::time_t now, std::time_t window) {
+        while (count_ > 0 && now - buf_[head_].ts > window)
+            pop_front();
+    }
+
+    void clear() {
+        head_  = 0;
+        count_ = 0;
+        sum_   = V{};
+    }
+
+    const V &sum() const        { return sum_; }
+    std::size_t size() const    { return count_; }
+    bool empty() const          { return count_ == 0; }
+    static constexpr std::size_t capacity() { return N; }
+
+    // i = 0 is the oldest entry
+    const Entry &at(std::size_t i) const { return buf_[(head_ + i) % N]; }
+    const Entry &front() const           { return buf_[head_]; }
+    const Entry &back() const            { return buf_[(head_ + count_ - 1) % N]; }
+
+    template <typename F>
+    void for_each(F &&f) const {
+        for (std::size_t i = 0; i < count_; ++i)
+            f(at(i));
+    }
+
+private:
+    void pop_front() {
+        sum_ -= buf_[head_].value;
+        head_ = (head_ + 1) % N;
+        if (--count_ == 0)
+            sum_ = V{};     // shed accumulated rounding error
+    }
+
+    std::array<Entry, N> buf_{};
+    std::size_t          head_  = 0;   // index of the oldest entry
+    std::size_t          count_ = 0;
+    V                    sum_{};
+};
@@ -0,0 +1,787 @@
+extern "C" {
+#include <sqlite3.h>
+}
+
+#include "samples_v2.hpp"
+#include "metrics_v2.hpp"
+#include "config.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ctime>
+
+using json = nlohmann::json;
+using samples_v2::Sample;
+
+// =========================================
+// Config constants
+// =========================================
+
+static const size_t MAX_PENDING      = 4096;   // ~11 h at one sample per 10 s
+static const size_t FLUSH_BATCH_ROWS = 256;    // flush early past this
+static const int    BUSY_TIMEOUT_MS  = 5000;
+static const int    MAX_POINTS       = 5000;
+static const double DEG_TO_RAD       = M_PI / 180.0;
+
+// Column table: name on the wire == column name in SQL.
+// Circular fields (angles) roll up as vector sums, not min/max/mean.
+struct FieldDef {
+    const char    *name;
+    double Sample::*member;
+    bool           circular;
+};
+
+static const FieldDef FIELDS[] = {
+    { "temperature_c", &Sample::temperature_c, false },
+    { "humidity",      &Sample::humidity,      false },
+    { "wind_avg_m_s",  &Sample::wind_avg_m_s,  false },
+    { "wind_max_m_s",  &Sample::wind_max_m_s,  false },
+    { "wind_dir_deg",  &Sample::wind_dir_deg,  true  },
+    { "light_lux",     &Sample::light_lux,     false },
+    { "uvi",           &Sample::uvi,           false },
+    { "rain_in",       &Sample::rain_in,       false },
+};
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+// =========================================
+// Rollup tiers
+// =========================================
+//
+// rollup_1m / rollup_1h / rollup_1d hold, per bucket and field,
+// min/max/sum/count (angles: sin/cos sums and count). They are updated
+// in the same transaction as the raw rows they summarize, so a tier
+// never disagrees with samples. 1d buckets start at local midnight,
+// like daily_weather.day_ts.
+
+struct Tier {
+    const char   *name;
+    const char   *table;
+    int           seconds;       // bucket width; 0 = local calendar day
+    int           nominal;       // width used for point-count planning
+    sqlite3_stmt *upsert;        // writer thread only
+};
+
+static Tier TIERS[] = {
+    { "1m", "rollup_1m", 60,   60,    nullptr },
+    { "1h", "rollup_1h", 3600, 3600,  nullptr },
+    { "1d", "rollup_1d", 0,    86400, nullptr },
+};
+static const size_t TIER_COUNT = sizeof(TIERS) / sizeof(TIERS[0]);
+
+struct Acc {
+    double        min = NAN;
+    double        max = NAN;
+    double        sum = 0.0;     // circular: sum of sin
+    double        cos = 0.0;     // circular only
+    std::int64_t  n   = 0;
+};
+
+struct Bucket {
+    std::int64_t ts   = 0;
+    std::int64_t rows = 0;
+    Acc          acc[FIELD_COUNT];
+};
+
+// =========================================
+// Globals
+// =========================================
+
+static std::string   g_db_path;
+static sqlite3      *g_wdb    = nullptr;       // writer thread only
+static sqlite3_stmt *g_insert = nullptr;       // writer thread only
+static std::vector<Sample> g_inserted;         // writer: rows new to the table
+static std::vector<Bucket> g_buckets;          // writer: per-tier scratch
+
+static std::thread             g_writer;
+static std::mutex              g_mu;           // guards g_pending, g_stop
+static std::condition_variable g_cv;
+static std::vector<Sample>     g_pending;
+static bool                    g_stop = false;
+
+static std::atomic<bool>         g_enabled{false};
+static std::atomic<long long>    g_max_ts{0};      // newest committed ts
+static std::atomic<std::uint64_t> g_dropped{0};
+
+// =========================================
+// Writer
+// =========================================
+
+static void exec_sql(sqlite3 *db, const char *sql)
+{
+    char *err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        fprintf(stderr, "samples: %s: %s\n", sql, err ? err : "?");
+        sqlite3_free(err);
+    }
+}
+
+static void bind_or_null(sqlite3_stmt *st, int idx, double v)
+{
+    if (std::isnan(v))
+        sqlite3_bind_null(st, idx);
+    else
+        sqlite3_bind_double(st, idx, v);
+}
+
+static std::int64_t bucket_start(const Tier &t, std::int64_t ts)
+{
+    if (t.seconds > 0)
+        return ts - (ts % t.seconds);
+
+    std::time_t tt = (std::time_t)ts;
+    std::tm lt{};
+    localtime_r(&tt, &lt);
+    lt.tm_hour  = 0;
+    lt.tm_min   = 0;
+    lt.tm_sec   = 0;
+    lt.tm_isdst = -1;
+    return (std::int64_t)mktime(&lt);
+}
+
+static void acc_add(Acc &a, const FieldDef &f, double v)
+{
+    if (std::isnan(v)) return;
+    if (f.circular) {
+        a.sum += std::sin(v * DEG_TO_RAD);
+        a.cos += std::cos(v * DEG_TO_RAD);
+    } else {
+        a.min  = (a.n == 0 || v < a.min) ? v : a.min;
+        a.max  = (a.n == 0 || v > a.max) ? v : a.max;
+        a.sum += v;
+    }
+    a.n++;
+}
+
+// Every tier table has the same shape: bucket, rows, then per field
+// either name_min/_max/_sum/_n or name_sin/_cos/_n.
+static std::string tier_columns(bool with_types)
+{
+    std::string c = with_types ? "bucket INTEGER PRIMARY KEY, rows INTEGER NOT NULL"
+                               : "bucket, rows";
+    const char *real = with_types ? " REAL" : "";
+    const char *sum  = with_types ? " REAL NOT NULL DEFAULT 0" : "";
+    const char *cnt  = with_types ? " INTEGER NOT NULL DEFAULT 0" : "";
+    for (const FieldDef &f : FIELDS) {
+        std::string n = f.name;
+        if (f.circular)
+            c += ", " + n + "_sin" + sum + ", " + n + "_cos" + sum + ", " + n + "_n" + cnt;
+        else
+            c += ", " + n + "_min" + real + ", " + n + "_max" + real +
+                 ", " + n + "_sum" + sum + ", " + n + "_n" + cnt;
+    }
+    return c;
+}
+
+// INSERT a bucket, or merge it into the stored one
+static std::string tier_upsert_sql(const Tier &t)
+{
+    int params = 2;
+    for (const FieldDef &f : FIELDS) params += f.circular ? 3 : 4;
+
+    std::string sql = std::string("INSERT INTO ") + t.table + " (" + tier_columns(false) + ") VALUES (?";
+    for (int i = 1; i < params; ++i) sql += ", ?";
+    sql += ") ON CONFLICT(bucket) DO UPDATE SET rows = rows + excluded.rows";
+
+    for (const FieldDef &f : FIELDS) {
+        std::string n = f.name;
+        if (!f.circular) {
+            // min()/max() of NULL is NULL: fall back to whichever side has a value
+            sql += ", " + n + "_min = coalesce(min(" + n + "_min, excluded." + n + "_min), " +
+                   n + "_min, excluded." + n + "_min)";
+            sql += ", " + n + "_max = coalesce(max(" + n + "_max, excluded." + n + "_max), " +
+                   n + "_max, excluded." + n + "_max)";
+            sql += ", " + n + "_sum = " + n + "_sum + excluded." + n + "_sum";
+        } else {
+            sql += ", " + n + "_sin = " + n + "_sin + excluded." + n + "_sin";
+            sql += ", " + n + "_cos = " + n + "_cos + excluded." + n + "_cos";
+        }
+        sql += ", " + n + "_n = " + n + "_n + excluded." + n + "_n";
+    }
+    return sql;
+}
+
+static bool upsert_bucket(sqlite3_stmt *st, const Bucket &b)
+{
+    sqlite3_reset(st);
+    int i = 1;
+    sqlite3_bind_int64(st, i++, (sqlite3_int64)b.ts);
+    sqlite3_bind_int64(st, i++, (sqlite3_int64)b.rows);
+    for (size_t f = 0; f < FIELD_COUNT; ++f) {
+        const Acc &a = b.acc[f];
+        if (FIELDS[f].circular) {
+            sqlite3_bind_double(st, i++, a.sum);
+            sqlite3_bind_double(st, i++, a.cos);
+        } else {
+            bind_or_null(st, i++, a.n ? a.min : NAN);
+            bind_or_null(st, i++, a.n ? a.max : NAN);
+            sqlite3_bind_double(st, i++, a.sum);
+        }
+        sqlite3_bind_int64(st, i++, (sqlite3_int64)a.n);
+    }
+    bool ok = (sqlite3_step(st) == SQLITE_DONE);
+    sqlite3_reset(st);
+    return ok;
+}
+
+// Fold rows into every tier. Rows are nearly always in ts order, so
+// consecutive rows share a bucket; an out-of-order row just becomes one
+// more upsert into the same bucket.
+static bool rollup_rows(const std::vector<Sample> &rows)
+{
+    for (Tier &t : TIERS) {
+        g_buckets.clear();
+        for (const Sample &s : rows) {
+            std::int64_t b = bucket_start(t, s.ts);
+            if (g_buckets.empty() || g_buckets.back().ts != b) {
+                g_buckets.emplace_back();
+                g_buckets.back().ts = b;
+            }
+            Bucket &bk = g_buckets.back();
+            bk.rows++;
+            for (size_t f = 0; f < FIELD_COUNT; ++f)
+                acc_add(bk.acc[f], FIELDS[f], s.*(FIELDS[f].member));
+        }
+        for (const Bucket &bk : g_buckets) {
+            if (!upsert_bucket(t.upsert, bk)) {
+                fprintf(stderr, "samples: %s upsert failed: %s\n", t.table, sqlite3_errmsg(g_wdb));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Insert the batch and fold its new rows into the tiers, inside the
+// caller's transaction. Returns false on the first failure.
+static bool insert_rows(const std::vector<Sample> &batch, long long &max_ts)
+{
+    g_inserted.clear();
+    for (const Sample &s : batch) {
+        sqlite3_reset(g_insert);
+        sqlite3_bind_int64(g_insert, 1, (sqlite3_int64)s.ts);
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+            bind_or_null(g_insert, (int)i + 2, s.*(FIELDS[i].member));
+
+        if (sqlite3_step(g_insert) != SQLITE_DONE) {
+            fprintf(stderr, "samples: insert failed: %s\n", sqlite3_errmsg(g_wdb));
+            sqlite3_reset(g_insert);
+            return false;
+        }
+        // Only rows new to the table feed the tiers (no double counting)
+        if (sqlite3_changes(g_wdb) == 1)
+            g_inserted.push_back(s);
+        if (s.ts > max_ts) max_ts = s.ts;
+    }
+    sqlite3_reset(g_insert);
+
+    return rollup_rows(g_inserted);
+}
+
+// One transaction for the whole batch. Returns false if nothing committed.
+static bool write_batch(const std::vector<Sample> &batch)
+{
+    if (sqlite3_exec(g_wdb, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "samples: BEGIN failed: %s\n", sqlite3_errmsg(g_wdb));
+        return false;
+    }
+
+    long long max_ts = g_max_ts.load();
+    if (!insert_rows(batch, max_ts)) {
+        sqlite3_exec(g_wdb, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    if (sqlite3_exec(g_wdb, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "samples: COMMIT failed: %s\n", sqlite3_errmsg(g_wdb));
+        sqlite3_exec(g_wdb, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    g_max_ts = max_ts;
+    return true;
+}
+
+static void writer_thread_func()
+{
+    std::vector<Sample> batch;
+    batch.reserve(MAX_PENDING);
+
+    for (;;) {
+        // Re-read each round so a config reload applies from the next flush
+        int interval = current_config()->samples_flush_interval_sec;
+        if (interval <= 0) interval = 60;
+
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lk(g_mu);
+            g_cv.wait_for(lk, std::chrono::seconds(interval), [] {
+                return g_stop || g_pending.size() >= FLUSH_BATCH_ROWS;
+            });
+            // Swap keeps both vectors' capacity: no allocation per flush
+            batch.swap(g_pending);
+            stop = g_stop;
+        }
+
+        if (!batch.empty() && !write_batch(batch)) {
+            // DB busy or failing: put the rows back in front, if they fit
+            std::lock_guard<std::mutex> lk(g_mu);
+            if (batch.size() + g_pending.size() <= MAX_PENDING) {
+                batch.insert(batch.end(), g_pending.begin(), g_pending.end());
+                g_pending.swap(batch);
+            } else {
+                g_dropped += batch.size();
+            }
+        }
+        batch.clear();
+
+        if (stop) break;
+    }
+}
+
+static void finalize_statements()
+{
+    sqlite3_finalize(g_insert);
+    g_insert = nullptr;
+    for (Tier &t : TIERS) {
+        sqlite3_finalize(t.upsert);
+        t.upsert = nullptr;
+    }
+}
+
+// Replay the whole samples table through rollup_rows(), in chunks
+static void rebuild_tiers()
+{
+    fprintf(stderr, "samples: building rollup tiers from existing samples\n");
+
+    std::string sql = "SELECT ts";
+    for (const FieldDef &f : FIELDS) { sql += ", "; sql += f.name; }
+    sql += " FROM samples ORDER BY ts";
+
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(g_wdb, sql.c_str(), -1, &st, nullptr) != SQLITE_OK)
+        return;
+
+    sqlite3_exec(g_wdb, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr);
+    std::vector<Sample> chunk;
+    chunk.reserve(MAX_PENDING);
+    bool ok = true;
+    while (ok && sqlite3_step(st) == SQLITE_ROW) {
+        Sample s;
+        s.ts = (std::int64_t)sqlite3_column_int64(st, 0);
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+            s.*(FIELDS[i].member) = (sqlite3_column_type(st, (int)i + 1) == SQLITE_NULL)
+                                    ? NAN : sqlite3_column_double(st, (int)i + 1);
+        chunk.push_back(s);
+        if (chunk.size() == MAX_PENDING) {
+            ok = rollup_rows(chunk);
+            chunk.clear();
+        }
+    }
+    if (ok && !chunk.empty())
+        ok = rollup_rows(chunk);
+    sqlite3_finalize(st);
+
+    sqlite3_exec(g_wdb, ok ? "COMMIT" : "ROLLBACK", nullptr, nullptr, nullptr);
+}
+
+// Schema, statements and g_max_ts for the writer connection g_wdb
+static bool prepare_writer()
+{
+    // WAL is a property of the database file: readers on other
+    // connections keep reading while the writer commits. NORMAL only
+    // syncs at checkpoints, which is what keeps SD card wear down.
+    exec_sql(g_wdb, "PRAGMA journal_mode=WAL");
+    exec_sql(g_wdb, "PRAGMA synchronous=NORMAL");
+
+    exec_sql(g_wdb,
+        "CREATE TABLE IF NOT EXISTS samples ("
+        "  ts INTEGER PRIMARY KEY,"
+        "  temperature_c REAL,"
+        "  humidity REAL,"
+        "  wind_avg_m_s REAL,"
+        "  wind_max_m_s REAL,"
+        "  wind_dir_deg REAL,"
+        "  light_lux REAL,"
+        "  uvi REAL,"
+        "  rain_in REAL"
+        ")");
+
+    for (Tier &t : TIERS) {
+        std::string ddl = std::string("CREATE TABLE IF NOT EXISTS ") + t.table +
+                          " (" + tier_columns(true) + ")";
+        exec_sql(g_wdb, ddl.c_str());
+    }
+
+    // First run after upgrading: samples exist with no tiers yet
+    bool need_rebuild = false;
+    {
+        sqlite3_stmt *st = nullptr;
+        std::string q = std::string("SELECT (SELECT COUNT(*) FROM (SELECT 1 FROM ") +
+                        TIERS[TIER_COUNT - 1].table + " LIMIT 1)), (SELECT MAX(ts) FROM samples)";
+        if (sqlite3_prepare_v2(g_wdb, q.c_str(), -1, &st, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(st) == SQLITE_ROW)
+                need_rebuild = sqlite3_column_int(st, 0) == 0 &&
+                               sqlite3_column_type(st, 1) != SQLITE_NULL;
+            sqlite3_finalize(st);
+        }
+    }
+
+    std::string sql = "INSERT OR IGNORE INTO samples (ts";
+    for (const FieldDef &f : FIELDS) { sql += ", "; sql += f.name; }
+    sql += ") VALUES (?";
+    for (size_t i = 0; i < FIELD_COUNT; ++i) sql += ", ?";
+    sql += ")";
+
+    bool prepared = (sqlite3_prepare_v2(g_wdb, sql.c_str(), -1, &g_insert, nullptr) == SQLITE_OK);
+    for (Tier &t : TIERS) {
+        std::string up = tier_upsert_sql(t);
+        prepared = prepared &&
+                   sqlite3_prepare_v2(g_wdb, up.c_str(), -1, &t.upsert, nullptr) == SQLITE_OK;
+    }
+    if (!prepared) {
+        fprintf(stderr, "samples: prepare failed: %s\n", sqlite3_errmsg(g_wdb));
+        finalize_statements();
+        return false;
+    }
+
+    g_inserted.reserve(MAX_PENDING);
+    g_buckets.reserve(256);
+
+    if (need_rebuild)
+        rebuild_tiers();
+
+    // ts is the rowid, so MAX() is a single b-tree seek
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(g_wdb, "SELECT MAX(ts) FROM samples", -1, &st, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(st) == SQLITE_ROW)
+            g_max_ts = (long long)sqlite3_column_int64(st, 0);
+        sqlite3_finalize(st);
+    }
+    return true;
+}
+
+// =========================================
+// Public API
+// =========================================
+
+// =========================================
+// Readers
+// =========================================
+
+// Resolve the requested columns against the table; nothing from the
+// query string reaches the SQL text unless it matched here
+static bool parse_fields(const std::string &fields,
+                         std::vector<const FieldDef *> &cols,
+                         std::string &err)
+{
+    size_t pos = 0;
+    while (pos <= fields.size()) {
+        size_t comma = fields.find(',', pos);
+        if (comma == std::string::npos) comma = fields.size();
+        std::string name = fields.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (name.empty()) continue;
+
+        const FieldDef *hit = nullptr;
+        for (const FieldDef &f : FIELDS)
+            if (name == f.name) hit = &f;
+        if (!hit) {
+            err = "unknown field: " + name;
+            return false;
+        }
+        cols.push_back(hit);
+    }
+    if (cols.empty())
+        for (const FieldDef &f : FIELDS) cols.push_back(&f);
+    return true;
+}
+
+// Short-lived read-only connection: WAL readers never wait on the writer
+static sqlite3 *open_reader()
+{
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(g_db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+    return db;
+}
+
+// sqlite3_step, adding its time to step_ns for /metrics
+static int timed_step(sqlite3_stmt *st, std::uint64_t &step_ns)
+{
+    std::uint64_t t0 = metrics_v2::now_ns();
+    int rc = sqlite3_step(st);
+    step_ns += metrics_v2::now_ns() - t0;
+    return rc;
+}
+
+static void query_raw(sqlite3 *db, std::int64_t from, std::int64_t to, int limit,
+                      const std::vector<const FieldDef *> &cols, json &doc,
+                      std::uint64_t &step_ns)
+{
+    std::string sql = "SELECT ts";
+    for (const FieldDef *f : cols) { sql += ", "; sql += f->name; }
+    sql += " FROM samples WHERE ts >= ?1 AND ts <= ?2 ORDER BY ts LIMIT ?3";
+
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK)
+        return;
+
+    sqlite3_bind_int64(st, 1, (sqlite3_int64)from);
+    sqlite3_bind_int64(st, 2, (sqlite3_int64)to);
+    sqlite3_bind_int(st,   3, limit + 1);     // one extra row tells us there is more
+
+    json &rows = doc["samples"];
+    int n = 0;
+    while (timed_step(st, step_ns) == SQLITE_ROW) {
+        long long ts = (long long)sqlite3_column_int64(st, 0);
+        if (n++ == limit) {
+            doc["truncated"] = true;
+            doc["next_from"] = ts;
+            break;
+        }
+
+        json row;
+        row["ts"] = ts;
+        for (size_t i = 0; i < cols.size(); ++i) {
+            if (sqlite3_column_type(st, (int)i + 1) == SQLITE_NULL)
+                row[cols[i]->name] = nullptr;
+            else
+                row[cols[i]->name] = sqlite3_column_double(st, (int)i + 1);
+        }
+        rows.push_back(std::move(row));
+    }
+    sqlite3_finalize(st);
+}
+
+// Coarsest tier that still yields at least `points` buckets over span;
+// nullptr when even 1m is too coarse and raw rows are the answer
+static const Tier *pick_tier(std::int64_t span, int points)
+{
+    for (size_t i = TIER_COUNT; i-- > 0; )
+        if (span / TIERS[i].nominal >= points)
+            return &TIERS[i];
+    return nullptr;
+}
+
+// Buckets of the tier, merged further so at most ~points come back.
+// Cost is bounded by points x (tier ratio) rows, however long the span.
+static void query_tier(sqlite3 *db, const Tier &t,
+                       std::int64_t from, std::int64_t to, int points,
+                       const std::vector<const FieldDef *> &cols, json &doc,
+                       std::uint64_t &step_ns)
+{
+    if (points > MAX_POINTS) points = MAX_POINTS;
+    std::int64_t buckets = (to - from) / t.nominal;
+    std::int64_t k       = (buckets + points - 1) / points;    // tier buckets per point
+    std::int64_t step    = k * t.nominal;
+
+    std::string sql = "SELECT MIN(bucket), SUM(rows)";
+    for (const FieldDef *f : cols) {
+        std::string n = f->name;
+        if (f->circular)
+            sql += ", SUM(" + n + "_sin), SUM(" + n + "_cos), SUM(" + n + "_n)";
+        else
+            sql += ", MIN(" + n + "_min), MAX(" + n + "_max), SUM(" + n + "_sum), SUM(" + n + "_n)";
+    }
+    sql += std::string(" FROM ") + t.table + " WHERE bucket >= ?1 AND bucket <= ?2";
+    // Local-day buckets are not evenly spaced (DST), so only merge when needed
+    sql += (k > 1) ? " GROUP BY (bucket - ?1) / ?3" : " GROUP BY bucket";
+    sql += " ORDER BY 1";
+
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK)
+        return;
+
+    sqlite3_bind_int64(st, 1, (sqlite3_int64)bucket_start(t, from));
+    sqlite3_bind_int64(st, 2, (sqlite3_int64)to);
+    if (k > 1)
+        sqlite3_bind_int64(st, 3, (sqlite3_int64)step);
+
+    doc["tier"] = t.name;
+    doc["step"] = (long long)step;
+
+    auto num = [&](int c) -> json {
+        return sqlite3_column_type(st, c) == SQLITE_NULL ? json(nullptr)
+                                                         : json(sqlite3_column_double(st, c));
+    };
+
+    json &rows = doc["samples"];
+    while (timed_step(st, step_ns) == SQLITE_ROW) {
+        json row;
+        row["ts"]   = (long long)sqlite3_column_int64(st, 0);
+        row["rows"] = (long long)sqlite3_column_int64(st, 1);
+
+        int c = 2;
+        for (const FieldDef *f : cols) {
+            json v;
+            if (f->circular) {
+                double sn = sqlite3_column_double(st, c++);
+                double cs = sqlite3_column_double(st, c++);
+                long long n = (long long)sqlite3_column_int64(st, c++);
+                double deg = std::fmod(std::atan2(sn, cs) / DEG_TO_RAD + 360.0, 360.0);
+                v["mean"]  = n ? json(deg) : json(nullptr);
+                v["count"] = n;
+            } else {
+                v["min"]   = num(c++);
+                v["max"]   = num(c++);
+                double sum = sqlite3_column_double(st, c++);
+                long long n = (long long)sqlite3_column_int64(st, c++);
+                v["mean"]  = n ? json(sum / (double)n) : json(nullptr);
+                v["sum"]   = sum;
+                v["count"] = n;
+            }
+            row[f->name] = std::move(v);
+        }
+        rows.push_back(std::move(row));
+    }
+    sqlite3_finalize(st);
+}
+
+namespace samples_v2 {
+
+bool init(const std::string &db_path)
+{
+    if (!current_config()->samples_enabled)
+        return false;
+
+    g_db_path = db_path;
+
+    if (sqlite3_open(db_path.c_str(), &g_wdb) != SQLITE_OK) {
+        fprintf(stderr, "samples: failed to open DB at %s: %s\n",
+                db_path.c_str(), sqlite3_errmsg(g_wdb));
+        sqlite3_close(g_wdb);
+        g_wdb = nullptr;
+        return false;
+    }
+    sqlite3_busy_timeout(g_wdb, BUSY_TIMEOUT_MS);
+
+    if (!prepare_writer()) {
+        sqlite3_close(g_wdb);
+        g_wdb = nullptr;
+        return false;
+    }
+
+    g_pending.reserve(MAX_PENDING);
+    g_enabled = true;
+    g_writer  = std::thread(writer_thread_func);
+    return true;
+}
+
+void shutdown()
+{
+    if (!g_enabled.exchange(false))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        g_stop = true;
+    }
+    g_cv.notify_all();
+    if (g_writer.joinable()) g_writer.join();
+
+    if (g_dropped.load() > 0)
+        fprintf(stderr, "samples: %llu samples dropped (queue full)\n",
+                (unsigned long long)g_dropped.load());
+
+    finalize_statements();
+    sqlite3_close(g_wdb);
+    g_wdb = nullptr;
+}
+
+bool import_begin(sqlite3 *db)
+{
+    if (!current_config()->samples_enabled || g_enabled.load() || g_wdb)
+        return false;
+
+    g_wdb = db;
+    if (!prepare_writer()) {
+        g_wdb = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool import(const std::vector<Sample> &rows)
+{
+    if (!g_wdb || g_enabled.load())
+        return false;
+
+    long long max_ts = g_max_ts.load();
+    if (!insert_rows(rows, max_ts))
+        return false;
+    g_max_ts = max_ts;
+    return true;
+}
+
+void import_end()
+{
+    if (!g_wdb || g_enabled.load())
+        return;
+    finalize_statements();
+    g_wdb = nullptr;        // the caller's connection: not closed here
+}
+
+void record(const Sample &s)
+{
+    if (!g_enabled.load())
+        return;
+
+    std::lock_guard<std::mutex> lk(g_mu);
+    if (g_pending.size() >= MAX_PENDING) {
+        g_dropped++;
+        return;
+    }
+    g_pending.push_back(s);
+}
+
+std::string etag(std::int64_t from)
+{
+    return "\"s" + std::to_string(g_max_ts.load()) + "-" + std::to_string((long long)from) + "\"";
+}
+
+bool query_json(std::int64_t from, std::int64_t to,
+                const std::string &fields, int limit, int points,
+                std::string &out, std::string &err)
+{
+    std::vector<const FieldDef *> cols;
+    if (!parse_fields(fields, cols, err))
+        return false;
+
+    json doc;
+    doc["from"]    = (long long)from;
+    // Rows past the newest commit don't exist yet; reporting the clamped
+    // bound keeps the body byte-identical for as long as the ETag holds
+    doc["to"]      = std::min((long long)to, g_max_ts.load());
+    doc["fields"]  = json::array();
+    for (const FieldDef *f : cols) doc["fields"].push_back(f->name);
+    doc["samples"] = json::array();
+
+    sqlite3 *db = g_enabled.load() ? open_reader() : nullptr;
+    if (db) {
+        const Tier *tier = (points > 0) ? pick_tier(to - from, points) : nullptr;
+        std::uint64_t step_ns = 0;
+        if (tier)
+            query_tier(db, *tier, from, to, points, cols, doc, step_ns);
+        else
+            query_raw(db, from, to, limit, cols, doc, step_ns);
+        sqlite3_close(db);
+        metrics_v2::observe(metrics_v2::T_SAMPLES_STEP, step_ns);
+    }
+
+    out = doc.dump();
+    return true;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+// Raw sample store: one row per fresh WS90 frame in the `samples` table,
+// next to daily_weather in the same SQLite file.
+//
+// record() only appends to an in-memory queue. A dedicated writer
+// thread drains it in one transaction per flush interval, on its own
+// connection, with the database in WAL mode, so readers on the HTTP
+// threads never wait on an insert and the SD card sees one small
+// write burst per interval instead of one per sample.
+//
+// The same transaction folds new rows into rollup tiers (1 minute,
+// 1 hour, 1 local day) so long-range queries read buckets, not rows.
+
+namespace samples_v2 {
+
+// Unset fields are NAN and stored as NULL
+struct Sample {
+    std::int64_t ts            = 0;     // unix seconds, backend receive time
+    double       temperature_c = 0.0;
+    double       humidity      = 0.0;
+    double       wind_avg_m_s  = 0.0;
+    double       wind_max_m_s  = 0.0;
+    double       wind_dir_deg  = 0.0;
+    double       light_lux     = 0.0;
+    double       uvi           = 0.0;
+    double       rain_in       = 0.0;   // rain since the previous sample
+};
+
+// Open the writer connection, create the table, start the writer.
+// Returns false (and the store stays disabled) if the DB can't be opened.
+bool init(const std::string &db_path);
+
+// Flush the queue and stop the writer
+void shutdown();
+
+// Queue one sample. Never blocks on I/O; safe to call under g_lock.
+void record(const Sample &s);
+
+// Bulk import (--backfill), instead of init(): rows go straight into
+// the samples table and tiers on the caller's connection, inside the
+// caller's transaction. Existing rows win. import_begin() must run
+// outside a transaction (it may set WAL and build missing tiers).
+bool import_begin(sqlite3 *db);
+bool import(const std::vector<Sample> &rows);
+void import_end();
+
+// ETag for /api/v2/history/samples; changes when newer rows commit
+std::string etag(std::int64_t from);
+
+// /api/v2/history/samples body. fields is a comma list of column names
+// (empty = all). points > 0 asks for ~points buckets from the coarsest
+// rollup tier that has at least that many over [from, to]; 0 = raw rows.
+// Returns false with err set on a bad field name.
+bool query_json(std::int64_t from, std::int64_t to,
+                const std::string &fields, int limit, int points,
+                std::string &out, std::string &err);
+
+}
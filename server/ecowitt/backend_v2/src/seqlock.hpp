@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock around a small trivially copyable value.
+//
+// store() never waits. load() never blocks the writer: it copies the
+// value and retries if a store ran meanwhile (the sequence was odd, or
+// changed under it). The payload is kept as relaxed atomic words so a
+// torn copy is a retry, not a data race.
+//
+// Stores must be serialized by the caller (here: under g_lock).
+
+template <typename T>
+class SeqLock {
+public:
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock needs a trivially copyable payload");
+
+    SeqLock() { store(T{}); }
+
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    void store(const T &v) {
+        std::uint64_t buf[WORDS] = {};
+        std::memcpy(buf, &v, sizeof(T));
+
+        unsigned s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WORDS; i++)
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        std::uint64_t buf[WORDS];
+        unsigned s0, s1;
+        do {
+            s0 = seq_.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < WORDS; i++)
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s1 = seq_.load(std::memory_order_relaxed);
+        } while ((s0 & 1u) || s0 != s1);
+
+        T v;
+        std::memcpy(&v, buf, sizeof(T));
+        return v;
+    }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<unsigned>      seq_{0};
+    std::atomic<std::uint64_t> words_[WORDS];
+};
@@ -11,6 +11,13 @@ extern "C" {
 #include "config.hpp"
 #include "utils.hpp"
 #include "astro.hpp"
+#include "stream_v2.hpp"
+#include "ring_window.hpp"
+#include "seqlock.hpp"
+#include "samples_v2.hpp"
+#include "json_writer.hpp"
+#include "summary_v2.hpp"
+#include "metrics_v2.hpp"
 
 #include <cstdio>
 #include <cstdlib>
@@ -18,6 +25,8 @@ extern "C" {
 #include <ctime>
 #include <string>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <thread>
 #include <atomic>
 #include <fstream>
@@ -25,16 +34,21 @@ extern "C" {
 #include <vector>
 #include <cstdint>
 #include <cmath>
+#include <memory>
+#include <map>
+#include <algorithm>
+#include <type_traits>
 
 using nlohmann::json;
 
 // =========================================
 // Config constants
+//
+// Tunables (ws90_url, poll interval, body size, rain event gap) are in
+// config.json and read through current_config() where they are used.
 // =========================================
 
-static const char *WS90_URL          = "http://172.17.0.1:7890";
-static const int   POLL_INTERVAL_SEC = 10;
-static const size_t MAX_BODY_SIZE    = 8192;
+static const int   PUSH_STALE_SEC    = 30;     // push mode: silence before ws90 is flagged
 
 static const char *DB_PATH_LOCAL     = "weather_history_v2.sqlite3";
 static const char *DB_PATH_DOCKER    = "/state/weather_history_v2.sqlite3";
@@ -42,6 +56,9 @@ static const char *DB_PATH_DOCKER    = "/state/weather_history_v2.sqlite3";
 static const char *STATE_PATH_DOCKER = "/state/rain_state_v2.json";
 static const char *STATE_PATH_LOCAL  = "rain_state_v2.json";
 
+static const char *CHECKPOINT_PATH_DOCKER = "/state/rain_state_v2.bin";
+static const char *CHECKPOINT_PATH_LOCAL  = "rain_state_v2.bin";
+
 static std::string get_state_path()
 {
     // If Docker directory exists, use the Docker path
@@ -52,6 +69,14 @@ static std::string get_state_path()
     return STATE_PATH_LOCAL;
 }
 
+static std::string get_checkpoint_path()
+{
+    if (access("/state", F_OK) == 0) {
+        return CHECKPOINT_PATH_DOCKER;
+    }
+    return CHECKPOINT_PATH_LOCAL;
+}
+
 static std::string get_db_path()
 {
     // If Docker directory exists, use the Docker path
@@ -68,18 +93,40 @@ static const double HISTORICAL_YEARLY_IN  = 62.77;
 static const double HISTORICAL_MONTHLY_IN = 4.27;
 static const double HISTORICAL_WEEKLY_IN  = 1.96;
 
-static const int EVENT_GAP_MIN      = 30;
 static const int HOURLY_WINDOW_SEC  = 3600;
 static const int MIN_COVERAGE_SEC   = 12 * 3600;
 
+// Rainy samples kept for the hourly window. The WS90 reports every
+// ~9 s, so one hour is ~400 samples; the ring evicts past this.
+static const size_t RAIN_DELTA_CAPACITY = 512;
+
+// Derived readings: rain rate over the last 10 minutes (as the WU
+// feeder reports it) and 10-minute gust/direction windows. 128 entries
+// at ~9 s covers the window with room for a faster sensor.
+static const int    RAIN_RATE_WINDOW_SEC = 600;
+static const int    GUST_WINDOW_SEC      = 600;
+static const size_t DERIVED_CAPACITY     = 128;
+
 // =========================================
 // Types
 // =========================================
 
-struct RainDelta {
-    std::time_t ts;
-    double      inches;
+// Rolling 1-hour rain: (timestamp, inches) with a running sum
+using RainWindow = RingWindow<double, RAIN_DELTA_CAPACITY>;
+
+// One wind sample's share of the 10-minute sums. The direction is
+// averaged as a vector weighted by wind speed, so calm readings barely
+// count and 10 and 350 deg average to north, not south.
+struct WindAcc {
+    double gust_m_s = 0.0;
+    double u        = 0.0;     // speed * sin(dir), east
+    double v        = 0.0;     // speed * cos(dir), north
+
+    WindAcc &operator+=(const WindAcc &o) { gust_m_s += o.gust_m_s; u += o.u; v += o.v; return *this; }
+    WindAcc &operator-=(const WindAcc &o) { gust_m_s -= o.gust_m_s; u -= o.u; v -= o.v; return *this; }
 };
+using GustWindow = RingWindow<WindAcc, DERIVED_CAPACITY>;
+using RateWindow = RingWindow<double, DERIVED_CAPACITY>;
 
 struct WeatherStateV2 {
     // --- WS90 telemetry ---
@@ -113,6 +160,10 @@ struct WeatherStateV2 {
     double rain_hourly_in    = 0.0;
     double rain_event_in     = 0.0;
 
+    // Never reset: feeders difference it to get the rain between uploads
+    double        rain_counter_in = 0.0;
+    std::uint64_t sample_seq      = 0;     // +1 per new sensor sample
+
     int daily_ymd            = 0;
     int month_ym             = 0;
     int year_y               = 0;
@@ -124,7 +175,7 @@ struct WeatherStateV2 {
     double historical_weekly_in  = HISTORICAL_WEEKLY_IN;
     bool   historical_seeded     = false;
 
-    std::vector<RainDelta> deltas;
+    RainWindow  deltas;
     std::time_t last_rain_ts     = 0;
 
     bool   have_temp      = false;
@@ -143,6 +194,20 @@ struct WeatherStateV2 {
     double        wind_mean_m_s     = 0.0;   // running mean of wind_avg_m_s
     double        wind_max_gust_m_s = 0.0;   // max of wind_max_m_s
     std::uint64_t wind_sample_count = 0;
+
+    // Derived readings, from derive_locked(); NAN when not defined
+    // (no humidity, outside the heat index / wind chill range, empty
+    // window). Not checkpointed: the windows refill in 10 minutes.
+    GustWindow  gusts;
+    RateWindow  rate_deltas;             // rain, last RAIN_RATE_WINDOW_SEC
+    double dew_point_c     = NAN;
+    double heat_index_c    = NAN;    // T >= 80 F
+    double wind_chill_c    = NAN;    // T <= 50 F and wind > 3 mph
+    double feels_like_c    = NAN;
+    double rain_rate_in_hr = 0.0;
+    double gust_avg_m_s    = NAN;    // 10-minute mean of wind_max_m_s
+    double gust_peak_m_s   = NAN;    // 10-minute max of wind_max_m_s
+    double wind_dir_avg_deg = NAN;   // 10-minute dominant direction
 };
 
 static WeatherStateV2 g_state;
@@ -151,6 +216,11 @@ static std::mutex     g_lock;
 static sqlite3       *g_db         = nullptr;
 static std::atomic<bool> g_running{true};
 
+static std::thread             g_poller;
+static std::mutex              g_poll_mu;      // only for g_poll_cv
+static std::condition_variable g_poll_cv;      // cuts the poll sleep short at shutdown
+static bool                    g_poll_wake = false;  // ... or on config reload (g_poll_mu)
+
 static bool        g_ws90_http_ok     = false;      // could we talk HTTP to ws90?
 static bool        g_rtlsdr_ok        = false;      // is the SDR stream healthy?
 static std::time_t g_ws90_last_poll   = 0;          // last time we polled ws90
@@ -158,6 +228,114 @@ static long        g_ws90_http_status = 0;          // last HTTP status code
 static std::string g_ws90_error_code;               // "stale_data", "no_data", "curl_error", etc.
 static std::string g_ws90_error_msg;                // human-ish description
 
+// Timing of the last poll, from CURLINFO_* (guarded by g_lock)
+struct PollStats {
+    std::uint64_t count        = 0;
+    std::uint64_t reused_count = 0;     // polls that skipped the TCP connect
+    double        connect_ms   = 0.0;
+    double        total_ms     = 0.0;
+    bool          reused       = false;
+};
+static PollStats   g_poll_stats;
+
+// Published readings. Ingest changes WeatherStateV2 under g_lock, then
+// copies what readers need into a seqlocked POD (numbers) and an
+// immutable block swapped with std::atomic_store (strings). The JSON
+// builders read only these, so they never take g_lock and never wait
+// behind a frame being applied or a daily row being written.
+struct StationTelemetry {
+    double      battery_mV      = 0.0;
+    double      battery_ok      = 0.0;
+    int         id              = 0;
+    int         firmware        = 0;
+    double      humidity        = 0.0;
+    double      temperature_C   = 0.0;
+    double      wind_dir_deg    = 0.0;
+    double      wind_avg_m_s    = 0.0;
+    double      wind_max_m_s    = 0.0;
+    double      light_lux       = 0.0;
+    double      uvi             = 0.0;
+    double      supercap_V      = 0.0;
+
+    double      rain_daily_in   = 0.0;
+    double      rain_event_in   = 0.0;
+    double      rain_hourly_in  = 0.0;
+    double      rain_weekly_in  = 0.0;
+    double      rain_monthly_in = 0.0;
+    double      rain_yearly_in  = 0.0;
+    double      rain_total_in   = 0.0;
+    double      rain_counter_in = 0.0;
+    std::uint64_t sample_seq    = 0;
+
+    bool        have_temp         = false;
+    bool        have_hum          = false;
+    bool        have_wind         = false;
+    double      temp_high_c       = 0.0;
+    double      temp_low_c        = 0.0;
+    double      hum_high          = 0.0;
+    double      hum_low           = 0.0;
+    double      wind_mean_m_s     = 0.0;
+    double      wind_max_gust_m_s = 0.0;
+
+    double      dew_point_c       = NAN;
+    double      heat_index_c      = NAN;
+    double      wind_chill_c      = NAN;
+    double      feels_like_c      = NAN;
+    double      rain_rate_in_hr   = 0.0;
+    double      gust_avg_m_s      = NAN;
+    double      gust_peak_m_s     = NAN;
+    double      wind_dir_avg_deg  = NAN;
+
+    std::time_t last_update     = 0;
+    long        http_status     = 0;
+};
+
+// Republished only when one of them changes
+struct StationText {
+    std::string model;
+    std::string time_iso;
+    std::string error_code;
+    std::string error_msg;
+};
+
+struct StationPub {
+    SeqLock<StationTelemetry>          tel;
+    std::shared_ptr<const StationText> text;    // std::atomic_store/load
+};
+
+// ws90 link health, for ws90_status
+struct LinkTelemetry {
+    bool        http_ok   = false;
+    bool        rtlsdr_ok = false;
+    std::time_t last_poll = 0;
+    PollStats   poll;
+};
+
+static StationPub             g_pub;        // the primary station
+static SeqLock<LinkTelemetry> g_link;
+
+// Secondary WS90s (config ws90_stations): live readings and running
+// totals only. They log no daily rows or raw samples and are not
+// checkpointed; g_state stays the one primary station. The map is
+// filled once at init; st and the status fields are guarded by g_lock.
+struct StationV2 {
+    WeatherStateV2 st;
+    long           http_status = 0;     // last poll (200 for a push)
+    std::string    error_code;          // last poll failure, empty when fine
+    StationPub     pub;
+};
+static std::map<int, StationV2> g_stations;
+
+// Published /api/v2/weather snapshot (swap with std::atomic_store/load)
+static std::shared_ptr<const state_v2::Snapshot> g_snapshot;
+static std::mutex    g_publish_mu;                  // serializes snapshot builds
+static std::uint64_t g_snapshot_version = 0;        // guarded by g_publish_mu
+static const std::time_t g_boot_ts = std::time(nullptr);  // ETag namespace per process
+
+// daily_weather change tracking for history ETags
+static std::atomic<long long>     g_history_last_day_ts{0};
+static std::atomic<std::uint64_t> g_history_rev{0};
+
 // =========================================
 // Time helpers
 // =========================================
@@ -210,11 +388,12 @@ static void init_state_defaults(WeatherStateV2 &st) {
     st.historical_seeded = true;
 }
 
-static void load_state(const std::string &path, WeatherStateV2 &st) {
+// JSON checkpoint: the original format, and still the import/export path
+static bool load_state_json(const std::string &path, WeatherStateV2 &st) {
     std::ifstream f(path);
     if (!f.good()) {
         init_state_defaults(st);
-        return;
+        return false;
     }
 
     try {
@@ -231,6 +410,8 @@ static void load_state(const std::string &path, WeatherStateV2 &st) {
         if (j.contains("rain_weekly_in"))       st.rain_weekly_in  = j["rain_weekly_in"].get<double>();
         if (j.contains("rain_hourly_in"))       st.rain_hourly_in  = j["rain_hourly_in"].get<double>();
         if (j.contains("rain_event_in"))        st.rain_event_in   = j["rain_event_in"].get<double>();
+        if (j.contains("rain_counter_in"))      st.rain_counter_in = j["rain_counter_in"].get<double>();
+        if (j.contains("sample_seq"))           st.sample_seq      = j["sample_seq"].get<std::uint64_t>();
 
         if (j.contains("daily_ymd"))            st.daily_ymd       = j["daily_ymd"].get<int>();
         if (j.contains("month_ym"))             st.month_ym        = j["month_ym"].get<int>();
@@ -259,13 +440,24 @@ static void load_state(const std::string &path, WeatherStateV2 &st) {
 
         if (j.contains("day_first_ts"))         st.day_first_ts    = (std::time_t)j["day_first_ts"].get<long long>();
         if (j.contains("day_last_ts"))          st.day_last_ts     = (std::time_t)j["day_last_ts"].get<long long>();
+
+        // Rolling hourly window and event anchor
+        if (j.contains("last_rain_ts"))         st.last_rain_ts    = (std::time_t)j["last_rain_ts"].get<long long>();
+        if (j.contains("deltas") && j["deltas"].is_array()) {
+            for (const auto &d : j["deltas"]) {
+                if (d.is_array() && d.size() == 2)
+                    st.deltas.push((std::time_t)d[0].get<long long>(), d[1].get<double>());
+            }
+        }
+        return true;
     }
     catch (...) {
         init_state_defaults(st);
+        return false;
     }
 }
 
-static void save_state(const WeatherStateV2 &st) {
+static void save_state_json(const WeatherStateV2 &st) {
     json j;
     j["last_rain_mm"]       = st.last_rain_mm;
     j["last_update_ts"]     = (long long)st.last_update;
@@ -276,6 +468,8 @@ static void save_state(const WeatherStateV2 &st) {
     j["rain_weekly_in"]     = st.rain_weekly_in;
     j["rain_hourly_in"]     = st.rain_hourly_in;
     j["rain_event_in"]      = st.rain_event_in;
+    j["rain_counter_in"]    = st.rain_counter_in;
+    j["sample_seq"]         = st.sample_seq;
 
     j["daily_ymd"]          = st.daily_ymd;
     j["month_ym"]           = st.month_ym;
@@ -305,7 +499,753 @@ static void save_state(const WeatherStateV2 &st) {
     j["day_first_ts"]       = (long long)st.day_first_ts;
     j["day_last_ts"]        = (long long)st.day_last_ts;
 
-    utils::write_file(get_state_path(), j.dump(2));
+    j["last_rain_ts"]       = (long long)st.last_rain_ts;
+    json deltas = json::array();
+    st.deltas.for_each([&](const RainWindow::Entry &d) {
+        deltas.push_back({(long long)d.ts, d.value});
+    });
+    j["deltas"]             = deltas;
+
+    if (!utils::write_file_atomic(get_state_path(), j.dump(2)))
+        fprintf(stderr, "Failed to write state to %s\n", get_state_path().c_str());
+}
+
+// =========================================
+// Binary checkpoint
+//
+// Layout (host byte order, little-endian on every target we build for):
+//
+//   CheckpointHeader   fixed 32 bytes, see below
+//   field table        field_count x { u16 tag, u16 type, u32 len, len bytes }
+//
+// The CRC covers the field table. Readers skip tags they do not know and
+// leave fields they do not find at their defaults, so fields can be added
+// without bumping CHECKPOINT_VERSION. Bump it only for incompatible changes.
+// =========================================
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary checkpoint assumes a little-endian host"
+#endif
+
+static const char     CHECKPOINT_MAGIC[8] = {'W','S','V','2','C','K','P','T'};
+static const uint16_t CHECKPOINT_VERSION  = 1;
+
+struct CheckpointHeader {
+    char     magic[8];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t field_count;
+    uint32_t payload_size;
+    uint32_t payload_crc;
+    int64_t  written_ts;
+};
+static_assert(sizeof(CheckpointHeader) == 32, "checkpoint header must stay 32 bytes");
+
+enum CkptType : uint16_t {
+    CKT_F64    = 1,
+    CKT_I64    = 2,
+    CKT_BOOL   = 3,
+    CKT_DELTAS = 4,   // array of { i64 ts, f64 inches }
+};
+
+// Tags are forever: never renumber, only append
+enum CkptTag : uint16_t {
+    CK_LAST_RAIN_MM = 1,  CK_LAST_UPDATE,
+    CK_RAIN_DAILY,        CK_RAIN_MONTHLY,      CK_RAIN_YEARLY,
+    CK_RAIN_WEEKLY,       CK_RAIN_HOURLY,       CK_RAIN_EVENT,
+    CK_DAILY_YMD,         CK_MONTH_YM,          CK_YEAR_Y,           CK_WEEK_START_YMD,
+    CK_HIST_TOTAL,        CK_HIST_YEARLY,       CK_HIST_MONTHLY,     CK_HIST_WEEKLY,
+    CK_HIST_SEEDED,
+    CK_HAVE_TEMP,         CK_TEMP_HIGH,         CK_TEMP_LOW,
+    CK_HAVE_HUM,          CK_HUM_HIGH,          CK_HUM_LOW,
+    CK_HAVE_WIND,         CK_WIND_MEAN,         CK_WIND_MAX_GUST,    CK_WIND_COUNT,
+    CK_DAY_FIRST_TS,      CK_DAY_LAST_TS,
+    CK_LAST_RAIN_TS,      CK_DELTAS,
+    CK_RAIN_COUNTER,      CK_SAMPLE_SEQ,
+};
+
+struct CkptWriter {
+    std::string buf;
+    uint32_t    count = 0;
+
+    void field(uint16_t tag, uint16_t type, const void *p, uint32_t len) {
+        char hdr[8];
+        std::memcpy(hdr,     &tag,  2);
+        std::memcpy(hdr + 2, &type, 2);
+        std::memcpy(hdr + 4, &len,  4);
+        buf.append(hdr, sizeof(hdr));
+        buf.append(static_cast<const char *>(p), len);
+        count++;
+    }
+    void f64(uint16_t tag, double v)       { field(tag, CKT_F64, &v, 8); }
+    void i64(uint16_t tag, int64_t v)      { field(tag, CKT_I64, &v, 8); }
+    void flag(uint16_t tag, bool v)        { uint8_t b = v ? 1 : 0; field(tag, CKT_BOOL, &b, 1); }
+};
+
+static std::string encode_checkpoint(const WeatherStateV2 &st)
+{
+    CkptWriter w;
+    w.buf.reserve(sizeof(CheckpointHeader) + 512 + st.deltas.size() * 16);
+    w.buf.resize(sizeof(CheckpointHeader));
+
+    w.f64(CK_LAST_RAIN_MM,   st.last_rain_mm);
+    w.i64(CK_LAST_UPDATE,    st.last_update);
+    w.f64(CK_RAIN_DAILY,     st.rain_daily_in);
+    w.f64(CK_RAIN_MONTHLY,   st.rain_monthly_in);
+    w.f64(CK_RAIN_YEARLY,    st.rain_yearly_in);
+    w.f64(CK_RAIN_WEEKLY,    st.rain_weekly_in);
+    w.f64(CK_RAIN_HOURLY,    st.rain_hourly_in);
+    w.f64(CK_RAIN_EVENT,     st.rain_event_in);
+    w.i64(CK_DAILY_YMD,      st.daily_ymd);
+    w.i64(CK_MONTH_YM,       st.month_ym);
+    w.i64(CK_YEAR_Y,         st.year_y);
+    w.i64(CK_WEEK_START_YMD, st.week_start_ymd);
+    w.f64(CK_HIST_TOTAL,     st.historical_total_in);
+    w.f64(CK_HIST_YEARLY,    st.historical_yearly_in);
+    w.f64(CK_HIST_MONTHLY,   st.historical_monthly_in);
+    w.f64(CK_HIST_WEEKLY,    st.historical_weekly_in);
+    w.flag(CK_HIST_SEEDED,   st.historical_seeded);
+    w.flag(CK_HAVE_TEMP,     st.have_temp);
+    w.f64(CK_TEMP_HIGH,      st.temp_high_c);
+    w.f64(CK_TEMP_LOW,       st.temp_low_c);
+    w.flag(CK_HAVE_HUM,      st.have_hum);
+    w.f64(CK_HUM_HIGH,       st.hum_high);
+    w.f64(CK_HUM_LOW,        st.hum_low);
+    w.flag(CK_HAVE_WIND,     st.have_wind);
+    w.f64(CK_WIND_MEAN,      st.wind_mean_m_s);
+    w.f64(CK_WIND_MAX_GUST,  st.wind_max_gust_m_s);
+    w.i64(CK_WIND_COUNT,     (int64_t)st.wind_sample_count);
+    w.i64(CK_DAY_FIRST_TS,   st.day_first_ts);
+    w.i64(CK_DAY_LAST_TS,    st.day_last_ts);
+    w.i64(CK_LAST_RAIN_TS,   st.last_rain_ts);
+    w.f64(CK_RAIN_COUNTER,   st.rain_counter_in);
+    w.i64(CK_SAMPLE_SEQ,     (int64_t)st.sample_seq);
+
+    std::string deltas;
+    deltas.reserve(st.deltas.size() * 16);
+    st.deltas.for_each([&](const RainWindow::Entry &d) {
+        int64_t ts = d.ts;
+        deltas.append(reinterpret_cast<const char *>(&ts), 8);
+        deltas.append(reinterpret_cast<const char *>(&d.value), 8);
+    });
+    w.field(CK_DELTAS, CKT_DELTAS, deltas.data(), (uint32_t)deltas.size());
+
+    CheckpointHeader h{};
+    std::memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version      = CHECKPOINT_VERSION;
+    h.header_size  = sizeof(CheckpointHeader);
+    h.field_count  = w.count;
+    h.payload_size = (uint32_t)(w.buf.size() - sizeof(CheckpointHeader));
+    h.payload_crc  = utils::crc32(w.buf.data() + sizeof(CheckpointHeader), h.payload_size);
+    h.written_ts   = std::time(nullptr);
+    std::memcpy(&w.buf[0], &h, sizeof(h));
+
+    return std::move(w.buf);
+}
+
+static bool decode_checkpoint(const std::string &raw, WeatherStateV2 &st)
+{
+    CheckpointHeader h;
+    if (raw.size() < sizeof(h)) return false;
+    std::memcpy(&h, raw.data(), sizeof(h));
+
+    if (std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0) return false;
+    if (h.version != CHECKPOINT_VERSION)                            return false;
+    if (h.header_size < sizeof(h) || h.header_size > raw.size())    return false;
+    if (h.payload_size != raw.size() - h.header_size)               return false;
+
+    const char *p   = raw.data() + h.header_size;
+    const char *end = p + h.payload_size;
+    if (utils::crc32(p, h.payload_size) != h.payload_crc)           return false;
+
+    init_state_defaults(st);
+
+    for (uint32_t i = 0; i < h.field_count; ++i) {
+        uint16_t tag, type;
+        uint32_t len;
+        if (end - p < 8) return false;
+        std::memcpy(&tag,  p,     2);
+        std::memcpy(&type, p + 2, 2);
+        std::memcpy(&len,  p + 4, 4);
+        p += 8;
+        if ((size_t)(end - p) < len) return false;
+
+        // A known tag with the wrong type or length leaves its field at
+        // the init_state_defaults value
+        auto f = [&](double &dst) {
+            if (type == CKT_F64 && len == 8) std::memcpy(&dst, p, 8);
+        };
+        auto n = [&](auto &dst) {
+            int64_t v;
+            if (type != CKT_I64 || len != 8) return;
+            std::memcpy(&v, p, 8);
+            dst = static_cast<std::remove_reference_t<decltype(dst)>>(v);
+        };
+        auto b = [&](bool &dst) {
+            if (type == CKT_BOOL && len == 1) dst = (*p != 0);
+        };
+
+        switch (tag) {
+        case CK_LAST_RAIN_MM:   f(st.last_rain_mm); break;
+        case CK_LAST_UPDATE:    n(st.last_update); break;
+        case CK_RAIN_DAILY:     f(st.rain_daily_in); break;
+        case CK_RAIN_MONTHLY:   f(st.rain_monthly_in); break;
+        case CK_RAIN_YEARLY:    f(st.rain_yearly_in); break;
+        case CK_RAIN_WEEKLY:    f(st.rain_weekly_in); break;
+        case CK_RAIN_HOURLY:    f(st.rain_hourly_in); break;
+        case CK_RAIN_EVENT:     f(st.rain_event_in); break;
+        case CK_DAILY_YMD:      n(st.daily_ymd); break;
+        case CK_MONTH_YM:       n(st.month_ym); break;
+        case CK_YEAR_Y:         n(st.year_y); break;
+        case CK_WEEK_START_YMD: n(st.week_start_ymd); break;
+        case CK_HIST_TOTAL:     f(st.historical_total_in); break;
+        case CK_HIST_YEARLY:    f(st.historical_yearly_in); break;
+        case CK_HIST_MONTHLY:   f(st.historical_monthly_in); break;
+        case CK_HIST_WEEKLY:    f(st.historical_weekly_in); break;
+        case CK_HIST_SEEDED:    b(st.historical_seeded); break;
+        case CK_HAVE_TEMP:      b(st.have_temp); break;
+        case CK_TEMP_HIGH:      f(st.temp_high_c); break;
+        case CK_TEMP_LOW:       f(st.temp_low_c); break;
+        case CK_HAVE_HUM:       b(st.have_hum); break;
+        case CK_HUM_HIGH:       f(st.hum_high); break;
+        case CK_HUM_LOW:        f(st.hum_low); break;
+        case CK_HAVE_WIND:      b(st.have_wind); break;
+        case CK_WIND_MEAN:      f(st.wind_mean_m_s); break;
+        case CK_WIND_MAX_GUST:  f(st.wind_max_gust_m_s); break;
+        case CK_WIND_COUNT:     n(st.wind_sample_count); break;
+        case CK_DAY_FIRST_TS:   n(st.day_first_ts); break;
+        case CK_DAY_LAST_TS:    n(st.day_last_ts); break;
+        case CK_LAST_RAIN_TS:   n(st.last_rain_ts); break;
+        case CK_RAIN_COUNTER:   f(st.rain_counter_in); break;
+        case CK_SAMPLE_SEQ:     n(st.sample_seq); break;
+        case CK_DELTAS:
+            if (type == CKT_DELTAS && len % 16 == 0) {
+                st.deltas.clear();
+                for (uint32_t off = 0; off < len; off += 16) {
+                    int64_t ts;
+                    double  in;
+                    std::memcpy(&ts, p + off,     8);
+                    std::memcpy(&in, p + off + 8, 8);
+                    st.deltas.push((std::time_t)ts, in);
+                }
+            }
+            break;
+        default:
+            break;   // newer field: skip
+        }
+        p += len;
+    }
+    return true;
+}
+
+static bool load_state_binary(const std::string &path, WeatherStateV2 &st)
+{
+    std::string raw;
+    if (!utils::read_file(path, raw))
+        return false;
+    if (!decode_checkpoint(raw, st)) {
+        fprintf(stderr, "Ignoring invalid checkpoint %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void save_state_binary(const WeatherStateV2 &st)
+{
+    if (!utils::write_file_atomic(get_checkpoint_path(), encode_checkpoint(st)))
+        fprintf(stderr, "Failed to write checkpoint to %s\n", get_checkpoint_path().c_str());
+}
+
+static bool use_binary_checkpoint()
+{
+    return current_config()->state_format == "binary";
+}
+
+// Binary checkpoint if enabled and valid; JSON otherwise (also the
+// import path when switching formats).
+static void load_state(WeatherStateV2 &st)
+{
+    if (use_binary_checkpoint() && load_state_binary(get_checkpoint_path(), st))
+        return;
+    load_state_json(get_state_path(), st);
+}
+
+// final: last write before exit. In binary mode the JSON file is
+// refreshed too, so it stays a usable export.
+static void save_state(const WeatherStateV2 &st, bool final)
+{
+    std::uint64_t t0 = metrics_v2::now_ns();
+    if (use_binary_checkpoint()) {
+        save_state_binary(st);
+        if (final)
+            save_state_json(st);
+    } else {
+        save_state_json(st);
+    }
+    metrics_v2::observe(metrics_v2::T_SAVE_STATE, metrics_v2::now_ns() - t0);
+}
+
+// =========================================
+// Persistence worker
+//
+// The poller never touches the disk, and ingest never copies the state:
+// it only marks it dirty. The worker takes its own copy of g_state when
+// it wakes, on an interval, immediately on rollover, and at shutdown,
+// so any number of samples between flushes cost one copy.
+// =========================================
+
+static std::thread             g_persister;
+static bool                    g_state_dirty    = false;   // guarded by g_lock
+static std::mutex              g_persist_lock;     // guards the block below
+static std::condition_variable g_persist_cv;
+static bool                    g_persist_urgent = false;
+static bool                    g_persist_stop   = false;
+
+// Flag g_state for writing; urgent wakes the worker now. Called with
+// g_lock held; no I/O and no allocation.
+static void mark_state_dirty_locked(bool urgent)
+{
+    g_state_dirty = true;
+    if (urgent) {
+        std::lock_guard<std::mutex> guard(g_persist_lock);
+        g_persist_urgent = true;
+        g_persist_cv.notify_one();
+    }
+}
+
+static void persist_thread_func()
+{
+    WeatherStateV2 st;      // reused, so its strings keep their capacity
+    std::unique_lock<std::mutex> lk(g_persist_lock);
+    while (true) {
+        // Re-read each round so a config reload applies from the next wait
+        int interval = current_config()->state_flush_interval_sec;
+        if (interval <= 0) interval = 60;
+
+        g_persist_cv.wait_for(lk, std::chrono::seconds(interval),
+                              [] { return g_persist_urgent || g_persist_stop; });
+        bool final = g_persist_stop;
+        g_persist_urgent = false;
+
+        // Never hold g_persist_lock while taking g_lock: ingest nests
+        // them the other way round
+        lk.unlock();
+        bool dirty;
+        {
+            metrics_v2::TimedLock guard(g_lock);
+            dirty = g_state_dirty;
+            if (dirty) {
+                st            = g_state;
+                g_state_dirty = false;
+            }
+        }
+        if (dirty)
+            save_state(st, final);
+        lk.lock();
+
+        if (final)
+            break;
+    }
+}
+
+// =========================================
+// daily_weather readers
+// =========================================
+
+// Column-driven: every history reply is built from this table. A series
+// is a group of daily_weather columns that is either all present or all
+// null in a row (a day with a high but no low is reported as null).
+enum HistoryUnit { HU_AS_IS, HU_C_TO_F, HU_MS_TO_MPH };
+
+struct HistoryColumn {
+    const char  *col;       // daily_weather column
+    const char  *key;       // JSON key in a row
+    HistoryUnit  unit;
+};
+
+struct HistorySeriesDef {
+    const char    *name;    // series= token
+    HistoryColumn  cols[2];
+    int            ncols;
+    bool           sparse;  // asked for alone, days without it are omitted
+};
+
+// Order matches the HISTORY_* bits in state_v2.hpp
+static const HistorySeriesDef HISTORY_SERIES[] = {
+    { "temp",     { { "temp_high_c",   "temp_high_F",       HU_C_TO_F    },
+                    { "temp_low_c",    "temp_low_F",        HU_C_TO_F    } }, 2, false },
+    { "humidity", { { "humidity_high", "humidity_high",     HU_AS_IS     },
+                    { "humidity_low",  "humidity_low",      HU_AS_IS     } }, 2, false },
+    { "rain",     { { "rain_in",       "rain_in",           HU_AS_IS     } }, 1, true  },
+    { "wind",     { { "wind_mean_m_s", "wind_mean_mph",     HU_MS_TO_MPH },
+                    { "wind_gust_m_s", "wind_gust_max_mph", HU_MS_TO_MPH } }, 2, false },
+};
+
+static const int HISTORY_SERIES_COUNT =
+    (int)(sizeof(HISTORY_SERIES) / sizeof(HISTORY_SERIES[0]));
+
+// One ascending and one descending statement over every column, prepared
+// in init_db on the reader connection and reset/rebound per request.
+// Unrequested columns come along in the same row read, so one statement
+// pair serves every series= combination.
+//   ?1 lower bound (days= or after_ts), ?2 upper bound (before_ts),
+//   ?3 limit (-1 = none), ?4 legacy offset
+static sqlite3_stmt *g_hist_asc  = nullptr;
+static sqlite3_stmt *g_hist_desc = nullptr;
+
+static sqlite3    *g_rdb = nullptr;     // read-only, opened NOMUTEX
+static std::mutex  g_rdb_mu;            // serializes g_rdb and its statements
+
+static bool prepare_history_statements()
+{
+    std::string base = "SELECT day_ts";
+    for (const HistorySeriesDef &hs : HISTORY_SERIES)
+        for (int c = 0; c < hs.ncols; c++)
+            base += std::string(", ") + hs.cols[c].col;
+    base += " FROM daily_weather WHERE day_ts >= ?1 AND day_ts < ?2 ORDER BY day_ts";
+
+    std::string asc  = base + " LIMIT ?3 OFFSET ?4";
+    std::string desc = base + " DESC LIMIT ?3 OFFSET ?4";
+
+    if (sqlite3_prepare_v3(g_rdb, asc.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                           &g_hist_asc, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v3(g_rdb, desc.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                           &g_hist_desc, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "DB prepare error: %s\n", sqlite3_errmsg(g_rdb));
+        return false;
+    }
+    return true;
+}
+
+static void close_history_reader()
+{
+    std::lock_guard<std::mutex> guard(g_rdb_mu);
+    sqlite3_finalize(g_hist_asc);
+    sqlite3_finalize(g_hist_desc);
+    g_hist_asc = g_hist_desc = nullptr;
+    if (g_rdb) {
+        sqlite3_close(g_rdb);
+        g_rdb = nullptr;
+    }
+}
+
+static double history_convert(double v, HistoryUnit unit)
+{
+    switch (unit) {
+    case HU_C_TO_F:    return v * 9.0 / 5.0 + 32.0;
+    case HU_MS_TO_MPH: return v * utils::MPH_PER_M_S;
+    default:           return v;
+    }
+}
+
+// One output column of a history reply, resolved from the series table
+struct HistoryOutColumn {
+    const char  *key;
+    HistoryUnit  unit;
+    int          col;           // statement column
+    int          group;         // first statement column of its series
+    int          group_n;
+};
+
+// Rows per history_next() call. The reader lock is held for one chunk
+// only, so a long download never blocks other history requests.
+static const int HISTORY_CHUNK_ROWS = 256;
+
+namespace state_v2 {
+
+// A history reply in progress. Every chunk is its own keyset query
+// (day_ts >= lo, ascending), so nothing stays open between chunks and
+// rows committed in the meantime cannot shift the page.
+struct HistoryStream {
+    HistoryFormat format    = HISTORY_FORMAT_ROWS;
+    std::vector<HistoryOutColumn> cols;
+    int           sparse_group = 0; // drop rows missing this series (0 = never)
+    int           sparse_n     = 0;
+
+    sqlite3_int64 lo        = INT64_MIN;
+    sqlite3_int64 hi        = INT64_MAX;
+    int           remaining = -1;   // rows left to scan, -1 = no limit
+    int           offset    = 0;    // legacy offset, first chunk only
+
+    // For the cursors in the trailer
+    int           limit     = -1;
+    bool          backward  = false;
+    bool          show_prev = false;
+    int           scanned   = 0;
+    long long     first_ts  = 0;
+    long long     last_ts   = 0;
+
+    int           stage     = 0;    // 0 header, 1 rows, 2 done
+    int           written   = 0;    // rows emitted
+    std::uint64_t step_ns   = 0;    // time inside sqlite3_step, for /metrics
+
+    // Columnar: one array body per column ("day" first), joined at the end
+    std::vector<std::string> packed;
+};
+
+}
+
+static bool history_group_missing(sqlite3_stmt *stmt, int group, int n)
+{
+    for (int c = 0; c < n; c++)
+        if (sqlite3_column_type(stmt, group + c) == SQLITE_NULL)
+            return true;
+    return false;
+}
+
+// Emit the current row in the stream's format. Returns false, writing
+// nothing, when the row is dropped (a sparse series asked for alone,
+// and missing).
+static bool history_row(sqlite3_stmt *stmt, state_v2::HistoryStream &hs, std::string &out)
+{
+    if (hs.sparse_n && history_group_missing(stmt, hs.sparse_group, hs.sparse_n))
+        return false;
+
+    long long day = (long long)sqlite3_column_int64(stmt, 0);
+
+    switch (hs.format) {
+    case state_v2::HISTORY_FORMAT_ROWS: {
+        JsonWriter w(out);
+        w.resume(hs.written > 0);
+        w.begin_object();
+        w.field("day", day);
+        for (const HistoryOutColumn &c : hs.cols) {
+            if (history_group_missing(stmt, c.group, c.group_n))
+                w.field_null(c.key);
+            else
+                w.field(c.key, history_convert(sqlite3_column_double(stmt, c.col), c.unit));
+        }
+        w.end_object();
+        break;
+    }
+
+    case state_v2::HISTORY_FORMAT_COLUMNAR: {
+        std::string sep = hs.written > 0 ? "," : "";
+        hs.packed[0] += sep;
+        JsonWriter::number(hs.packed[0], day);
+        for (size_t i = 0; i < hs.cols.size(); i++) {
+            const HistoryOutColumn &c = hs.cols[i];
+            std::string &p = hs.packed[i + 1];
+            p += sep;
+            if (history_group_missing(stmt, c.group, c.group_n))
+                p += "null";
+            else
+                JsonWriter::number(p, history_convert(sqlite3_column_double(stmt, c.col), c.unit));
+        }
+        break;
+    }
+
+    case state_v2::HISTORY_FORMAT_CSV:
+        JsonWriter::number(out, day);
+        for (const HistoryOutColumn &c : hs.cols) {
+            out += ',';
+            if (!history_group_missing(stmt, c.group, c.group_n))
+                JsonWriter::number(out, history_convert(sqlite3_column_double(stmt, c.col), c.unit));
+        }
+        out += '\n';
+        break;
+    }
+
+    hs.written++;
+    return true;
+}
+
+// Header of the body, before the first row
+static void history_begin(state_v2::HistoryStream &hs, std::string &out)
+{
+    switch (hs.format) {
+    case state_v2::HISTORY_FORMAT_ROWS:
+        out += "{\"days\":[";
+        break;
+    case state_v2::HISTORY_FORMAT_COLUMNAR:
+        hs.packed.assign(hs.cols.size() + 1, std::string());
+        break;
+    case state_v2::HISTORY_FORMAT_CSV:
+        out += "day";
+        for (const HistoryOutColumn &c : hs.cols) {
+            out += ',';
+            out += c.key;
+        }
+        out += '\n';
+        break;
+    }
+}
+
+// Rest of the body once the range is exhausted. CSV has no trailer:
+// continue from the last row's day with after_ts.
+static void history_end(state_v2::HistoryStream &hs, std::string &out)
+{
+    if (hs.format == state_v2::HISTORY_FORMAT_CSV)
+        return;
+
+    JsonWriter w(out);
+    if (hs.format == state_v2::HISTORY_FORMAT_ROWS) {
+        out += "]";
+        w.resume(true);
+    } else {
+        out += "{\"day\":[";
+        out += hs.packed[0];
+        out += ']';
+        for (size_t i = 0; i < hs.cols.size(); i++) {
+            out += ",\"";
+            out += hs.cols[i].key;
+            out += "\":[";
+            out += hs.packed[i + 1];
+            out += ']';
+        }
+        hs.packed.clear();
+        w.resume(true);
+    }
+
+    // Cursors for the neighbouring pages (only meaningful when paging)
+    if (hs.limit > 0 && hs.scanned > 0) {
+        bool full = (hs.scanned == hs.limit);
+        if (hs.backward || full)
+            w.field("next_after_ts", hs.last_ts);
+        if (hs.backward ? full : hs.show_prev)
+            w.field("prev_before_ts", hs.first_ts);
+    }
+
+    out += '}';
+}
+
+// before_ts alone pages backwards: find where the page starts with the
+// DESC statement (day_ts only, so this is index-only work), then stream
+// that range forwards like any other.
+static void history_resolve_backward(state_v2::HistoryStream &hs, int offset)
+{
+    std::lock_guard<std::mutex> guard(g_rdb_mu);
+    sqlite3_stmt *stmt = g_hist_desc;
+    if (!stmt) return;
+
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, hs.lo);
+    sqlite3_bind_int64(stmt, 2, hs.hi);
+    sqlite3_bind_int(stmt,   3, hs.remaining);
+    sqlite3_bind_int(stmt,   4, offset);
+
+    int  n = 0;
+    long long newest = 0, oldest = 0;
+    std::uint64_t t0 = metrics_v2::now_ns();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        long long ts = (long long)sqlite3_column_int64(stmt, 0);
+        if (n++ == 0) newest = ts;
+        oldest = ts;
+    }
+    hs.step_ns += metrics_v2::now_ns() - t0;
+    sqlite3_reset(stmt);
+
+    if (n == 0) {
+        hs.remaining = 0;
+    } else {
+        hs.lo        = oldest;
+        hs.hi        = newest + 1;
+        hs.remaining = n;
+    }
+}
+
+namespace state_v2 {
+
+HistoryStream *history_open(unsigned series, const HistoryQuery &q, HistoryFormat format)
+{
+    HistoryStream *hs = new HistoryStream;
+    hs->format = format;
+
+    int col = 1;
+    for (int i = 0; i < HISTORY_SERIES_COUNT; i++) {
+        const HistorySeriesDef &def = HISTORY_SERIES[i];
+        if (series & (1u << i)) {
+            for (int c = 0; c < def.ncols; c++)
+                hs->cols.push_back({ def.cols[c].key, def.cols[c].unit, col + c, col, def.ncols });
+            if (series == (1u << i) && def.sparse) {
+                hs->sparse_group = col;
+                hs->sparse_n     = def.ncols;
+            }
+        }
+        col += def.ncols;
+    }
+
+    hs->limit     = q.limit > 0 ? q.limit : -1;
+    hs->remaining = hs->limit;
+    hs->offset    = q.offset > 0 ? q.offset : 0;
+    hs->backward  = (q.before_ts >= 0 && q.after_ts < 0);
+    hs->show_prev = (q.after_ts >= 0 || q.offset > 0);
+
+    if (q.days > 0)
+        hs->lo = (sqlite3_int64)(std::time(nullptr) - static_cast<std::time_t>(q.days) * 86400);
+    if (q.after_ts >= 0)
+        hs->lo = std::max(hs->lo, (sqlite3_int64)q.after_ts + 1);
+    if (q.before_ts >= 0)
+        hs->hi = (sqlite3_int64)q.before_ts;
+
+    if (hs->backward) {
+        history_resolve_backward(*hs, hs->offset);
+        hs->offset = 0;
+    }
+    return hs;
+}
+
+bool history_next(HistoryStream *hs, std::string &out)
+{
+    if (hs->stage == 2)
+        return false;
+
+    if (hs->stage == 0) {
+        history_begin(*hs, out);
+        hs->stage = 1;
+    }
+
+    int want = HISTORY_CHUNK_ROWS;
+    if (hs->remaining >= 0 && hs->remaining < want)
+        want = hs->remaining;
+
+    int got = 0;
+    if (want > 0) {
+        std::lock_guard<std::mutex> guard(g_rdb_mu);
+        sqlite3_stmt *stmt = g_hist_asc;
+        if (stmt) {
+            sqlite3_reset(stmt);
+            sqlite3_bind_int64(stmt, 1, hs->lo);
+            sqlite3_bind_int64(stmt, 2, hs->hi);
+            sqlite3_bind_int(stmt,   3, want);
+            sqlite3_bind_int(stmt,   4, hs->offset);
+
+            // Only the steps are timed, not the formatting between them
+            for (;;) {
+                std::uint64_t t0 = metrics_v2::now_ns();
+                int rc = sqlite3_step(stmt);
+                hs->step_ns += metrics_v2::now_ns() - t0;
+                if (rc != SQLITE_ROW)
+                    break;
+
+                long long ts = (long long)sqlite3_column_int64(stmt, 0);
+                if (hs->scanned++ == 0) hs->first_ts = ts;
+                hs->last_ts = ts;
+                got++;
+                history_row(stmt, *hs, out);
+            }
+            sqlite3_reset(stmt);
+        }
+        hs->offset = 0;
+        if (hs->remaining > 0) hs->remaining -= got;
+        hs->lo = (sqlite3_int64)hs->last_ts + 1;
+    }
+
+    // A short chunk means the range is exhausted
+    if (want > 0 && got == want) return true;
+
+    history_end(*hs, out);
+    hs->stage = 2;
+    return true;
+}
+
+void history_close(HistoryStream *hs)
+{
+    if (hs->stage != 0)
+        metrics_v2::observe(metrics_v2::T_HISTORY_STEP, hs->step_ns);
+    delete hs;
+}
+
 }
 
 // =========================================
@@ -315,14 +1255,18 @@ static void save_state(const WeatherStateV2 &st) {
 static void init_db() {
     std::string db_path = get_db_path();
 
-    if (sqlite3_open(db_path.c_str(), &g_db) != SQLITE_OK) {
+    // Writer: poller thread only, but serialized mode so misuse can't corrupt it
+    if (sqlite3_open_v2(db_path.c_str(), &g_db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                        nullptr) != SQLITE_OK) {
         fprintf(stderr, "Failed to open DB at %s: %s\n",
                 db_path.c_str(),
                 sqlite3_errmsg(g_db));
         g_db = nullptr;
         return;
     }
-
+    // samples_v2 writes to the same file; wait out its commits
+    sqlite3_busy_timeout(g_db, 5000);
 
     const char *sql =
         "CREATE TABLE IF NOT EXISTS daily_weather ("
@@ -331,7 +1275,9 @@ static void init_db() {
         "  temp_low_c REAL,"
         "  humidity_high REAL,"
         "  humidity_low REAL,"
-        "  rain_in REAL"
+        "  rain_in REAL,"
+        "  wind_mean_m_s REAL,"
+        "  wind_gust_m_s REAL"
         ");";
 
     char *err = nullptr;
@@ -339,16 +1285,59 @@ static void init_db() {
         fprintf(stderr, "DB init error: %s\n", err);
         sqlite3_free(err);
     }
+
+    // Databases from before daily wind was logged: add the columns.
+    // Fails harmlessly ("duplicate column") once they exist.
+    sqlite3_exec(g_db, "ALTER TABLE daily_weather ADD COLUMN wind_mean_m_s REAL",
+                 nullptr, nullptr, nullptr);
+    sqlite3_exec(g_db, "ALTER TABLE daily_weather ADD COLUMN wind_gust_m_s REAL",
+                 nullptr, nullptr, nullptr);
+
+    summary_v2::init(g_db);
+
+    // Seed history ETag state from what is already on disk
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(g_db,
+                           "SELECT MAX(day_ts), COUNT(*) FROM daily_weather",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            g_history_last_day_ts = (long long)sqlite3_column_int64(stmt, 0);
+            g_history_rev         = (std::uint64_t)sqlite3_column_int64(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Reader for the HTTP threads. A separate connection, so a history
+    // query never queues behind the poller's insert (WAL lets them overlap).
+    if (sqlite3_open_v2(db_path.c_str(), &g_rdb,
+                        SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                        nullptr) != SQLITE_OK) {
+        fprintf(stderr, "Failed to open DB reader at %s: %s\n",
+                db_path.c_str(), sqlite3_errmsg(g_rdb));
+        sqlite3_close(g_rdb);
+        g_rdb = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(g_rdb, 5000);
+    if (!prepare_history_statements())
+        close_history_reader();
 }
 
-static void log_daily_to_db(std::time_t day_ts, const WeatherStateV2 &st, double rain_in)
+// keep_existing (backfill): a row already logged for day_ts wins
+static void log_daily_to_db(std::time_t day_ts, const WeatherStateV2 &st, double rain_in,
+                            bool keep_existing = false)
 {
     if (!g_db) return;
 
-    const char *sql =
-        "INSERT OR REPLACE INTO daily_weather "
-        "(day_ts, temp_high_c, temp_low_c, humidity_high, humidity_low, rain_in) "
-        "VALUES (?, ?, ?, ?, ?, ?)";
+    const char *sql = keep_existing
+        ? "INSERT OR IGNORE INTO daily_weather "
+          "(day_ts, temp_high_c, temp_low_c, humidity_high, humidity_low, rain_in,"
+          " wind_mean_m_s, wind_gust_m_s) "
+          "VALUES (?, ?, ?, ?, ?, ?, ?, ?)"
+        : "INSERT OR REPLACE INTO daily_weather "
+          "(day_ts, temp_high_c, temp_low_c, humidity_high, humidity_low, rain_in,"
+          " wind_mean_m_s, wind_gust_m_s) "
+          "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt *stmt = nullptr;
 
@@ -375,32 +1364,51 @@ static void log_daily_to_db(std::time_t day_ts, const WeatherStateV2 &st, double
 
     sqlite3_bind_double(stmt, 6, rain_in);
 
-    sqlite3_step(stmt);
+    if (st.have_wind) {
+        sqlite3_bind_double(stmt, 7, st.wind_mean_m_s);
+        sqlite3_bind_double(stmt, 8, st.wind_max_gust_m_s);
+    } else {
+        sqlite3_bind_null(stmt, 7);
+        sqlite3_bind_null(stmt, 8);
+    }
+
+    bool changed = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(g_db) > 0;
+    if (changed) {
+        if ((long long)day_ts > g_history_last_day_ts.load())
+            g_history_last_day_ts = (long long)day_ts;
+        g_history_rev++;
+    }
     sqlite3_finalize(stmt);
+
+    if (changed)
+        summary_v2::day_logged(g_db, day_ts);
 }
 
 // =========================================
 // Rain logic
 // =========================================
 
+// Expire old deltas and take the running sum. Cheap enough to run on
+// every sample, so hourly rain also decays once the rain stops.
 static void recompute_hourly(WeatherStateV2 &st, std::time_t now)
 {
-    double sum = 0.0;
-    auto &v = st.deltas;
-    size_t w = 0;
-
-    for (size_t i = 0; i < v.size(); ++i) {
-        if (now - v[i].ts <= HOURLY_WINDOW_SEC) {
-            v[w++] = v[i];
-            sum += v[i].inches;
-        }
-    }
-    v.resize(w);
-    st.rain_hourly_in = sum;
+    st.deltas.expire(now, HOURLY_WINDOW_SEC);
+    st.rain_hourly_in = st.deltas.empty() ? 0.0 : std::max(0.0, st.deltas.sum());
 }
 
-static void rollover_if_needed(WeatherStateV2 &st, std::time_t now)
+// How apply_ws90_json_locked treats a frame
+enum ApplyMode {
+    APPLY_PRIMARY,      // live primary: logs daily rows, checkpointed
+    APPLY_STATION,      // ws90_stations entry: live totals only
+    APPLY_BACKFILL,     // recorded sample: logs days not yet in daily_weather
+};
+
+// Returns true if any day/week/month/year boundary was crossed. The
+// finished day goes to daily_weather unless mode is APPLY_STATION.
+static bool rollover_if_needed(WeatherStateV2 &st, std::time_t now, ApplyMode mode)
 {
+    bool rolled = false;
+
     int d = ymd_from_time(now);
     int m = ym_from_time(now);
     int y = y_from_time(now);
@@ -412,13 +1420,14 @@ static void rollover_if_needed(WeatherStateV2 &st, std::time_t now)
 
     // --- DAY ROLLOVER (LOCAL MIDNIGHT RESET) ---
     if (d != st.daily_ymd) {
+        rolled = true;
         std::time_t prev_day_ts = day_start_ts(st.day_first_ts ? st.day_first_ts : (now - 86400));
 
         bool ok = (st.day_first_ts && st.day_last_ts &&
                    (st.day_last_ts - st.day_first_ts) >= MIN_COVERAGE_SEC);
 
-        if (ok)
-            log_daily_to_db(prev_day_ts, st, st.rain_daily_in);
+        if (ok && mode != APPLY_STATION)
+            log_daily_to_db(prev_day_ts, st, st.rain_daily_in, mode == APPLY_BACKFILL);
 
         st.rain_daily_in  = 0.0;
         st.daily_ymd      = d;
@@ -438,12 +1447,14 @@ static void rollover_if_needed(WeatherStateV2 &st, std::time_t now)
 
     // --- MONTH ROLLOVER ---
     if (m != st.month_ym) {
+        rolled = true;
         st.rain_monthly_in = 0.0;
         st.month_ym        = m;
     }
 
     // --- YEAR ROLLOVER ---
     if (y != st.year_y) {
+        rolled = true;
         st.rain_yearly_in = 0.0;
         st.year_y         = y;
     }
@@ -457,18 +1468,111 @@ static void rollover_if_needed(WeatherStateV2 &st, std::time_t now)
     std::time_t today_ts = day_start_ts(now);
 
     if (difftime(today_ts, ws_ts) >= 7 * 86400) {
+        rolled = true;
         st.rain_weekly_in = 0.0;
         st.week_start_ymd = d;
     }
+
+    return rolled;
+}
+
+// =========================================
+// Reading publish
+// =========================================
+
+// Copy st into its published form. Called with g_lock held; a seqlock
+// store plus, when a string changed, one small allocation.
+static void publish_station_locked(const WeatherStateV2 &st, long http_status,
+                                   const std::string &error_code,
+                                   const std::string &error_msg, StationPub &pub)
+{
+    StationTelemetry t;
+    t.battery_mV      = st.battery_mV;
+    t.battery_ok      = st.battery_ok;
+    t.id              = st.id;
+    t.firmware        = st.firmware;
+    t.humidity        = st.humidity;
+    t.temperature_C   = st.temperature_C;
+    t.wind_dir_deg    = st.wind_dir_deg;
+    t.wind_avg_m_s    = st.wind_avg_m_s;
+    t.wind_max_m_s    = st.wind_max_m_s;
+    t.light_lux       = st.light_lux;
+    t.uvi             = st.uvi;
+    t.supercap_V      = st.supercap_V;
+
+    t.rain_daily_in   = st.rain_daily_in;
+    t.rain_event_in   = st.rain_event_in;
+    t.rain_hourly_in  = st.rain_hourly_in;
+    t.rain_weekly_in  = st.rain_weekly_in;
+    t.rain_monthly_in = st.rain_monthly_in;
+    t.rain_yearly_in  = st.rain_yearly_in;
+
+    t.rain_total_in = st.historical_total_in;
+    if (st.rain_yearly_in > st.historical_yearly_in)
+        t.rain_total_in += (st.rain_yearly_in - st.historical_yearly_in);
+    t.rain_counter_in = st.rain_counter_in;
+    t.sample_seq      = st.sample_seq;
+
+    t.have_temp         = st.have_temp;
+    t.have_hum          = st.have_hum;
+    t.have_wind         = st.have_wind;
+    t.temp_high_c       = st.temp_high_c;
+    t.temp_low_c        = st.temp_low_c;
+    t.hum_high          = st.hum_high;
+    t.hum_low           = st.hum_low;
+    t.wind_mean_m_s     = st.wind_mean_m_s;
+    t.wind_max_gust_m_s = st.wind_max_gust_m_s;
+
+    t.dew_point_c      = st.dew_point_c;
+    t.heat_index_c     = st.heat_index_c;
+    t.wind_chill_c     = st.wind_chill_c;
+    t.feels_like_c     = st.feels_like_c;
+    t.rain_rate_in_hr  = st.rain_rate_in_hr;
+    t.gust_avg_m_s     = st.gust_avg_m_s;
+    t.gust_peak_m_s    = st.gust_peak_m_s;
+    t.wind_dir_avg_deg = st.wind_dir_avg_deg;
+
+    t.last_update = st.last_update;
+    t.http_status = http_status;
+    pub.tel.store(t);
+
+    auto text = std::atomic_load(&pub.text);
+    if (!text || text->model != st.model || text->time_iso != st.last_time_iso ||
+        text->error_code != error_code || text->error_msg != error_msg) {
+        auto next = std::make_shared<StationText>();
+        next->model      = st.model;
+        next->time_iso   = st.last_time_iso;
+        next->error_code = error_code;
+        next->error_msg  = error_msg;
+        std::atomic_store(&pub.text, std::shared_ptr<const StationText>(std::move(next)));
+    }
+}
+
+// Primary station and ws90 link. Called with g_lock held.
+static void publish_primary_locked()
+{
+    publish_station_locked(g_state, g_ws90_http_status, g_ws90_error_code,
+                           g_ws90_error_msg, g_pub);
+
+    LinkTelemetry l;
+    l.http_ok   = g_ws90_http_ok;
+    l.rtlsdr_ok = g_rtlsdr_ok;
+    l.last_poll = g_ws90_last_poll;
+    l.poll      = g_poll_stats;
+    g_link.store(l);
 }
 
 // =========================================
 // Parse WS90 JSON
 // =========================================
 
-static void process_ws90_json_locked(const json &j)
+// Fold one frame, received at now, into st. Returns the rain credited by
+// this sample in inches (0 if none), or NAN if the frame had no usable
+// rain_mm.
+static double apply_ws90_json_locked(WeatherStateV2 &st, const json &j, ApplyMode mode,
+                                     std::time_t now)
 {
-    std::time_t now = std::time(nullptr);
+    bool primary = (mode == APPLY_PRIMARY);
 
     auto get_num = [&](const char *k, double d=0.0) {
         return (j.contains(k) && j[k].is_number()) ? j[k].get<double>() : d;
@@ -481,687 +1585,1201 @@ static void process_ws90_json_locked(const json &j)
     };
 
     // Basic WS90 telemetry
-    g_state.battery_mV    = get_num("battery_mV");
-    g_state.battery_ok    = get_num("battery_ok");
-    g_state.id            = get_int("id");
-    g_state.model         = get_str("model");
-    g_state.firmware      = get_int("firmware");
-    g_state.humidity      = get_num("humidity");
-    g_state.temperature_C = get_num("temperature_C");
-    g_state.wind_dir_deg  = get_num("wind_dir_deg");
-    g_state.wind_avg_m_s  = get_num("wind_avg_m_s");
-    g_state.wind_max_m_s  = get_num("wind_max_m_s");
-    g_state.light_lux     = get_num("light_lux");
-    g_state.uvi           = get_num("uvi");
-    g_state.rain_mm       = get_num("rain_mm");
-    g_state.supercap_V    = get_num("supercap_V");
-    g_state.last_time_iso = get_str("time");
-
-    if (!j.contains("rain_mm")) {
-        g_state.last_update = now;
-        return;
+    st.battery_mV    = get_num("battery_mV");
+    st.battery_ok    = get_num("battery_ok");
+    st.id            = get_int("id");
+    st.model         = get_str("model");
+    st.firmware      = get_int("firmware");
+    st.humidity      = get_num("humidity");
+    st.temperature_C = get_num("temperature_C");
+    st.wind_dir_deg  = get_num("wind_dir_deg");
+    st.wind_avg_m_s  = get_num("wind_avg_m_s");
+    st.wind_max_m_s  = get_num("wind_max_m_s");
+    st.light_lux     = get_num("light_lux");
+    st.uvi           = get_num("uvi");
+    st.rain_mm       = get_num("rain_mm");
+    st.supercap_V    = get_num("supercap_V");
+
+    // Same test as the raw store: a repeated sensor time is the same sample
+    std::string time_iso = get_str("time");
+    if (time_iso.empty() || time_iso != st.last_time_iso)
+        st.sample_seq++;
+    st.last_time_iso = time_iso;
+
+    if (!j.contains("rain_mm") || !j["rain_mm"].is_number()) {
+        st.last_update = now;
+        return NAN;
     }
 
     double rain_mm = j["rain_mm"].get<double>();
     if (rain_mm < 0 || rain_mm > 20000) {
-        g_state.last_update = now;
-        return;
+        st.last_update = now;
+        return NAN;
     }
 
-    rollover_if_needed(g_state, now);
+    bool rolled = rollover_if_needed(st, now, mode);
 
     // Track coverage of valid WS90 samples for the current day
-    if (g_state.day_first_ts == 0) {
-        g_state.day_first_ts = now;
+    if (st.day_first_ts == 0) {
+        st.day_first_ts = now;
     }
-    g_state.day_last_ts = now;
+    st.day_last_ts = now;
 
     // First valid rain sample since boot / state reset
-    if (g_state.last_rain_mm == 0.0) {
-        g_state.last_rain_mm = rain_mm;
-        g_state.last_update  = now;
-        save_state(g_state);
-        return;
+    if (st.last_rain_mm == 0.0) {
+        st.last_rain_mm = rain_mm;
+        st.last_update  = now;
+        if (primary) mark_state_dirty_locked(rolled);
+        return 0.0;
     }
 
     // Rain accumulation based on delta
-    double delta = rain_mm - g_state.last_rain_mm;
+    double delta = rain_mm - st.last_rain_mm;
+    double di    = 0.0;
     if (delta > 0.0001 && delta < 5000) {
-        double di = inches_from_mm(delta);
+        di = inches_from_mm(delta);
 
-        g_state.rain_daily_in   += di;
-        g_state.rain_monthly_in += di;
-        g_state.rain_yearly_in  += di;
-        g_state.rain_weekly_in  += di;
+        st.rain_daily_in   += di;
+        st.rain_monthly_in += di;
+        st.rain_yearly_in  += di;
+        st.rain_weekly_in  += di;
+        st.rain_counter_in += di;
 
         // rolling 1-hour rainfall
-        g_state.deltas.push_back({now, di});
-        recompute_hourly(g_state, now);
+        st.deltas.push(now, di);
 
         // event tracking
-        if (g_state.last_rain_ts == 0 ||
-            (now - g_state.last_rain_ts) > EVENT_GAP_MIN * 60) {
-            g_state.rain_event_in = 0.0;
+        if (st.last_rain_ts == 0 ||
+            (now - st.last_rain_ts) > current_config()->rain_event_gap_min * 60) {
+            st.rain_event_in = 0.0;
         }
 
-        g_state.rain_event_in += di;
-        g_state.last_rain_ts   = now;
+        st.rain_event_in += di;
+        st.last_rain_ts   = now;
     }
 
-    g_state.last_rain_mm = rain_mm;
-    g_state.last_update  = now;
+    recompute_hourly(st, now);
+
+    st.last_rain_mm = rain_mm;
+    st.last_update  = now;
 
     // High/low temperature tracking
     double tC = get_num("temperature_C", NAN);
     if (!std::isnan(tC)) {
-        if (!g_state.have_temp) {
-            g_state.temp_high_c = tC;
-            g_state.temp_low_c  = tC;
-            g_state.have_temp   = true;
+        if (!st.have_temp) {
+            st.temp_high_c = tC;
+            st.temp_low_c  = tC;
+            st.have_temp   = true;
         } else {
-            g_state.temp_high_c = std::max(g_state.temp_high_c, tC);
-            g_state.temp_low_c  = std::min(g_state.temp_low_c,  tC);
+            st.temp_high_c = std::max(st.temp_high_c, tC);
+            st.temp_low_c  = std::min(st.temp_low_c,  tC);
         }
     }
 
     // High/low humidity tracking
     double h = get_num("humidity", NAN);
     if (!std::isnan(h)) {
-        if (!g_state.have_hum) {
-            g_state.hum_high = h;
-            g_state.hum_low  = h;
-            g_state.have_hum = true;
+        if (!st.have_hum) {
+            st.hum_high = h;
+            st.hum_low  = h;
+            st.have_hum = true;
         } else {
-            g_state.hum_high = std::max(g_state.hum_high, h);
-            g_state.hum_low  = std::min(g_state.hum_low,  h);
+            st.hum_high = std::max(st.hum_high, h);
+            st.hum_low  = std::min(st.hum_low,  h);
         }
     }
 
     // High/low wind tracking (daily mean and max gust)
-    if (!std::isnan(g_state.wind_avg_m_s) && !std::isnan(g_state.wind_max_m_s)) {
-        if (!g_state.have_wind) {
-            g_state.have_wind         = true;
-            g_state.wind_mean_m_s     = g_state.wind_avg_m_s;
-            g_state.wind_max_gust_m_s = g_state.wind_max_m_s;
-            g_state.wind_sample_count = 1;
+    if (!std::isnan(st.wind_avg_m_s) && !std::isnan(st.wind_max_m_s)) {
+        if (!st.have_wind) {
+            st.have_wind         = true;
+            st.wind_mean_m_s     = st.wind_avg_m_s;
+            st.wind_max_gust_m_s = st.wind_max_m_s;
+            st.wind_sample_count = 1;
         } else {
-            std::uint64_t n = g_state.wind_sample_count;
-            g_state.wind_mean_m_s =
-                ((g_state.wind_mean_m_s * static_cast<double>(n)) + g_state.wind_avg_m_s)
+            std::uint64_t n = st.wind_sample_count;
+            st.wind_mean_m_s =
+                ((st.wind_mean_m_s * static_cast<double>(n)) + st.wind_avg_m_s)
                 / static_cast<double>(n + 1);
-            g_state.wind_sample_count = n + 1;
+            st.wind_sample_count = n + 1;
 
-            if (g_state.wind_max_m_s > g_state.wind_max_gust_m_s) {
-                g_state.wind_max_gust_m_s = g_state.wind_max_m_s;
+            if (st.wind_max_m_s > st.wind_max_gust_m_s) {
+                st.wind_max_gust_m_s = st.wind_max_m_s;
             }
         }
     }
 
-    save_state(g_state);
+    if (primary) mark_state_dirty_locked(rolled);
+    return di;
+}
+
+// =========================================
+// Derived readings
+// =========================================
+
+static double f_from_c(double c) { return c * 9.0 / 5.0 + 32.0; }
+static double c_from_f(double f) { return (f - 32.0) * 5.0 / 9.0; }
+
+// Magnus formula, same constants as the WU feeder
+static double dew_point_c(double t_c, double rh)
+{
+    rh = std::min(100.0, std::max(1.0, rh));
+    double g = std::log(rh / 100.0) + (17.625 * t_c) / (243.04 + t_c);
+    return 243.04 * g / (17.625 - g);
+}
+
+// NWS heat index (Rothfusz regression with its low/high humidity
+// adjustments), from 80 F up
+static double heat_index_f(double t, double rh)
+{
+    if (t < 80.0)
+        return NAN;
+
+    double hi = 0.5 * (t + 61.0 + (t - 68.0) * 1.2 + rh * 0.094);
+    if ((hi + t) / 2.0 < 80.0)
+        return hi;
+
+    hi = -42.379 + 2.04901523 * t + 10.14333127 * rh
+         - 0.22475541 * t * rh - 0.00683783 * t * t
+         - 0.05481717 * rh * rh + 0.00122874 * t * t * rh
+         + 0.00085282 * t * rh * rh - 0.00000199 * t * t * rh * rh;
+
+    if (rh < 13.0 && t <= 112.0)
+        hi -= ((13.0 - rh) / 4.0) * std::sqrt((17.0 - std::fabs(t - 95.0)) / 17.0);
+    else if (rh > 85.0 && t <= 87.0)
+        hi += ((rh - 85.0) / 10.0) * ((87.0 - t) / 5.0);
+    return hi;
+}
+
+// NWS wind chill, at or below 50 F with more than 3 mph of wind
+static double wind_chill_f(double t, double mph)
+{
+    if (t > 50.0 || mph <= 3.0)
+        return NAN;
+    double p = std::pow(mph, 0.16);
+    return 35.74 + 0.6215 * t - 35.75 * p + 0.4275 * t * p;
+}
+
+// Update st's derived readings after a frame that credited rain_in
+// (apply_ws90_json_locked's result) was applied at now. A new sample
+// recomputes the thermal indices and enters the gust window; every call
+// expires the windows. Runs under g_lock once per frame and touches
+// only the inline rings: no allocation.
+static void derive_locked(WeatherStateV2 &st, std::time_t now, bool new_sample,
+                          double rain_in)
+{
+    if (new_sample) {
+        double t_f = f_from_c(st.temperature_C);
+        double mph = st.wind_avg_m_s * utils::MPH_PER_M_S;
+        bool   rh  = st.humidity > 0.0;
+
+        st.dew_point_c  = rh ? dew_point_c(st.temperature_C, st.humidity) : NAN;
+        st.heat_index_c = rh ? c_from_f(heat_index_f(t_f, st.humidity)) : NAN;
+        st.wind_chill_c = c_from_f(wind_chill_f(t_f, mph));
+        st.feels_like_c = !std::isnan(st.wind_chill_c) ? st.wind_chill_c
+                        : !std::isnan(st.heat_index_c) ? st.heat_index_c
+                        : st.temperature_C;
+
+        double rad = st.wind_dir_deg * M_PI / 180.0;
+        WindAcc w;
+        w.gust_m_s = st.wind_max_m_s;
+        w.u        = st.wind_avg_m_s * std::sin(rad);
+        w.v        = st.wind_avg_m_s * std::cos(rad);
+        st.gusts.push(now, w);
+    }
+
+    if (rain_in > 0.0)
+        st.rate_deltas.push(now, rain_in);
+    st.rate_deltas.expire(now, RAIN_RATE_WINDOW_SEC);
+    st.rain_rate_in_hr = st.rate_deltas.empty() ? 0.0
+                       : std::max(0.0, st.rate_deltas.sum()) * 3600.0 / RAIN_RATE_WINDOW_SEC;
+
+    // Nothing entered or left the gust window: the stats stand
+    size_t n = st.gusts.size();
+    st.gusts.expire(now, GUST_WINDOW_SEC);
+    if (!new_sample && st.gusts.size() == n)
+        return;
+
+    if (st.gusts.empty()) {
+        st.gust_avg_m_s = st.gust_peak_m_s = st.wind_dir_avg_deg = NAN;
+        return;
+    }
+
+    // The peak is a scan of at most DERIVED_CAPACITY entries, once per sample
+    const WindAcc &sum = st.gusts.sum();
+    double peak = 0.0;
+    st.gusts.for_each([&](const GustWindow::Entry &e) {
+        peak = std::max(peak, e.value.gust_m_s);
+    });
+    st.gust_avg_m_s  = std::max(0.0, sum.gust_m_s / (double)st.gusts.size());
+    st.gust_peak_m_s = peak;
+
+    // Dead calm over the whole window has no direction
+    if (std::hypot(sum.u, sum.v) < 1e-6) {
+        st.wind_dir_avg_deg = NAN;
+    } else {
+        double deg = std::atan2(sum.u, sum.v) * 180.0 / M_PI;
+        st.wind_dir_avg_deg = std::fmod(deg + 360.0, 360.0);
+    }
+}
+
+// False if a reading the frame carries has the wrong type. Checked
+// before a frame is applied, so a malformed one changes nothing.
+static bool frame_fields_ok(const json &j)
+{
+    static const char *const NUMERIC[] = {
+        "id", "firmware", "battery_mV", "battery_ok", "humidity", "temperature_C",
+        "wind_dir_deg", "wind_avg_m_s", "wind_max_m_s", "light_lux", "uvi",
+        "rain_mm", "supercap_V",
+    };
+    for (const char *k : NUMERIC) {
+        auto it = j.find(k);
+        if (it != j.end() && !it->is_number())
+            return false;
+    }
+    for (const char *k : { "model", "time" }) {
+        auto it = j.find(k);
+        if (it != j.end() && !it->is_string())
+            return false;
+    }
+    return true;
+}
+
+static int frame_station_id(const json &j)
+{
+    return (j.contains("id") && j["id"].is_number_integer()) ? j["id"].get<int>() : 0;
+}
+
+// ws90_station_id 0 keeps the old behavior: every frame is the primary's
+static bool is_primary_frame(const json &j)
+{
+    int id = current_config()->ws90_station_id;
+    return id == 0 || frame_station_id(j) == id;
+}
+
+// Apply a frame to a secondary station. Returns false if its id is not
+// one of ws90_stations.
+static bool process_station_json_locked(const json &j)
+{
+    auto it = g_stations.find(frame_station_id(j));
+    if (it == g_stations.end())
+        return false;
+
+    StationV2 &sv = it->second;
+    std::uint64_t seq = sv.st.sample_seq;
+    std::time_t   now = std::time(nullptr);
+    double rain_in = apply_ws90_json_locked(sv.st, j, APPLY_STATION, now);
+    derive_locked(sv.st, now, sv.st.sample_seq != seq, rain_in);
+    sv.http_status = 200;
+    sv.error_code.clear();
+    publish_station_locked(sv.st, sv.http_status, sv.error_code, std::string(), sv.pub);
+    return true;
+}
+
+static void process_ws90_json_locked(const json &j)
+{
+    // ws90 keeps serving its last frame until it goes stale; only a
+    // new sensor timestamp is a new sample for the raw store
+    std::uint64_t seq = g_state.sample_seq;
+
+    std::time_t now = std::time(nullptr);
+    double rain_in = apply_ws90_json_locked(g_state, j, APPLY_PRIMARY, now);
+    derive_locked(g_state, now, g_state.sample_seq != seq, rain_in);
+
+    if (g_state.sample_seq != seq) {
+        metrics_v2::add(metrics_v2::C_SAMPLES);
+        metrics_v2::set_sample_ts(g_state.last_update);
+
+        samples_v2::Sample smp;
+        smp.ts            = (std::int64_t)g_state.last_update;
+        smp.temperature_c = g_state.temperature_C;
+        smp.humidity      = g_state.humidity;
+        smp.wind_avg_m_s  = g_state.wind_avg_m_s;
+        smp.wind_max_m_s  = g_state.wind_max_m_s;
+        smp.wind_dir_deg  = g_state.wind_dir_deg;
+        smp.light_lux     = g_state.light_lux;
+        smp.uvi           = g_state.uvi;
+        smp.rain_in       = rain_in;
+        samples_v2::record(smp);
+    }
+}
+
+// =========================================
+// Snapshot publish
+// =========================================
+
+// Rebuild and publish the /api/v2/weather document from the published
+// readings. Called without g_lock, once per poll cycle and per push, so
+// age_sec/stale/astro stay current to within ws90_poll_interval_sec even when
+// no new sample arrived. Builds are serialized; each reads the newest
+// readings, so the last one to run always publishes the latest state.
+static void publish_snapshot()
+{
+    std::lock_guard<std::mutex> guard(g_publish_mu);
+
+    auto snap = std::make_shared<state_v2::Snapshot>();
+    snap->version = ++g_snapshot_version;
+    snap->etag    = "\"w" + std::to_string((long long)g_boot_ts) +
+                    "-" + std::to_string(snap->version) + "\"";
+
+    json out = state_v2::build_current_json();
+    out["snapshot_version"] = snap->version;
+    snap->body = out.dump();
+
+    std::shared_ptr<const state_v2::Snapshot> pub(std::move(snap));
+    std::atomic_store(&g_snapshot, pub);
+
+    // Wake /api/v2/stream clients
+    stream_v2::notify(pub);
 }
 
 // =========================================
 // Poller thread
 // =========================================
 
-struct MemChunk {
-    char  *data = nullptr;
-    size_t size = 0;
+// Receive buffer, reused by every poll and only regrown when
+// ws90_max_body_size goes up. Bodies longer than limit - 1 abort the
+// transfer (ws90 frames are < 1 KB).
+struct RecvBuf {
+    std::vector<char> data;
+    size_t size  = 0;
+    size_t limit = 0;
 };
 
 static size_t curl_write_cb(void *contents, size_t size, size_t nmemb, void *userp)
 {
     size_t realsize = size * nmemb;
-    MemChunk *m = static_cast<MemChunk*>(userp);
+    RecvBuf *m = static_cast<RecvBuf*>(userp);
 
-    if (m->size + realsize >= MAX_BODY_SIZE - 1)
-        realsize = MAX_BODY_SIZE - 1 - m->size;
+    if (m->size + realsize >= m->limit - 1)
+        realsize = m->limit - 1 - m->size;
 
     if (realsize == 0)
         return 0;
 
-    char *ptr = static_cast<char*>(realloc(m->data, m->size + realsize + 1));
-    if (!ptr)
-        return 0;
-
-    m->data = ptr;
-    memcpy(m->data + m->size, contents, realsize);
+    memcpy(m->data.data() + m->size, contents, realsize);
     m->size += realsize;
     m->data[m->size] = 0;
 
     return realsize;
 }
 
-static void poller_thread_func()
+// The poller's one easy handle. curl keeps its connection cache and
+// DNS cache on the handle, so reusing it lets keep-alive work.
+static CURL *make_poll_handle(RecvBuf *buf)
 {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    CURL *c = curl_easy_init();
+    if (!c) return nullptr;
+
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, curl_write_cb);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, (void*)buf);
+    curl_easy_setopt(c, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, 3L);
+    curl_easy_setopt(c, CURLOPT_FAILONERROR, 0L);  // <-- IMPORTANT: let us see 503 + body
+    curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 0L);
+    curl_easy_setopt(c, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(c, CURLOPT_TCP_KEEPALIVE, 1L);
+    return c;
+}
 
-    while (g_running.load()) {
-        CURL *c = curl_easy_init();
-        if (c) {
-            MemChunk chunk;
-
-            curl_easy_setopt(c, CURLOPT_URL, WS90_URL);
-            curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, curl_write_cb);
-            curl_easy_setopt(c, CURLOPT_WRITEDATA, (void*)&chunk);
-            curl_easy_setopt(c, CURLOPT_TIMEOUT, 5L);
-            curl_easy_setopt(c, CURLOPT_FAILONERROR, 0L);  // <-- IMPORTANT: let us see 503 + body
-            curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 0L);
-            curl_easy_setopt(c, CURLOPT_NOSIGNAL, 1L);
-
-            CURLcode   res       = curl_easy_perform(c);
-            std::time_t now      = std::time(nullptr);
-            long       http_code = 0;
-
-            if (res == CURLE_OK) {
-                curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &http_code);
+// ws90_api URL for one station: /ws90/<id>, or the newest frame of any
+static std::string station_url(const std::string &base, int id)
+{
+    std::string url = base;
+    if (id != 0) url += "/ws90/" + std::to_string(id);
+    return url;
+}
+
+// One GET against ws90 (poll mode)
+static void poll_ws90_once(CURL *c, RecvBuf &chunk, const std::string &url)
+{
+    chunk.size    = 0;
+    chunk.data[0] = 0;
+    curl_easy_setopt(c, CURLOPT_URL, url.c_str());
+
+    CURLcode   res       = curl_easy_perform(c);
+    std::time_t now      = std::time(nullptr);
+    long       http_code = 0;
+
+    curl_off_t connect_us = 0, total_us = 0;
+    long       new_conns  = 0;
+    curl_easy_getinfo(c, CURLINFO_CONNECT_TIME_T, &connect_us);
+    curl_easy_getinfo(c, CURLINFO_TOTAL_TIME_T,   &total_us);
+    curl_easy_getinfo(c, CURLINFO_NUM_CONNECTS,   &new_conns);
+
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &http_code);
+    }
+
+    // Parse before taking g_lock: the lock only covers applying the result
+    json body;
+    bool parsed = false;
+    if (res == CURLE_OK && chunk.size > 0) {
+        body   = json::parse(chunk.data.data(), chunk.data.data() + chunk.size, nullptr, false);
+        parsed = !body.is_discarded();
+    }
+
+    {
+        metrics_v2::TimedLock guard(g_lock);
+
+        g_ws90_last_poll   = now;
+        g_ws90_http_status = http_code;
+
+        g_poll_stats.count++;
+        g_poll_stats.connect_ms = connect_us / 1000.0;
+        g_poll_stats.total_ms   = total_us / 1000.0;
+        g_poll_stats.reused     = (res == CURLE_OK && new_conns == 0);
+        if (g_poll_stats.reused) g_poll_stats.reused_count++;
+
+        if (res == CURLE_OK) {
+            metrics_v2::add(metrics_v2::C_POLLS);
+            if (g_poll_stats.reused) metrics_v2::add(metrics_v2::C_POLLS_REUSED);
+            metrics_v2::observe(metrics_v2::T_POLL_CONNECT, (std::uint64_t)connect_us * 1000);
+            metrics_v2::observe(metrics_v2::T_POLL_TOTAL,   (std::uint64_t)total_us * 1000);
+        }
+        if (res != CURLE_OK || http_code != 200)
+            metrics_v2::add(metrics_v2::C_POLL_ERRORS);
+
+        if (res != CURLE_OK) {
+            // Transport-level failure: ws90 likely crashed / unreachable
+            g_ws90_http_ok      = false;
+            g_rtlsdr_ok         = false;
+            g_ws90_error_code   = "curl_error";
+            g_ws90_error_msg    = curl_easy_strerror(res);
+        } else if (http_code == 200 && chunk.size > 0) {
+            // Normal good sample
+            bool ok = parsed && body.is_object() && frame_fields_ok(body);
+            if (ok) {
+                try {
+                    process_ws90_json_locked(body);
+                } catch (...) {
+                    ok = false;
+                }
             }
 
-            {
-                std::lock_guard<std::mutex> guard(g_lock);
-
-                g_ws90_last_poll   = now;
-                g_ws90_http_status = http_code;
-
-                if (res != CURLE_OK) {
-                    // Transport-level failure: ws90 likely crashed / unreachable
-                    g_ws90_http_ok      = false;
-                    g_rtlsdr_ok         = false;
-                    g_ws90_error_code   = "curl_error";
-                    g_ws90_error_msg    = curl_easy_strerror(res);
-                } else if (http_code == 200 && chunk.size > 0) {
-                    // Normal good sample
-                    try {
-                        json j = json::parse(chunk.data);
-                        process_ws90_json_locked(j);
-
-                        g_ws90_http_ok    = true;
-                        g_rtlsdr_ok       = true;   // ws90 + SDR both look alive
-                        g_ws90_error_code.clear();
-                        g_ws90_error_msg.clear();
-                    } catch (...) {
-                        g_ws90_http_ok    = true;   // HTTP worked
-                        g_rtlsdr_ok       = false;  // but payload is garbage
-                        g_ws90_error_code = "parse_error";
-                        g_ws90_error_msg  = "invalid JSON from ws90";
-                    }
+            if (ok) {
+                g_ws90_http_ok    = true;
+                g_rtlsdr_ok       = true;   // ws90 + SDR both look alive
+                g_ws90_error_code.clear();
+                g_ws90_error_msg.clear();
+            } else {
+                g_ws90_http_ok    = true;   // HTTP worked
+                g_rtlsdr_ok       = false;  // but payload is garbage
+                g_ws90_error_code = "parse_error";
+                g_ws90_error_msg  = "invalid JSON from ws90";
+            }
+        } else {
+            // HTTP error from ws90: try to parse {"error": "...", "message": "..."}
+            std::string err_code;
+            std::string err_msg;
+
+            if (chunk.size > 0) {
+                if (parsed && body.is_object()) {
+                    if (body.contains("error") && body["error"].is_string())
+                        err_code = body["error"].get<std::string>();
+                    if (body.contains("message") && body["message"].is_string())
+                        err_msg = body["message"].get<std::string>();
                 } else {
-                    // HTTP error from ws90: try to parse {"error": "...", "message": "..."}
-                    std::string err_code;
-                    std::string err_msg;
-
-                    if (chunk.size > 0) {
-                        try {
-                            json ej = json::parse(chunk.data);
-                            if (ej.contains("error") && ej["error"].is_string())
-                                err_code = ej["error"].get<std::string>();
-                            if (ej.contains("message") && ej["message"].is_string())
-                                err_msg = ej["message"].get<std::string>();
-                        } catch (...) {
-                            err_msg = "non-200 from ws90 with non-JSON body";
-                        }
-                    }
-
-                    g_ws90_http_ok = (http_code != 0);
-
-                    // Classify what likely died
-                    if (http_code == 503 && err_code == "stale_data") {
-                        // ws90 still answering; RTL-SDR stream stalled or dead
-                        g_rtlsdr_ok = false;
-                    } else if (http_code == 503 && err_code == "no_data") {
-                        // startup / no samples yet; SDR may not be feeding yet
-                        g_rtlsdr_ok = false;
-                    } else {
-                        // Unknown HTTP error; be conservative
-                        g_rtlsdr_ok = false;
-                    }
-
-                    if (!err_code.empty())
-                        g_ws90_error_code = err_code;
-                    else
-                        g_ws90_error_code = "http_" + std::to_string(http_code);
-
-                    g_ws90_error_msg = err_msg;
+                    err_msg = "non-200 from ws90 with non-JSON body";
                 }
             }
 
-            curl_easy_cleanup(c);
-            if (chunk.data) free(chunk.data);
+            g_ws90_http_ok = (http_code != 0);
+
+            // Classify what likely died
+            if (http_code == 503 && err_code == "stale_data") {
+                // ws90 still answering; RTL-SDR stream stalled or dead
+                g_rtlsdr_ok = false;
+            } else if (http_code == 503 && err_code == "no_data") {
+                // startup / no samples yet; SDR may not be feeding yet
+                g_rtlsdr_ok = false;
+            } else {
+                // Unknown HTTP error; be conservative
+                g_rtlsdr_ok = false;
+            }
+
+            if (!err_code.empty())
+                g_ws90_error_code = err_code;
+            else
+                g_ws90_error_code = "http_" + std::to_string(http_code);
+
+            g_ws90_error_msg = err_msg;
         }
 
-        std::this_thread::sleep_for(std::chrono::seconds(POLL_INTERVAL_SEC));
+        publish_primary_locked();
     }
 
-    curl_global_cleanup();
+    publish_snapshot();
 }
 
+// One GET for a secondary station, on the same handle. Failures only
+// mark that station; the primary's ws90_status is left alone.
+static void poll_station_once(CURL *c, RecvBuf &chunk, int id, const std::string &url)
+{
+    chunk.size    = 0;
+    chunk.data[0] = 0;
+    curl_easy_setopt(c, CURLOPT_URL, url.c_str());
 
-// =========================================
-// API JSON BUILD
-// =========================================
+    CURLcode res       = curl_easy_perform(c);
+    long     http_code = 0;
+    if (res == CURLE_OK)
+        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &http_code);
 
-namespace state_v2 {
+    json j;
+    if (http_code == 200 && chunk.size > 0)
+        j = json::parse(chunk.data.data(), chunk.data.data() + chunk.size, nullptr, false);
 
-void init() {
-    load_config();
-    load_state(get_state_path(), g_state);
-    init_db();
-    std::thread p(poller_thread_func);
-    p.detach();
+    metrics_v2::TimedLock guard(g_lock);
+    auto it = g_stations.find(id);
+    if (it == g_stations.end())
+        return;
+
+    if (j.is_object() && frame_station_id(j) == id) {
+        process_station_json_locked(j);
+        return;
+    }
+
+    StationV2 &sv = it->second;
+    sv.http_status = http_code;
+    if (res != CURLE_OK)
+        sv.error_code = "curl_error";
+    else if (http_code == 200)
+        sv.error_code = "parse_error";
+    else
+        sv.error_code = "http_" + std::to_string(http_code);
+    publish_station_locked(sv.st, sv.http_status, sv.error_code, std::string(), sv.pub);
 }
 
-json build_current_json()
+// Push mode: no HTTP traffic to ws90. Samples arrive on POST /ws90;
+// this only flags a silent sender.
+static void check_push_staleness_locked(std::time_t now)
 {
-    json out;
+    if (g_ws90_last_poll != 0 && now - g_ws90_last_poll <= PUSH_STALE_SEC)
+        return;
 
-    out["api_version"] = "2.1.0";
+    g_ws90_http_ok     = false;
+    g_rtlsdr_ok        = false;
+    g_ws90_error_code  = g_ws90_last_poll ? "stale_data" : "no_data";
+    g_ws90_error_msg   = "no push from ws90 in " + std::to_string(PUSH_STALE_SEC) + " s";
+}
 
-    out["battery_mV"]      = g_state.battery_mV;
-    out["battery_ok"]      = g_state.battery_ok;
-    out["id"]              = g_state.id;
-    out["model"]           = g_state.model;
-    out["firmware"]        = g_state.firmware;
-
-    out["humidity"]        = g_state.humidity;
-    out["temperature_F"]   = g_state.temperature_C * 9.0/5.0 + 32.0;
-    out["wind_dir_deg"]    = g_state.wind_dir_deg;
-    out["wind_avg_m_s"]    = g_state.wind_avg_m_s;
-    out["wind_max_m_s"]    = g_state.wind_max_m_s;
-    out["light_lux"]       = g_state.light_lux;
-    out["uvi"]             = g_state.uvi;
-    out["supercap_V"]      = g_state.supercap_V;
-    out["time"]            = g_state.last_time_iso;
-
-    nlohmann::json astro = compute_solar_and_moon(std::time(nullptr));
-    out["astro"] = astro;
+static void poller_thread_func()
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // The station set and mode are fixed at startup; ws90_url, the
+    // interval and the body limit follow config reloads
+    auto cfg = current_config();
+    const bool push = (cfg->ws90_mode == "push");
+    const int  primary_id = cfg->ws90_station_id;
+    std::vector<int> station_ids;
+    for (int id : cfg->ws90_stations)
+        if (id != primary_id)
+            station_ids.push_back(id);
+
+    // Allocated once; steady-state polls reuse both
+    static RecvBuf buf;
+    CURL *c = nullptr;
+
+    // Rebuilt only when ws90_url changes
+    std::string base;
+    std::string primary_url;
+    std::vector<std::pair<int, std::string>> station_urls;
+
+    while (g_running.load()) {
+        cfg = current_config();
+
+        if (push) {
+            // Still tick so age_sec/stale/astro in the snapshot stay current
+            {
+                metrics_v2::TimedLock guard(g_lock);
+                check_push_staleness_locked(std::time(nullptr));
+                publish_primary_locked();
+            }
+            publish_snapshot();
+        } else {
+            if (base != cfg->ws90_url) {
+                base        = cfg->ws90_url;
+                primary_url = station_url(base, primary_id);
+                station_urls.clear();
+                for (int id : station_ids)
+                    station_urls.emplace_back(id, station_url(base, id));
+            }
+            buf.limit = (size_t)cfg->ws90_max_body_size;
+            if (buf.data.size() < buf.limit)
+                buf.data.resize(buf.limit);
+
+            if (!c) c = make_poll_handle(&buf);
+            if (c) {
+                poll_ws90_once(c, buf, primary_url);
+                for (const auto &su : station_urls)
+                    poll_station_once(c, buf, su.first, su.second);
+            }
+        }
+
+        std::unique_lock<std::mutex> lk(g_poll_mu);
+        g_poll_cv.wait_for(lk, std::chrono::seconds(cfg->ws90_poll_interval_sec),
+                           [] { return !g_running.load() || g_poll_wake; });
+        g_poll_wake = false;
+    }
+
+    if (c) curl_easy_cleanup(c);
+    curl_global_cleanup();
+}
+
+// Config watcher callback. The astro caches are keyed on lat/lon but
+// are dropped anyway; the snapshot is rebuilt so clients see the new
+// config now, and the poll sleep is cut short so a new interval or
+// ws90_url applies from this cycle rather than after the old interval.
+static void on_config_reload()
+{
+    astro_invalidate();
+    publish_snapshot();
+    {
+        std::lock_guard<std::mutex> lk(g_poll_mu);
+        g_poll_wake = true;
+    }
+    g_poll_cv.notify_all();
+}
+
+
+// =========================================
+// API JSON BUILD
+// =========================================
+
+// Readings, running rain totals and the day's highs/lows of one station
+static void station_json(const StationTelemetry &st, const StationText &text, json &out)
+{
+    out["battery_mV"]      = st.battery_mV;
+    out["battery_ok"]      = st.battery_ok;
+    out["id"]              = st.id;
+    out["model"]           = text.model;
+    out["firmware"]        = st.firmware;
+
+    out["humidity"]        = st.humidity;
+    out["temperature_F"]   = st.temperature_C * 9.0/5.0 + 32.0;
+    out["wind_dir_deg"]    = st.wind_dir_deg;
+    out["wind_avg_m_s"]    = st.wind_avg_m_s;
+    out["wind_max_m_s"]    = st.wind_max_m_s;
+    out["light_lux"]       = st.light_lux;
+    out["uvi"]             = st.uvi;
+    out["supercap_V"]      = st.supercap_V;
+    out["time"]            = text.time_iso;
 
     json rain;
-    rain["daily_in"]    = g_state.rain_daily_in;
-    rain["event_in"]    = g_state.rain_event_in;
-    rain["hourly_in"]   = g_state.rain_hourly_in;
-    rain["weekly_in"]   = g_state.rain_weekly_in;
-    rain["monthly_in"]  = g_state.rain_monthly_in;
-    rain["yearly_in"]   = g_state.rain_yearly_in;
-
-    double total_in = g_state.historical_total_in;
-    if (g_state.rain_yearly_in > g_state.historical_yearly_in)
-        total_in += (g_state.rain_yearly_in - g_state.historical_yearly_in);
-
-    rain["total_in"] = total_in;
+    rain["daily_in"]    = st.rain_daily_in;
+    rain["event_in"]    = st.rain_event_in;
+    rain["hourly_in"]   = st.rain_hourly_in;
+    rain["weekly_in"]   = st.rain_weekly_in;
+    rain["monthly_in"]  = st.rain_monthly_in;
+    rain["yearly_in"]   = st.rain_yearly_in;
+
+    rain["total_in"]    = st.rain_total_in;
+    rain["counter_in"]  = st.rain_counter_in;
     out["rain"] = rain;
+    out["sample_seq"] = st.sample_seq;
 
     json daily;
-    if (g_state.have_temp) {
-        daily["temp_high_F"] = g_state.temp_high_c * 9.0/5.0 + 32.0;
-        daily["temp_low_F"]  = g_state.temp_low_c  * 9.0/5.0 + 32.0;
+    if (st.have_temp) {
+        daily["temp_high_F"] = st.temp_high_c * 9.0/5.0 + 32.0;
+        daily["temp_low_F"]  = st.temp_low_c  * 9.0/5.0 + 32.0;
     } else {
         daily["temp_high_F"] = nullptr;
         daily["temp_low_F"]  = nullptr;
     }
 
-    if (g_state.have_hum) {
-        daily["humidity_high"] = g_state.hum_high;
-        daily["humidity_low"]  = g_state.hum_low;
+    if (st.have_hum) {
+        daily["humidity_high"] = st.hum_high;
+        daily["humidity_low"]  = st.hum_low;
     } else {
         daily["humidity_high"] = nullptr;
         daily["humidity_low"]  = nullptr;
     }
 
     // Daily wind summary (mean and max gust, mph)
-    if (g_state.have_wind) {
-        daily["wind_mean_mph"]     = g_state.wind_mean_m_s * 2.2369;
-        daily["wind_gust_max_mph"] = g_state.wind_max_gust_m_s * 2.2369;
+    if (st.have_wind) {
+        daily["wind_mean_mph"]     = st.wind_mean_m_s * utils::MPH_PER_M_S;
+        daily["wind_gust_max_mph"] = st.wind_max_gust_m_s * utils::MPH_PER_M_S;
     } else {
         daily["wind_mean_mph"]     = nullptr;
         daily["wind_gust_max_mph"] = nullptr;
     }
 
-    daily["meaningful"] = (g_state.have_temp || g_state.have_hum || g_state.have_wind);
+    daily["meaningful"] = (st.have_temp || st.have_hum || st.have_wind);
     out["daily"] = daily;
 
-    // out["rain_daily_in"]   = g_state.rain_daily_in;
-    // out["rain_event_in"]   = g_state.rain_event_in;
-    // out["rain_hourly_in"]  = g_state.rain_hourly_in;
-    // out["rain_weekly_in"]  = g_state.rain_weekly_in;
-    // out["rain_monthly_in"] = g_state.rain_monthly_in;
-    // out["rain_yearly_in"]  = g_state.rain_yearly_in;
+    // Computed at ingest; null where undefined (see derive_locked)
+    auto f_or_null   = [](double c) { return std::isnan(c) ? json(nullptr) : json(f_from_c(c)); };
+    auto mph_or_null = [](double v) { return std::isnan(v) ? json(nullptr) : json(v * utils::MPH_PER_M_S); };
+
+    json derived;
+    derived["dew_point_F"]       = f_or_null(st.dew_point_c);
+    derived["heat_index_F"]      = f_or_null(st.heat_index_c);
+    derived["wind_chill_F"]      = f_or_null(st.wind_chill_c);
+    derived["feels_like_F"]      = f_or_null(st.feels_like_c);
+    derived["rain_rate_in_hr"]   = st.rain_rate_in_hr;
+    derived["gust_10m_avg_mph"]  = mph_or_null(st.gust_avg_m_s);
+    derived["gust_10m_peak_mph"] = mph_or_null(st.gust_peak_m_s);
+    derived["wind_dir_10m_deg"]  = std::isnan(st.wind_dir_avg_deg) ? json(nullptr)
+                                                                   : json(st.wind_dir_avg_deg);
+    out["derived"] = derived;
+}
 
-    std::time_t now   = std::time(nullptr);
-    int         age   = g_state.last_update ? (int)(now - g_state.last_update) : -1;
-    bool        stale = (g_state.last_update != 0 && age > 60);  // adjust threshold to taste
+// =========================================
+// Backfill
+// =========================================
 
-    json ws;
-    ws["http_ok"]        = g_ws90_http_ok;
-    ws["rtlsdr_ok"]      = g_rtlsdr_ok;
-    ws["last_poll_ts"]   = (long long)g_ws90_last_poll;
-    ws["last_update_ts"] = (long long)g_state.last_update;
-    ws["age_sec"]        = age;
-    ws["stale"]          = stale;
-    ws["http_status"]    = g_ws90_http_status;
+static const size_t BACKFILL_BATCH = 4096;     // samples per import() call
 
-    if (!g_ws90_error_code.empty())
-        ws["error"] = g_ws90_error_code;
-    if (!g_ws90_error_msg.empty())
-        ws["error_message"] = g_ws90_error_msg;
+// rtl_433 "time" to unix seconds: "YYYY-MM-DD HH:MM:SS" or the ISO "T"
+// form, with an optional fraction and zone (Z, +HH:MM, +HHMM), or unix
+// seconds (-M time:unix). A time without a zone is local, or UTC when
+// utc is set.
+static bool parse_frame_time(const json &j, bool utc, std::time_t &out)
+{
+    auto it = j.find("time");
+    if (it == j.end())
+        return false;
+    if (it->is_number()) {
+        out = (std::time_t)it->get<double>();
+        return out > 0;
+    }
+    if (!it->is_string())
+        return false;
+
+    const std::string &s = it->get_ref<const std::string &>();
+    const char *p = s.c_str();
+    if (s.find_first_of("-:") == std::string::npos) {
+        char *end = nullptr;
+        double v = std::strtod(p, &end);
+        out = (std::time_t)v;
+        return end != p && *end == '\0' && out > 0;
+    }
 
-    out["ws90_status"] = ws;
+    std::tm tm{};
+    int n = 0;
+    if (std::sscanf(p, "%4d-%2d-%2d%*1[ T]%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &n) != 6 || n == 0)
+        return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon  -= 1;
+    p += n;
+    if (*p == '.')
+        for (p++; *p >= '0' && *p <= '9'; p++) {}
+
+    if (*p == '\0') {
+        tm.tm_isdst = -1;
+        out = utc ? timegm(&tm) : std::mktime(&tm);
+        return out > 0;
+    }
 
-    return out;
+    long offset = 0;
+    if (*p == '+' || *p == '-') {
+        int hh = 0, mm = 0;
+        if (std::sscanf(p + 1, "%2d:%2d", &hh, &mm) != 2 &&
+            std::sscanf(p + 1, "%2d%2d", &hh, &mm) != 2)
+            return false;
+        offset = (*p == '-' ? -1 : 1) * (hh * 3600L + mm * 60L);
+    } else if (!(p[0] == 'Z' && p[1] == '\0')) {
+        return false;
+    }
+    out = timegm(&tm) - offset;
+    return out > 0;
 }
 
-std::string current_weather_json() {
-    std::lock_guard<std::mutex> g(g_lock);
-    return build_current_json().dump();
+// Raw text of the "time" value in an rtl_433 line, without parsing it
+static bool frame_time_text(const std::string &line, std::string &out)
+{
+    size_t pos = line.find("\"time\"");
+    if (pos == std::string::npos)
+        return false;
+    pos = line.find(':', pos + 6);
+    if (pos == std::string::npos)
+        return false;
+    size_t end = line.find_first_of(",}", pos + 1);
+    out.assign(line, pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+    return true;
 }
 
-std::string history_temperature_json(int days, int limit, int offset) {
-    json out;
-    out["days"] = json::array();
-    if (!g_db) return out.dump();
-
-    // Modes:
-    //  simple:     no params => full history, no filter, no limit
-    //  time_only:  days only => time filter, no limit/offset
-    //  paged:      any limit/offset => paging, optional time filter
-    bool simple    = (days < 0 && limit < 0 && offset < 0);
-    bool time_only = (days >= 0 && limit < 0 && offset < 0);
-    bool paged     = !simple && !time_only;
-
-    std::string sql;
-
-    if (simple) {
-        sql =
-            "SELECT day_ts, temp_high_c, temp_low_c "
-            "FROM daily_weather "
-            "ORDER BY day_ts";
-
-    } else if (time_only) {
-        if (days == 0) {
-            // days=0 with no limit/offset -> same as simple
-            sql =
-                "SELECT day_ts, temp_high_c, temp_low_c "
-                "FROM daily_weather "
-                "ORDER BY day_ts";
-        } else {
-            // days only -> time filter, no limit/offset
-            sql =
-                "SELECT day_ts, temp_high_c, temp_low_c "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts";
-        }
+static long long count_daily_rows()
+{
+    long long n = 0;
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(g_db, "SELECT COUNT(*) FROM daily_weather", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            n = (long long)sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return n;
+}
 
-    } else { // paged
-        bool use_since = (days > 0);
+namespace state_v2 {
 
-        if (use_since) {
-            sql =
-                "SELECT day_ts, temp_high_c, temp_low_c "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts "
-                "LIMIT ?2 OFFSET ?3";
-        } else {
-            sql =
-                "SELECT day_ts, temp_high_c, temp_low_c "
-                "FROM daily_weather "
-                "ORDER BY day_ts "
-                "LIMIT ?1 OFFSET ?2";
-        }
+void init() {
+    load_config();
+    load_state(g_state);
+    auto cfg = current_config();
+    for (int id : cfg->ws90_stations) {
+        if (id == cfg->ws90_station_id) continue;
+        // Running totals start at boot: no historical seed
+        WeatherStateV2 &st = g_stations[id].st;
+        init_state_defaults(st);
+        st.last_update           = 0;
+        st.historical_total_in   = 0.0;
+        st.historical_yearly_in  = 0.0;
+        st.historical_monthly_in = 0.0;
+        st.historical_weekly_in  = 0.0;
     }
+    init_db();
+    samples_v2::init(get_db_path());
+    {
+        metrics_v2::TimedLock guard(g_lock);
+        publish_primary_locked();
+        for (auto &kv : g_stations)
+            publish_station_locked(kv.second.st, 0, std::string(), std::string(), kv.second.pub);
+    }
+    publish_snapshot();
+    g_persister = std::thread(persist_thread_func);
+    g_poller    = std::thread(poller_thread_func);
+    config_watch_start("config.json", on_config_reload);
+}
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(g_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
-        return out.dump();
-
-    // Bind params only where needed
-    if (time_only && days > 0) {
-        std::time_t now_ts   = std::time(nullptr);
-        std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
-        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(since_ts));
-
-    } else if (paged) {
-        int bind_idx = 1;
-        bool use_since = (days > 0);
-
-        if (use_since) {
-            std::time_t now_ts   = std::time(nullptr);
-            std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
-
-            sqlite3_bind_int64(stmt, bind_idx++, static_cast<sqlite3_int64>(since_ts));
-            sqlite3_bind_int(stmt,   bind_idx++, limit);
-            sqlite3_bind_int(stmt,   bind_idx++, offset);
-        } else {
-            sqlite3_bind_int(stmt, bind_idx++, limit);
-            sqlite3_bind_int(stmt, bind_idx++, offset);
-        }
+void shutdown() {
+    config_watch_stop();
+
+    // Stop ingest first so the final flush sees the last state
+    {
+        std::lock_guard<std::mutex> lk(g_poll_mu);
+        g_running = false;
     }
+    g_poll_cv.notify_all();
+    if (g_poller.joinable()) g_poller.join();
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::time_t ts = sqlite3_column_int64(stmt, 0);
-        double hi = (sqlite3_column_type(stmt,1)==SQLITE_NULL)
-                    ? NAN : sqlite3_column_double(stmt,1);
-        double lo = (sqlite3_column_type(stmt,2)==SQLITE_NULL)
-                    ? NAN : sqlite3_column_double(stmt,2);
-
-        json row;
-        row["day"] = static_cast<long long>(ts);
-
-        if (std::isnan(hi) || std::isnan(lo)) {
-            row["temp_high_F"] = nullptr;
-            row["temp_low_F"]  = nullptr;
-        } else {
-            double hiF = hi * 9.0/5.0 + 32.0;
-            double loF = lo * 9.0/5.0 + 32.0;
-            row["temp_high_F"] = hiF;
-            row["temp_low_F"]  = loF;
-        }
+    samples_v2::shutdown();
 
-        out["days"].push_back(row);
+    {
+        metrics_v2::TimedLock guard(g_lock);
+        mark_state_dirty_locked(false);     // the final write always happens
+    }
+    {
+        std::lock_guard<std::mutex> lk(g_persist_lock);
+        g_persist_stop = true;
     }
+    g_persist_cv.notify_all();
+    if (g_persister.joinable()) g_persister.join();
 
-    sqlite3_finalize(stmt);
-    return out.dump();
+    close_history_reader();
+    if (g_db) {
+        sqlite3_close(g_db);
+        g_db = nullptr;
+    }
 }
 
-std::string history_humidity_json(int days, int limit, int offset) {
+json build_current_json()
+{
     json out;
-    out["days"] = json::array();
-    if (!g_db) return out.dump();
-
-    bool simple    = (days < 0 && limit < 0 && offset < 0);
-    bool time_only = (days >= 0 && limit < 0 && offset < 0);
-    bool paged     = !simple && !time_only;
-
-    std::string sql;
-
-    if (simple) {
-        sql =
-            "SELECT day_ts, humidity_high, humidity_low "
-            "FROM daily_weather "
-            "ORDER BY day_ts";
-
-    } else if (time_only) {
-        if (days == 0) {
-            sql =
-                "SELECT day_ts, humidity_high, humidity_low "
-                "FROM daily_weather "
-                "ORDER BY day_ts";
-        } else {
-            sql =
-                "SELECT day_ts, humidity_high, humidity_low "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts";
-        }
 
-    } else { // paged
-        bool use_since = (days > 0);
+    out["api_version"] = "2.1.0";
 
-        if (use_since) {
-            sql =
-                "SELECT day_ts, humidity_high, humidity_low "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts "
-                "LIMIT ?2 OFFSET ?3";
-        } else {
-            sql =
-                "SELECT day_ts, humidity_high, humidity_low "
-                "FROM daily_weather "
-                "ORDER BY day_ts "
-                "LIMIT ?1 OFFSET ?2";
-        }
-    }
+    // Published copies only: no g_lock, safe from any thread
+    StationTelemetry st   = g_pub.tel.load();
+    LinkTelemetry    link = g_link.load();
+    auto             text = std::atomic_load(&g_pub.text);
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(g_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
-        return out.dump();
+    station_json(st, *text, out);
 
-    if (time_only && days > 0) {
-        std::time_t now_ts   = std::time(nullptr);
-        std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
-        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(since_ts));
+    out["astro"] = *astro_for_day(std::time(nullptr));
 
-    } else if (paged) {
-        int bind_idx = 1;
-        bool use_since = (days > 0);
+    // out["rain_daily_in"]   = g_state.rain_daily_in;
+    // out["rain_event_in"]   = g_state.rain_event_in;
+    // out["rain_hourly_in"]  = g_state.rain_hourly_in;
+    // out["rain_weekly_in"]  = g_state.rain_weekly_in;
+    // out["rain_monthly_in"] = g_state.rain_monthly_in;
+    // out["rain_yearly_in"]  = g_state.rain_yearly_in;
 
-        if (use_since) {
-            std::time_t now_ts   = std::time(nullptr);
-            std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
+    std::time_t now   = std::time(nullptr);
+    int         age   = st.last_update ? (int)(now - st.last_update) : -1;
+    bool        stale = (st.last_update != 0 && age > 60);  // adjust threshold to taste
 
-            sqlite3_bind_int64(stmt, bind_idx++, static_cast<sqlite3_int64>(since_ts));
-            sqlite3_bind_int(stmt,   bind_idx++, limit);
-            sqlite3_bind_int(stmt,   bind_idx++, offset);
-        } else {
-            sqlite3_bind_int(stmt, bind_idx++, limit);
-            sqlite3_bind_int(stmt, bind_idx++, offset);
-        }
+    json ws;
+    ws["http_ok"]        = link.http_ok;
+    ws["rtlsdr_ok"]      = link.rtlsdr_ok;
+    ws["last_poll_ts"]   = (long long)link.last_poll;
+    ws["last_update_ts"] = (long long)st.last_update;
+    ws["age_sec"]        = age;
+    ws["stale"]          = stale;
+    ws["http_status"]    = st.http_status;
+    ws["mode"]           = current_config()->ws90_mode;
+
+    if (link.poll.count > 0) {
+        json poll;
+        poll["connect_ms"]   = link.poll.connect_ms;
+        poll["total_ms"]     = link.poll.total_ms;
+        poll["reused_conn"]  = link.poll.reused;
+        poll["count"]        = link.poll.count;
+        poll["reused_count"] = link.poll.reused_count;
+        ws["poll"] = poll;
     }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::time_t ts = sqlite3_column_int64(stmt, 0);
-        double hi = (sqlite3_column_type(stmt,1)==SQLITE_NULL)
-                    ? NAN : sqlite3_column_double(stmt,1);
-        double lo = (sqlite3_column_type(stmt,2)==SQLITE_NULL)
-                    ? NAN : sqlite3_column_double(stmt,2);
-
-        json row;
-        row["day"] = static_cast<long long>(ts);
-
-        if (std::isnan(hi) || std::isnan(lo)) {
-            row["humidity_high"] = nullptr;
-            row["humidity_low"]  = nullptr;
-        } else {
-            row["humidity_high"] = hi;
-            row["humidity_low"]  = lo;
-        }
+    if (!text->error_code.empty())
+        ws["error"] = text->error_code;
+    if (!text->error_msg.empty())
+        ws["error_message"] = text->error_msg;
 
-        out["days"].push_back(row);
-    }
+    out["ws90_status"] = ws;
 
-    sqlite3_finalize(stmt);
-    return out.dump();
+    return out;
 }
 
-std::string history_rain_json(int days, int limit, int offset) {
-    json out;
-    out["days"] = json::array();
-    if (!g_db) return out.dump();
-
-    bool simple    = (days < 0 && limit < 0 && offset < 0);
-    bool time_only = (days >= 0 && limit < 0 && offset < 0);
-    bool paged     = !simple && !time_only;
-
-    std::string sql;
-
-    if (simple) {
-        sql =
-            "SELECT day_ts, rain_in "
-            "FROM daily_weather "
-            "ORDER BY day_ts";
-
-    } else if (time_only) {
-        if (days == 0) {
-            sql =
-                "SELECT day_ts, rain_in "
-                "FROM daily_weather "
-                "ORDER BY day_ts";
-        } else {
-            sql =
-                "SELECT day_ts, rain_in "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts";
+std::shared_ptr<const Snapshot> current_snapshot() {
+    return std::atomic_load(&g_snapshot);
+}
+
+bool backfill(const std::string &path, bool utc)
+{
+    load_config();
+
+    // With TZ unset, glibc checks /etc/localtime on every localtime call
+    // (several per sample); naming the same file makes it load once
+    if (!getenv("TZ")) {
+        setenv("TZ", ":/etc/localtime", 1);
+        tzset();
+    }
+
+    std::ifstream file;
+    std::istream *in = &std::cin;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            fprintf(stderr, "backfill: cannot open %s\n", path.c_str());
+            return false;
         }
+        in = &file;
+    }
 
-    } else { // paged
-        bool use_since = (days > 0);
+    init_db();
+    if (!g_db)
+        return false;
+    bool with_samples = samples_v2::import_begin(g_db);
+
+    // A scratch state: the live rain state and checkpoint are not touched.
+    // Calendar fields start from the first sample instead of today.
+    WeatherStateV2 st;
+    init_state_defaults(st);
+    st.last_update    = 0;
+    st.daily_ymd      = 0;
+    st.month_ym       = 0;
+    st.year_y         = 0;
+    st.week_start_ymd = 0;
+
+    long long days_before = count_daily_rows();
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (sqlite3_exec(g_db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "backfill: BEGIN failed: %s\n", sqlite3_errmsg(g_db));
+        if (with_samples) samples_v2::import_end();
+        return false;
+    }
 
-        if (use_since) {
-            sql =
-                "SELECT day_ts, rain_in "
-                "FROM daily_weather "
-                "WHERE day_ts >= ?1 "
-                "ORDER BY day_ts "
-                "LIMIT ?2 OFFSET ?3";
-        } else {
-            sql =
-                "SELECT day_ts, rain_in "
-                "FROM daily_weather "
-                "ORDER BY day_ts "
-                "LIMIT ?1 OFFSET ?2";
+    unsigned long long lines = 0, applied = 0, repeats = 0, others = 0, unreadable = 0;
+    std::vector<samples_v2::Sample> batch;
+    batch.reserve(BACKFILL_BATCH);
+    std::time_t last_ts = 0;
+    bool ok = true;
+    std::string line, time_text, last_time_text;
+    {
+        metrics_v2::TimedLock guard(g_lock);
+
+        while (ok && std::getline(*in, line)) {
+            lines++;
+            // Other sensors' frames are skipped without parsing
+            if (line.find("Fineoffset-WS90") == std::string::npos)
+                continue;
+
+            // rtl_433 logs every transmission more than once, with the
+            // same time: repeats are skipped before parsing too
+            if (frame_time_text(line, time_text) && time_text == last_time_text) {
+                repeats++;
+                continue;
+            }
+
+            json j = json::parse(line, nullptr, false);
+            std::time_t ts = 0;
+            if (j.is_discarded() || !j.is_object() || !j.contains("model") ||
+                j["model"] != "Fineoffset-WS90" || !parse_frame_time(j, utc, ts)) {
+                unreadable++;
+                continue;
+            }
+            if (!is_primary_frame(j)) {
+                others++;
+                continue;
+            }
+            // Concatenated logs can overlap; only moving forward counts
+            if (ts <= last_ts) {
+                repeats++;
+                continue;
+            }
+            last_ts = ts;
+            last_time_text = time_text;
+
+            double rain_in = apply_ws90_json_locked(st, j, APPLY_BACKFILL, ts);
+            applied++;
+
+            if (with_samples) {
+                samples_v2::Sample smp;
+                smp.ts            = (std::int64_t)ts;
+                smp.temperature_c = st.temperature_C;
+                smp.humidity      = st.humidity;
+                smp.wind_avg_m_s  = st.wind_avg_m_s;
+                smp.wind_max_m_s  = st.wind_max_m_s;
+                smp.wind_dir_deg  = st.wind_dir_deg;
+                smp.light_lux     = st.light_lux;
+                smp.uvi           = st.uvi;
+                smp.rain_in       = rain_in;
+                batch.push_back(smp);
+                if (batch.size() == BACKFILL_BATCH) {
+                    ok = samples_v2::import(batch);
+                    batch.clear();
+                }
+            }
         }
+        if (ok && !batch.empty())
+            ok = samples_v2::import(batch);
+
+        // The log's last day has no rollover to log it. Today is left to
+        // the live backend.
+        if (ok && st.day_first_ts &&
+            ymd_from_time(st.day_last_ts) != ymd_from_time(std::time(nullptr)) &&
+            st.day_last_ts - st.day_first_ts >= MIN_COVERAGE_SEC)
+            log_daily_to_db(day_start_ts(st.day_first_ts), st, st.rain_daily_in, true);
     }
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(g_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
-        return out.dump();
+    if (ok && sqlite3_exec(g_db, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "backfill: COMMIT failed: %s\n", sqlite3_errmsg(g_db));
+        ok = false;
+    }
+    if (!ok) {
+        sqlite3_exec(g_db, "ROLLBACK", nullptr, nullptr, nullptr);
+        fprintf(stderr, "backfill: rolled back, nothing written\n");
+    }
+    if (with_samples)
+        samples_v2::import_end();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (ok) {
+        printf("backfill: %llu lines, %llu samples applied (%llu repeats, %llu other stations, "
+               "%llu unreadable), %lld days added, %.2f s\n",
+               lines, applied, repeats, others, unreadable,
+               count_daily_rows() - days_before, secs);
+    }
 
-    if (time_only && days > 0) {
-        std::time_t now_ts   = std::time(nullptr);
-        std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
-        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(since_ts));
+    close_history_reader();
+    sqlite3_close(g_db);
+    g_db = nullptr;
+    return ok;
+}
 
-    } else if (paged) {
-        int bind_idx = 1;
-        bool use_since = (days > 0);
+std::string current_weather_json() {
+    auto snap = current_snapshot();
+    return snap ? snap->body : std::string("{}");
+}
 
-        if (use_since) {
-            std::time_t now_ts   = std::time(nullptr);
-            std::time_t since_ts = now_ts - static_cast<std::time_t>(days) * 86400;
+bool ingest_ws90_json(const std::string &body) {
+    // Parse before taking g_lock; a bad POST never touches state
+    json j = json::parse(body, nullptr, false);
+    if (j.is_discarded() || !j.is_object())
+        return false;
+    if (!j.contains("model") || j["model"] != "Fineoffset-WS90" || !frame_fields_ok(j))
+        return false;
 
-            sqlite3_bind_int64(stmt, bind_idx++, static_cast<sqlite3_int64>(since_ts));
-            sqlite3_bind_int(stmt,   bind_idx++, limit);
-            sqlite3_bind_int(stmt,   bind_idx++, offset);
-        } else {
-            sqlite3_bind_int(stmt, bind_idx++, limit);
-            sqlite3_bind_int(stmt, bind_idx++, offset);
-        }
-    }
+    // Runs on an MHD thread: an exception must not reach the C callback
+    try {
+        {
+            metrics_v2::TimedLock guard(g_lock);
+
+            // ws90_api pushes every WS90 it keeps; ids this backend does not
+            // track are accepted and dropped
+            if (!is_primary_frame(j)) {
+                process_station_json_locked(j);
+                return true;
+            }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::time_t ts = sqlite3_column_int64(stmt, 0);
+            process_ws90_json_locked(j);
+
+            g_ws90_last_poll   = std::time(nullptr);
+            g_ws90_http_status = 200;
+            g_ws90_http_ok     = true;
+            g_rtlsdr_ok        = true;
+            g_ws90_error_code.clear();
+            g_ws90_error_msg.clear();
 
-        int rain_type = sqlite3_column_type(stmt, 1);
-        if (rain_type == SQLITE_NULL) {
-            // No rain data for this day - skip it
-            continue;
+            publish_primary_locked();
         }
 
-        double r = sqlite3_column_double(stmt, 1);
+        publish_snapshot();
+    } catch (const std::exception &e) {
+        std::cerr << "ws90 push: frame rejected: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
 
-        json row;
-        row["day"]     = static_cast<long long>(ts);
-        row["rain_in"] = r;
+std::string stations_json() {
+    std::time_t now = std::time(nullptr);
 
-        out["days"].push_back(row);
-    }
+    json list = json::array();
+    auto add = [&](const StationPub &pub, int id, bool primary) {
+        StationTelemetry t = pub.tel.load();
+        auto text = std::atomic_load(&pub.text);
+
+        json e;
+        station_json(t, *text, e);
+        int age = t.last_update ? (int)(now - t.last_update) : -1;
+        e["id"]             = t.last_update ? t.id : id;
+        e["primary"]        = primary;
+        e["last_update_ts"] = (long long)t.last_update;
+        e["age_sec"]        = age;
+        e["stale"]          = (t.last_update == 0 || age > 60);
+        e["http_status"]    = t.http_status;
+        if (!text->error_code.empty())
+            e["error"] = text->error_code;
+        list.push_back(std::move(e));
+    };
 
-    sqlite3_finalize(stmt);
+    add(g_pub, current_config()->ws90_station_id, true);
+    for (const auto &kv : g_stations)
+        add(kv.second.pub, kv.first, false);
+
+    json out;
+    out["stations"] = std::move(list);
     return out.dump();
 }
 
+std::string history_etag() {
+    return "\"h" + std::to_string(g_history_last_day_ts.load()) +
+           "-" + std::to_string(g_history_rev.load()) +
+           "-" + std::to_string(ymd_from_time(std::time(nullptr))) + "\"";
+}
+
+bool parse_history_series(const std::string &list, unsigned &series)
+{
+    series = 0;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        std::string name = list.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (name.empty()) continue;
+
+        int i = 0;
+        while (i < HISTORY_SERIES_COUNT && name != HISTORY_SERIES[i].name) i++;
+        if (i == HISTORY_SERIES_COUNT) return false;
+        series |= 1u << i;
+    }
+    if (series == 0)
+        series = (1u << HISTORY_SERIES_COUNT) - 1;
+    return true;
+}
 
 } // namespace state_v2
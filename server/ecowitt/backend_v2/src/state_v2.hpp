@@ -1,17 +1,100 @@
 #pragma once
 #include <string>
+#include <memory>
+#include <cstdint>
 #include "json.hpp"
+#include "compress_v2.hpp"
 
 
 namespace state_v2 {
 
-void init();
+// Immutable, pre-serialized /api/v2/weather document.
+// Published by the poller; readers grab a reference and never lock.
+struct Snapshot {
+    std::uint64_t version = 0;   // monotonically increasing per publish
+    std::string   etag;          // strong ETag, unique across restarts
+    std::string   body;          // serialized JSON document
+    compress_v2::Variants variants;  // compressed body, built on demand
+};
+
+void init();        // also starts the config.json watcher
+void shutdown();    // stop the poller, flush state to disk
 std::string current_weather_json();
 
-std::string history_temperature_json(int days, int limit, int offset);
-std::string history_humidity_json(int days, int limit, int offset);
-std::string history_rain_json(int days, int limit, int offset);
+// --backfill: run every WS90 sample in an rtl_433 JSON log (path, or "-"
+// for stdin) through the rain, rollover and high/low logic at the
+// sample's own time, in one SQLite transaction. Adds daily_weather rows
+// and raw samples that are missing; existing rows win. Frames without a
+// readable time are skipped and the live rain state is not touched.
+// Times without a zone are local, or UTC if utc. Runs without the
+// poller or HTTP server.
+bool backfill(const std::string &path, bool utc);
+std::shared_ptr<const Snapshot> current_snapshot();
+
+// Apply one rtl_433 WS90 frame POSTed to /ws90 (ws90_mode "push") and
+// publish a new snapshot. Returns false if body is not a WS90 object,
+// a reading has the wrong type, or applying it failed.
+// Frames from a ws90_stations id update that station instead.
+bool ingest_ws90_json(const std::string &body);
+
+// /api/v2/stations: the primary station and every ws90_stations entry,
+// each with its readings, running totals and freshness
+std::string stations_json();
+
+// Strong ETag covering every daily_weather query. Changes when a daily
+// row is written, and at local midnight (days= windows slide).
+std::string history_etag();
+
+// daily_weather query. -1 = not given.
+//   days      only rows newer than now - days (0 = no time filter)
+//   limit     page size; offset is kept for old clients
+//   after_ts  keyset cursor: rows with day_ts > after_ts, ascending
+//   before_ts keyset cursor: rows with day_ts < before_ts; alone it
+//             returns the newest `limit` rows before it
+// Paged replies carry next_after_ts / prev_before_ts for the next call.
+struct HistoryQuery {
+    int       days      = -1;
+    int       limit     = -1;
+    int       offset    = -1;
+    long long after_ts  = -1;
+    long long before_ts = -1;
+};
+
+// Series for history_json, as a bit mask. parse_history_series turns a
+// series= list ("temp,humidity,rain,wind") into one; empty = all.
+// Returns false on an unknown name.
+enum : unsigned {
+    HISTORY_TEMP     = 1u << 0,
+    HISTORY_HUMIDITY = 1u << 1,
+    HISTORY_RAIN     = 1u << 2,
+    HISTORY_WIND     = 1u << 3,
+};
+bool parse_history_series(const std::string &list, unsigned &series);
+
+// Body layouts for a history reply
+//   ROWS     {"days":[{"day":ts, <columns of each requested series>}, ...]}
+//   COLUMNAR {"day":[ts, ...], "<column>":[v, ...], ...}   (same keys)
+//   CSV      header line "day,<column>,...", one line per day, empty = null
+// JSON layouts end with the paging cursors, if any.
+enum HistoryFormat {
+    HISTORY_FORMAT_ROWS,
+    HISTORY_FORMAT_COLUMNAR,
+    HISTORY_FORMAT_CSV,
+};
+
+// Streamed history reply. Every series comes from one pass over
+// daily_weather. history_next() appends the next chunk of the body to
+// out (a bounded number of rows; columnar holds its arrays until the
+// end) and returns false once the body is complete. The stream holds no
+// DB state between calls; history_close() frees it.
+struct HistoryStream;
+HistoryStream *history_open(unsigned series, const HistoryQuery &q,
+                            HistoryFormat format = HISTORY_FORMAT_ROWS);
+bool           history_next(HistoryStream *hs, std::string &out);
+void           history_close(HistoryStream *hs);
 
+// The /api/v2/weather document, from the readings published after the
+// last applied frame. Takes no lock; callable from any thread.
 nlohmann::json build_current_json();
 
 }
@@ -0,0 +1,189 @@
+#include "stream_v2.hpp"
+#include <microhttpd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// =========================================
+// Config constants
+// =========================================
+
+static const size_t MAX_STREAM_CLIENTS = 32;
+static const size_t STREAM_BLOCK_SIZE  = 8192;
+
+// Sent first on every stream: reconnect hint for EventSource
+static const char PREAMBLE[] = "retry: 5000\n\n";
+
+// =========================================
+// Types
+// =========================================
+
+// One serialized SSE event, shared by every client
+struct Frame {
+    std::uint64_t version = 0;
+    std::string   text;
+};
+
+struct StreamClient {
+    struct MHD_Connection        *conn = nullptr;
+    std::shared_ptr<const Frame>  frame;          // frame being written
+    size_t                        off  = 0;       // bytes of frame already sent
+    std::uint64_t                 sent_version = 0;
+    bool                          suspended    = false;
+};
+
+static std::mutex                   g_mu;        // guards everything below
+static std::vector<StreamClient *>  g_clients;
+static std::shared_ptr<const Frame> g_frame;     // latest snapshot event
+static std::shared_ptr<const Frame> g_preamble = std::make_shared<Frame>(Frame{0, PREAMBLE});
+static bool                         g_closing = false;
+
+// =========================================
+// MHD callbacks
+// =========================================
+
+// Content reader. Runs on the MHD thread for one client; copies the
+// pending frame out, or parks the connection until notify().
+static ssize_t stream_reader(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)pos;
+    StreamClient *c = static_cast<StreamClient *>(cls);
+
+    std::lock_guard<std::mutex> guard(g_mu);
+
+    if (g_closing)
+        return MHD_CONTENT_READER_END_OF_STREAM;
+
+    if (!c->frame || c->off >= c->frame->text.size()) {
+        if (g_frame && g_frame->version != c->sent_version) {
+            c->frame        = g_frame;
+            c->off          = 0;
+            c->sent_version = g_frame->version;
+        } else {
+            // Nothing new. Suspend under g_mu so notify() cannot slip
+            // in between the check and the suspend and miss us.
+            c->frame.reset();
+            c->suspended = true;
+            MHD_suspend_connection(c->conn);
+            return 0;
+        }
+    }
+
+    size_t n = std::min(max, c->frame->text.size() - c->off);
+    std::memcpy(buf, c->frame->text.data() + c->off, n);
+    c->off += n;
+    return static_cast<ssize_t>(n);
+}
+
+// Response teardown: the client went away or the stream ended
+static void stream_free(void *cls)
+{
+    StreamClient *c = static_cast<StreamClient *>(cls);
+    {
+        std::lock_guard<std::mutex> guard(g_mu);
+        g_clients.erase(std::remove(g_clients.begin(), g_clients.end(), c),
+                        g_clients.end());
+    }
+    delete c;
+}
+
+// =========================================
+// Public API
+// =========================================
+
+namespace stream_v2 {
+
+int open(struct MHD_Connection *conn)
+{
+    StreamClient *c = new StreamClient;
+    c->conn  = conn;
+    c->frame = g_preamble;
+
+    {
+        std::lock_guard<std::mutex> guard(g_mu);
+        if (g_closing || g_clients.size() >= MAX_STREAM_CLIENTS) {
+            delete c;
+            c = nullptr;
+        } else {
+            g_clients.push_back(c);
+        }
+    }
+
+    if (!c) {
+        static const char busy[] = "{\"error\":\"too many stream clients\"}";
+        struct MHD_Response *res = MHD_create_response_from_buffer(
+            sizeof(busy) - 1, (void *)busy, MHD_RESPMEM_PERSISTENT);
+        if (!res) return MHD_NO;
+        MHD_add_response_header(res, "Content-Type", "application/json");
+        MHD_add_response_header(res, "Access-Control-Allow-Origin", "*");
+        int q = MHD_queue_response(conn, MHD_HTTP_SERVICE_UNAVAILABLE, res);
+        MHD_destroy_response(res);
+        return (q == MHD_YES) ? MHD_YES : MHD_NO;
+    }
+
+    struct MHD_Response *res = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN,
+        STREAM_BLOCK_SIZE,
+        &stream_reader,
+        c,
+        &stream_free
+    );
+    if (!res) {
+        stream_free(c);
+        return MHD_NO;
+    }
+
+    MHD_add_response_header(res, "Content-Type", "text/event-stream");
+    MHD_add_response_header(res, "Cache-Control", "no-cache");
+    MHD_add_response_header(res, "X-Accel-Buffering", "no");   // nginx: don't buffer
+    MHD_add_response_header(res, "Access-Control-Allow-Origin", "*");
+
+    int q = MHD_queue_response(conn, MHD_HTTP_OK, res);
+    MHD_destroy_response(res);
+
+    return (q == MHD_YES) ? MHD_YES : MHD_NO;
+}
+
+void notify(const std::shared_ptr<const state_v2::Snapshot> &snap)
+{
+    if (!snap) return;
+
+    // Format once, outside the lock; every client shares this buffer
+    auto f = std::make_shared<Frame>();
+    f->version = snap->version;
+    f->text.reserve(snap->body.size() + 48);
+    f->text += "id: ";
+    f->text += std::to_string(snap->version);
+    f->text += "\nevent: weather\ndata: ";
+    f->text += snap->body;
+    f->text += "\n\n";
+
+    std::lock_guard<std::mutex> guard(g_mu);
+    g_frame = std::move(f);
+
+    for (StreamClient *c : g_clients) {
+        if (c->suspended) {
+            c->suspended = false;
+            MHD_resume_connection(c->conn);
+        }
+    }
+}
+
+void shutdown()
+{
+    std::lock_guard<std::mutex> guard(g_mu);
+    g_closing = true;
+
+    for (StreamClient *c : g_clients) {
+        if (c->suspended) {
+            c->suspended = false;
+            MHD_resume_connection(c->conn);
+        }
+    }
+}
+
+} // namespace stream_v2
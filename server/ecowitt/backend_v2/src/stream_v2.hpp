@@ -0,0 +1,24 @@
+#pragma once
+#include <microhttpd.h>
+#include <memory>
+#include "state_v2.hpp"
+
+// Server-Sent Events push for /api/v2/stream.
+//
+// Every published snapshot is formatted into one SSE frame, once, and
+// shared by all connected clients. Idle clients are suspended inside
+// libmicrohttpd and resumed by notify(), so they cost nothing between
+// samples.
+
+namespace stream_v2 {
+
+// Queue an event-stream response on conn. Returns MHD_YES/MHD_NO.
+int open(struct MHD_Connection *conn);
+
+// Called by the publisher after a new snapshot goes live.
+void notify(const std::shared_ptr<const state_v2::Snapshot> &snap);
+
+// End all streams and resume suspended connections so the daemon can stop.
+void shutdown();
+
+}
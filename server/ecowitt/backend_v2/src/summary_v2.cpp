@@ -0,0 +1,510 @@
+extern "C" {
+#include <sqlite3.h>
+}
+
+#include "summary_v2.hpp"
+#include "utils.hpp"
+#include "json.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using json = nlohmann::json;
+
+// =========================================
+// Config constants
+// =========================================
+
+static const double RAIN_DAY_IN      = 0.01;   // a "rain day" has at least this
+static const int    NORMAL_MIN_DAYS  = 20;     // months with fewer don't count toward normals
+
+// =========================================
+// Aggregates
+// =========================================
+
+// One month (or a merge of months). Everything is a double so the
+// column table below can move it to and from SQL in one loop; day
+// fields are unix timestamps (exact in a double). NAN = no value.
+struct Agg {
+    double days              = 0;
+
+    double temp_n            = 0;
+    double temp_high_max     = NAN;     // C
+    double temp_high_max_day = NAN;
+    double temp_low_min      = NAN;
+    double temp_low_min_day  = NAN;
+    double temp_high_sum     = 0;
+    double temp_low_sum      = 0;
+
+    double hum_n             = 0;
+    double hum_high_max      = NAN;
+    double hum_high_max_day  = NAN;
+    double hum_low_min       = NAN;
+    double hum_low_min_day   = NAN;
+
+    double rain_n            = 0;
+    double rain_sum          = 0;       // in
+    double rain_days         = 0;
+    double rain_max          = NAN;
+    double rain_max_day      = NAN;
+
+    double wind_n            = 0;
+    double wind_mean_sum     = 0;       // m/s
+    double wind_gust_max     = NAN;
+    double wind_gust_max_day = NAN;
+};
+
+struct AggColumn {
+    const char   *name;
+    double Agg::*member;
+};
+
+static const AggColumn AGG_COLUMNS[] = {
+    { "days",              &Agg::days              },
+    { "temp_n",            &Agg::temp_n            },
+    { "temp_high_max",     &Agg::temp_high_max     },
+    { "temp_high_max_day", &Agg::temp_high_max_day },
+    { "temp_low_min",      &Agg::temp_low_min      },
+    { "temp_low_min_day",  &Agg::temp_low_min_day  },
+    { "temp_high_sum",     &Agg::temp_high_sum     },
+    { "temp_low_sum",      &Agg::temp_low_sum      },
+    { "hum_n",             &Agg::hum_n             },
+    { "hum_high_max",      &Agg::hum_high_max      },
+    { "hum_high_max_day",  &Agg::hum_high_max_day  },
+    { "hum_low_min",       &Agg::hum_low_min       },
+    { "hum_low_min_day",   &Agg::hum_low_min_day   },
+    { "rain_n",            &Agg::rain_n            },
+    { "rain_sum",          &Agg::rain_sum          },
+    { "rain_days",         &Agg::rain_days         },
+    { "rain_max",          &Agg::rain_max          },
+    { "rain_max_day",      &Agg::rain_max_day      },
+    { "wind_n",            &Agg::wind_n            },
+    { "wind_mean_sum",     &Agg::wind_mean_sum     },
+    { "wind_gust_max",     &Agg::wind_gust_max     },
+    { "wind_gust_max_day", &Agg::wind_gust_max_day },
+};
+static const int AGG_COLUMN_COUNT = (int)(sizeof(AGG_COLUMNS) / sizeof(AGG_COLUMNS[0]));
+
+// Records keep the earliest day on a tie
+static void take_max(double &v, double &day, double x, double xday)
+{
+    if (std::isnan(x)) return;
+    if (std::isnan(v) || x > v) { v = x; day = xday; }
+}
+
+static void take_min(double &v, double &day, double x, double xday)
+{
+    if (std::isnan(x)) return;
+    if (std::isnan(v) || x < v) { v = x; day = xday; }
+}
+
+static void merge(Agg &a, const Agg &b)
+{
+    a.days          += b.days;
+
+    a.temp_n        += b.temp_n;
+    a.temp_high_sum += b.temp_high_sum;
+    a.temp_low_sum  += b.temp_low_sum;
+    take_max(a.temp_high_max, a.temp_high_max_day, b.temp_high_max, b.temp_high_max_day);
+    take_min(a.temp_low_min,  a.temp_low_min_day,  b.temp_low_min,  b.temp_low_min_day);
+
+    a.hum_n         += b.hum_n;
+    take_max(a.hum_high_max, a.hum_high_max_day, b.hum_high_max, b.hum_high_max_day);
+    take_min(a.hum_low_min,  a.hum_low_min_day,  b.hum_low_min,  b.hum_low_min_day);
+
+    a.rain_n        += b.rain_n;
+    a.rain_sum      += b.rain_sum;
+    a.rain_days     += b.rain_days;
+    take_max(a.rain_max, a.rain_max_day, b.rain_max, b.rain_max_day);
+
+    a.wind_n        += b.wind_n;
+    a.wind_mean_sum += b.wind_mean_sum;
+    take_max(a.wind_gust_max, a.wind_gust_max_day, b.wind_gust_max, b.wind_gust_max_day);
+}
+
+// Fold one daily_weather row (columns as in DAY_SELECT) into a month
+static void fold_day(Agg &a, sqlite3_stmt *st)
+{
+    auto col = [st](int i) {
+        return sqlite3_column_type(st, i) == SQLITE_NULL ? NAN : sqlite3_column_double(st, i);
+    };
+
+    double day = (double)sqlite3_column_int64(st, 0);
+    double thi = col(1), tlo = col(2);
+    double hhi = col(3), hlo = col(4);
+    double rain = col(5);
+    double wmean = col(6), wgust = col(7);
+
+    a.days += 1;
+
+    if (!std::isnan(thi) && !std::isnan(tlo)) {
+        a.temp_n        += 1;
+        a.temp_high_sum += thi;
+        a.temp_low_sum  += tlo;
+        take_max(a.temp_high_max, a.temp_high_max_day, thi, day);
+        take_min(a.temp_low_min,  a.temp_low_min_day,  tlo, day);
+    }
+
+    if (!std::isnan(hhi) && !std::isnan(hlo)) {
+        a.hum_n += 1;
+        take_max(a.hum_high_max, a.hum_high_max_day, hhi, day);
+        take_min(a.hum_low_min,  a.hum_low_min_day,  hlo, day);
+    }
+
+    if (!std::isnan(rain)) {
+        a.rain_n   += 1;
+        a.rain_sum += rain;
+        if (rain >= RAIN_DAY_IN) a.rain_days += 1;
+        take_max(a.rain_max, a.rain_max_day, rain, day);
+    }
+
+    if (!std::isnan(wmean) && !std::isnan(wgust)) {
+        a.wind_n        += 1;
+        a.wind_mean_sum += wmean;
+        take_max(a.wind_gust_max, a.wind_gust_max_day, wgust, day);
+    }
+}
+
+// =========================================
+// State
+// =========================================
+
+static std::mutex                          g_mu;        // guards g_months
+static std::map<int, Agg>                  g_months;    // YYYYMM -> aggregate
+static std::shared_ptr<const summary_v2::Body> g_body;  // std::atomic_store/load
+
+// =========================================
+// Calendar helpers (local time, like daily_weather.day_ts)
+// =========================================
+
+static int ym_of(std::time_t t)
+{
+    std::tm lt;
+    localtime_r(&t, &lt);
+    return (lt.tm_year + 1900) * 100 + (lt.tm_mon + 1);
+}
+
+// [start, end) of a local calendar month
+static void month_bounds(int ym, std::time_t &start, std::time_t &end)
+{
+    std::tm tm{};
+    tm.tm_year  = ym / 100 - 1900;
+    tm.tm_mon   = ym % 100 - 1;
+    tm.tm_mday  = 1;
+    tm.tm_isdst = -1;
+    start = mktime(&tm);
+
+    std::tm nx{};
+    nx.tm_year  = tm.tm_year + (tm.tm_mon == 11 ? 1 : 0);
+    nx.tm_mon   = (tm.tm_mon + 1) % 12;
+    nx.tm_mday  = 1;
+    nx.tm_isdst = -1;
+    end = mktime(&nx);
+}
+
+static int days_in_month(int ym)
+{
+    std::time_t s, e;
+    month_bounds(ym, s, e);
+    return (int)((e - s + 43200) / 86400);      // DST: round to whole days
+}
+
+// =========================================
+// DB
+// =========================================
+
+static const char *DAY_SELECT =
+    "SELECT day_ts, temp_high_c, temp_low_c, humidity_high, humidity_low,"
+    " rain_in, wind_mean_m_s, wind_gust_m_s"
+    " FROM daily_weather WHERE day_ts >= ?1 AND day_ts < ?2 ORDER BY day_ts";
+
+// Aggregate daily_weather rows in [lo, hi) into months
+static bool aggregate_days(sqlite3 *db, sqlite3_int64 lo, sqlite3_int64 hi,
+                           std::map<int, Agg> &out)
+{
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, DAY_SELECT, -1, &st, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "summary: prepare failed: %s\n", sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_bind_int64(st, 1, lo);
+    sqlite3_bind_int64(st, 2, hi);
+
+    while (sqlite3_step(st) == SQLITE_ROW)
+        fold_day(out[ym_of((std::time_t)sqlite3_column_int64(st, 0))], st);
+
+    sqlite3_finalize(st);
+    return true;
+}
+
+static bool store_month(sqlite3 *db, int ym, const Agg &a)
+{
+    std::string sql = "INSERT OR REPLACE INTO summary_month (ym";
+    for (const AggColumn &c : AGG_COLUMNS) { sql += ", "; sql += c.name; }
+    sql += ") VALUES (?";
+    for (int i = 0; i < AGG_COLUMN_COUNT; i++) sql += ", ?";
+    sql += ")";
+
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK)
+        return false;
+
+    sqlite3_bind_int(st, 1, ym);
+    for (int i = 0; i < AGG_COLUMN_COUNT; i++) {
+        double v = a.*AGG_COLUMNS[i].member;
+        if (std::isnan(v)) sqlite3_bind_null(st, i + 2);
+        else               sqlite3_bind_double(st, i + 2, v);
+    }
+
+    bool ok = (sqlite3_step(st) == SQLITE_DONE);
+    sqlite3_finalize(st);
+    return ok;
+}
+
+static bool load_months(sqlite3 *db, std::map<int, Agg> &out)
+{
+    std::string sql = "SELECT ym";
+    for (const AggColumn &c : AGG_COLUMNS) { sql += ", "; sql += c.name; }
+    sql += " FROM summary_month";
+
+    sqlite3_stmt *st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK)
+        return false;
+
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        Agg &a = out[sqlite3_column_int(st, 0)];
+        for (int i = 0; i < AGG_COLUMN_COUNT; i++)
+            a.*AGG_COLUMNS[i].member =
+                (sqlite3_column_type(st, i + 1) == SQLITE_NULL) ? NAN
+                                                                : sqlite3_column_double(st, i + 1);
+    }
+    sqlite3_finalize(st);
+    return true;
+}
+
+// =========================================
+// Body
+// =========================================
+
+static double c_to_f(double c) { return c * 9.0 / 5.0 + 32.0; }
+
+static json num(double v)     { return std::isnan(v) ? json(nullptr) : json(v); }
+static json day_ts(double v)  { return std::isnan(v) ? json(nullptr) : json((long long)v); }
+static double mean(double sum, double n) { return n > 0 ? sum / n : NAN; }
+
+static json agg_json(const Agg &a)
+{
+    json o;
+    o["days"]                  = (long long)a.days;
+
+    o["temp_high_max_F"]       = num(c_to_f(a.temp_high_max));
+    o["temp_high_max_day"]     = day_ts(a.temp_high_max_day);
+    o["temp_low_min_F"]        = num(c_to_f(a.temp_low_min));
+    o["temp_low_min_day"]      = day_ts(a.temp_low_min_day);
+    o["temp_high_mean_F"]      = num(c_to_f(mean(a.temp_high_sum, a.temp_n)));
+    o["temp_low_mean_F"]       = num(c_to_f(mean(a.temp_low_sum,  a.temp_n)));
+
+    o["humidity_high_max"]     = num(a.hum_high_max);
+    o["humidity_high_max_day"] = day_ts(a.hum_high_max_day);
+    o["humidity_low_min"]      = num(a.hum_low_min);
+    o["humidity_low_min_day"]  = day_ts(a.hum_low_min_day);
+
+    o["rain_in"]               = a.rain_n > 0 ? json(a.rain_sum) : json(nullptr);
+    o["rain_days"]             = (long long)a.rain_days;
+    o["rain_max_day_in"]       = num(a.rain_max);
+    o["rain_max_day"]          = day_ts(a.rain_max_day);
+
+    o["wind_mean_mph"]         = num(mean(a.wind_mean_sum, a.wind_n) * utils::MPH_PER_M_S);
+    o["wind_gust_max_mph"]     = num(a.wind_gust_max * utils::MPH_PER_M_S);
+    o["wind_gust_max_day"]     = day_ts(a.wind_gust_max_day);
+    return o;
+}
+
+// Normals for one calendar month: mean of the monthly means/totals of
+// every mostly-complete month except `skip_ym` (the month in progress)
+struct Normal {
+    int    years     = 0;
+    double temp_high = NAN;     // C
+    double temp_low  = NAN;
+    double rain      = NAN;     // in
+};
+
+static Normal normal_for(const std::map<int, Agg> &months, int cal_month, int skip_ym)
+{
+    Normal n;
+    double hi = 0, lo = 0, rain = 0;
+    int    tn = 0, rn = 0;
+
+    for (const auto &kv : months) {
+        const Agg &a = kv.second;
+        if (kv.first % 100 != cal_month || kv.first == skip_ym || a.days < NORMAL_MIN_DAYS)
+            continue;
+        n.years++;
+        if (a.temp_n > 0) {
+            hi += a.temp_high_sum / a.temp_n;
+            lo += a.temp_low_sum  / a.temp_n;
+            tn++;
+        }
+        if (a.rain_n > 0) {
+            rain += a.rain_sum;
+            rn++;
+        }
+    }
+
+    if (tn) { n.temp_high = hi / tn; n.temp_low = lo / tn; }
+    if (rn) n.rain = rain / rn;
+    return n;
+}
+
+// Called with g_mu held
+static void publish_locked()
+{
+    json out;
+    out["months"]   = json::array();
+    out["years"]    = json::array();
+    out["calendar"] = json::array();
+
+    std::map<int, Agg> years;
+    Agg calendar[12];
+    Agg all_time;
+
+    for (const auto &kv : g_months) {
+        json m = agg_json(kv.second);
+        m["month"] = kv.first;
+        out["months"].push_back(std::move(m));
+
+        merge(years[kv.first / 100], kv.second);
+        merge(calendar[kv.first % 100 - 1], kv.second);
+        merge(all_time, kv.second);
+    }
+
+    for (const auto &kv : years) {
+        json y = agg_json(kv.second);
+        y["year"] = kv.first;
+        out["years"].push_back(std::move(y));
+    }
+
+    int latest = g_months.empty() ? 0 : g_months.rbegin()->first;
+
+    for (int c = 1; c <= 12; c++) {
+        Normal n = normal_for(g_months, c, latest);
+        json cm;
+        cm["month"]   = c;
+        cm["records"] = agg_json(calendar[c - 1]);
+        cm["normals"] = {
+            { "years",            n.years },
+            { "temp_high_mean_F", num(c_to_f(n.temp_high)) },
+            { "temp_low_mean_F",  num(c_to_f(n.temp_low))  },
+            { "rain_in",          num(n.rain)              },
+        };
+        out["calendar"].push_back(std::move(cm));
+    }
+
+    out["all_time"] = agg_json(all_time);
+
+    // Departure from normal for the newest month. Rain is compared with
+    // the normal prorated to the days logged so far.
+    if (latest) {
+        const Agg &a = g_months[latest];
+        Normal n = normal_for(g_months, latest % 100, latest);
+
+        double hi   = c_to_f(mean(a.temp_high_sum, a.temp_n)) - c_to_f(n.temp_high);
+        double lo   = c_to_f(mean(a.temp_low_sum,  a.temp_n)) - c_to_f(n.temp_low);
+        double rain = (a.rain_n > 0)
+                      ? a.rain_sum - n.rain * a.days / days_in_month(latest)
+                      : NAN;
+
+        json cur = agg_json(a);
+        cur["month"]     = latest;
+        cur["departure"] = {
+            { "temp_high_mean_F", num(hi)   },
+            { "temp_low_mean_F",  num(lo)   },
+            { "rain_in",          num(rain) },
+        };
+        out["latest"] = std::move(cur);
+    } else {
+        out["latest"] = nullptr;
+    }
+
+    auto b = std::make_shared<summary_v2::Body>();
+    b->body = out.dump();
+    b->etag = "\"m" + std::to_string(utils::crc32(b->body.data(), b->body.size())) + "\"";
+    std::atomic_store(&g_body, std::shared_ptr<const summary_v2::Body>(std::move(b)));
+}
+
+// =========================================
+// Public API
+// =========================================
+
+namespace summary_v2 {
+
+bool init(sqlite3 *db)
+{
+    std::lock_guard<std::mutex> guard(g_mu);
+    g_months.clear();
+
+    bool ok = (db != nullptr);
+    if (ok) {
+        std::string sql = "CREATE TABLE IF NOT EXISTS summary_month (ym INTEGER PRIMARY KEY";
+        for (const AggColumn &c : AGG_COLUMNS) { sql += ", "; sql += c.name; sql += " REAL"; }
+        sql += ")";
+
+        char *err = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            fprintf(stderr, "summary: %s\n", err ? err : "create failed");
+            sqlite3_free(err);
+            ok = false;
+        }
+    }
+
+    if (ok)
+        ok = load_months(db, g_months);
+
+    // First start with this table: build every month from daily_weather
+    if (ok && g_months.empty()) {
+        ok = aggregate_days(db, INT64_MIN, INT64_MAX, g_months);
+        sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+        for (const auto &kv : g_months)
+            store_month(db, kv.first, kv.second);
+        sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+        if (!g_months.empty())
+            fprintf(stderr, "summary: built %zu months from daily_weather\n", g_months.size());
+    }
+
+    publish_locked();
+    return ok;
+}
+
+void day_logged(sqlite3 *db, std::time_t day)
+{
+    if (!db) return;
+
+    int ym = ym_of(day);
+    std::time_t start, end;
+    month_bounds(ym, start, end);
+
+    // Recount the whole month, so a re-logged day can't be counted twice
+    std::map<int, Agg> fresh;
+    if (!aggregate_days(db, (sqlite3_int64)start, (sqlite3_int64)end, fresh))
+        return;
+
+    std::lock_guard<std::mutex> guard(g_mu);
+    if (fresh.empty()) return;
+    g_months[ym] = fresh[ym];
+    if (!store_month(db, ym, g_months[ym]))
+        fprintf(stderr, "summary: store failed: %s\n", sqlite3_errmsg(db));
+    publish_locked();
+}
+
+std::shared_ptr<const Body> current()
+{
+    return std::atomic_load(&g_body);
+}
+
+}
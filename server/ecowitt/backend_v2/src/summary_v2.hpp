@@ -0,0 +1,36 @@
+#pragma once
+#include <ctime>
+#include <memory>
+#include <string>
+#include "compress_v2.hpp"
+
+struct sqlite3;
+
+// Materialized climate summary: per-month aggregates in the
+// summary_month table, folded into years, calendar-month records and
+// normals, and all-time records.
+//
+// The month row is recomputed from daily_weather (at most 31 rows)
+// whenever a day is logged. The /api/v2/summary body is rebuilt from
+// the month rows right then and kept ready, so serving it never touches
+// daily_weather.
+
+namespace summary_v2 {
+
+struct Body {
+    std::string body;
+    std::string etag;
+    compress_v2::Variants variants;
+};
+
+// Create the table (backfilling it from daily_weather when empty) and
+// build the first body. db is the daily_weather writer connection.
+bool init(sqlite3 *db);
+
+// A daily_weather row for day_ts was written: refresh its month
+void day_logged(sqlite3 *db, std::time_t day_ts);
+
+// Current /api/v2/summary body; never null after init()
+std::shared_ptr<const Body> current();
+
+}
@@ -2,6 +2,10 @@
 #include <fstream>
 #include <sstream>
 
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace utils {
 
 bool write_file(const std::string &path, const std::string &contents)
@@ -28,4 +32,71 @@ bool read_file(const std::string &path, std::string &out)
     return true;
 }
 
+bool write_file_atomic(const std::string &path, const std::string &contents)
+{
+    std::string tmp = path + ".tmp";
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char *p    = contents.data();
+    size_t      left = contents.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        p    += n;
+        left -= static_cast<size_t>(n);
+    }
+
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable
+    size_t slash   = path.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash ? slash : 1);
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+
+    return true;
+}
+
+std::uint32_t crc32(const void *data, std::size_t len, std::uint32_t crc)
+{
+    static const auto table = [] {
+        struct { std::uint32_t v[256]; } t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            t.v[i] = c;
+        }
+        return t;
+    }();
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    while (len--)
+        crc = table.v[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
 } // namespace utils
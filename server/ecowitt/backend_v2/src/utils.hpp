@@ -1,9 +1,21 @@
 #pragma once
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 namespace utils {
 
+// m/s to mph; one mph is exactly 0.44704 m/s
+static constexpr double MPH_PER_M_S = 1.0 / 0.44704;
+
 bool write_file(const std::string &path, const std::string &contents);
 bool read_file(const std::string &path, std::string &out);
 
+// Crash-safe replace: write <path>.tmp, fsync, rename over path, fsync dir.
+// Readers see either the old file or the new one, never a torn write.
+bool write_file_atomic(const std::string &path, const std::string &contents);
+
+// CRC-32 (IEEE 802.3, same as zlib). Chain calls by passing the previous result.
+std::uint32_t crc32(const void *data, std::size_t len, std::uint32_t crc = 0);
+
 }
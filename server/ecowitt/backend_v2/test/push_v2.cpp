@@ -0,0 +1,181 @@
+// push_v2.cpp - end-to-end check of POST /ws90 (ws90_mode "push")
+//
+// Built and run by `make test`. Starts the real backend (state, HTTP
+// server) in a fresh temp directory, posts malformed frames and checks
+// each is answered 400 with the process still serving and the state
+// untouched, then posts a good frame and reads it back.
+//
+//   ./push_v2 [--keep]
+
+#include "state_v2.hpp"
+#include "http_server.hpp"
+#include "json.hpp"
+#include "utils.hpp"
+
+#include <curl/curl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Away from the 8889 a live backend listens on
+const int PORT = 18889;
+
+int g_failures = 0;
+
+size_t collect(void *p, size_t size, size_t n, void *userp)
+{
+    static_cast<std::string *>(userp)->append(static_cast<char *>(p), size * n);
+    return size * n;
+}
+
+// GET (post == nullptr) or POST a JSON body; the HTTP status, 0 if the
+// request did not get an answer
+long request(const char *path, const char *post, std::string *body = nullptr)
+{
+    CURL *c = curl_easy_init();
+    if (!c) return 0;
+
+    std::string url = "http://127.0.0.1:" + std::to_string(PORT) + path;
+    std::string sink;
+    curl_slist *hdr = curl_slist_append(nullptr, "Content-Type: application/json");
+    curl_easy_setopt(c, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(c, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, body ? body : &sink);
+    if (post) {
+        curl_easy_setopt(c, CURLOPT_HTTPHEADER, hdr);
+        curl_easy_setopt(c, CURLOPT_POSTFIELDS, post);
+    }
+
+    long status = 0;
+    if (curl_easy_perform(c) == CURLE_OK)
+        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &status);
+    curl_slist_free_all(hdr);
+    curl_easy_cleanup(c);
+    return status;
+}
+
+void check(bool ok, const std::string &what)
+{
+    std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what.c_str());
+    if (!ok) g_failures++;
+}
+
+void expect_status(const char *path, const char *post, long want, const std::string &what)
+{
+    long got = request(path, post);
+    check(got == want, what + " -> " + std::to_string(got));
+}
+
+// The published temperature, NAN if the weather endpoint did not answer
+double weather_temperature_f()
+{
+    std::string body;
+    if (request("/api/v2/weather", nullptr, &body) != 200)
+        return NAN;
+    json j = json::parse(body, nullptr, false);
+    if (j.is_discarded() || !j.contains("temperature_F") || !j["temperature_F"].is_number())
+        return NAN;
+    return j["temperature_F"].get<double>();
+}
+
+bool wait_for_server()
+{
+    for (int i = 0; i < 100; i++) {
+        if (request("/api/v2/weather", nullptr) == 200)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+void run_cases()
+{
+    const char *good =
+        "{\"time\":\"2026-01-01 12:00:00\",\"model\":\"Fineoffset-WS90\",\"id\":1,"
+        "\"temperature_C\":20.0,\"humidity\":50,\"wind_dir_deg\":90,"
+        "\"wind_avg_m_s\":1.0,\"wind_max_m_s\":2.0,\"rain_mm\":10.0}";
+
+    // Each of these used to reach get<double>() on a string or array
+    const char *bad[] = {
+        "{\"model\":\"Fineoffset-WS90\",\"rain_mm\":\"x\"}",
+        "{\"model\":\"Fineoffset-WS90\",\"temperature_C\":[1]}",
+        "{\"model\":\"Fineoffset-WS90\",\"id\":\"7\",\"rain_mm\":1.0}",
+        "{\"model\":\"Fineoffset-WS90\",\"time\":12}",
+        "{\"model\":\"Fineoffset-WS90\",\"rain_mm\":",
+        "[\"Fineoffset-WS90\"]",
+    };
+
+    expect_status("/ws90", good, 204, "good frame");
+    double before = weather_temperature_f();
+    check(std::fabs(before - 68.0) < 0.01, "good frame published (temperature_F 68)");
+
+    for (const char *frame : bad) {
+        expect_status("/ws90", frame, 400, std::string("bad frame ") + frame);
+        check(request("/api/v2/weather", nullptr) == 200, "  still serving");
+    }
+
+    check(weather_temperature_f() == before, "bad frames left the state alone");
+
+    std::string next = good;
+    next.replace(next.find("20.0"), 4, "25.0");
+    next.replace(next.find("12:00:00"), 8, "12:00:09");
+    expect_status("/ws90", next.c_str(), 204, "good frame after bad ones");
+    check(std::fabs(weather_temperature_f() - 77.0) < 0.01, "new frame published (temperature_F 77)");
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bool keep = (argc > 1 && std::strcmp(argv[1], "--keep") == 0);
+
+    // The backend uses /state when it exists; a test must not touch it
+    if (access("/state", F_OK) == 0) {
+        std::fprintf(stderr, "push_v2: /state exists, refusing to run next to a live backend\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/push_v2.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        std::perror("push_v2: temp dir");
+        return 1;
+    }
+    utils::write_file("config.json",
+                      "{\"latitude\": 35.0, \"longitude\": -97.0,"
+                      " \"ws90_mode\": \"push\", \"samples_enabled\": false}\n");
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    state_v2::init();
+    std::thread server([] { http_server::start_server(PORT); });
+
+    if (wait_for_server())
+        run_cases();
+    else
+        check(false, "backend answering on port " + std::to_string(PORT));
+
+    http_server::request_stop();
+    server.join();
+    state_v2::shutdown();
+    curl_global_cleanup();
+
+    if (!keep) {
+        const char *files[] = { "weather_history_v2.sqlite3", "weather_history_v2.sqlite3-wal",
+                                "weather_history_v2.sqlite3-shm", "rain_state_v2.json",
+                                "rain_state_v2.bin", "config.json" };
+        for (const char *f : files) unlink(f);
+        if (chdir("/") == 0) rmdir(dir);
+    }
+
+    std::printf("%s\n", g_failures ? "FAILED" : "PASSED");
+    return g_failures ? 1 : 0;
+}
@@ -16,11 +16,34 @@
     }
 
     async function fetchHistory(url) {
-        const r = await fetch(url, { cache: "no-store" });
+        const r = await fetch(url, { cache: "no-cache" });
         if (!r.ok) throw new Error("HTTP " + r.status);
         return await r.json();
     }
 
+    // Fetch daily history in the compact columnar format and rebuild the
+    // usual { days: [ {day, ...}, ... ] } shape, so callers are unchanged.
+    async function fetchDays(url) {
+        const sep = url.includes("?") ? "&" : "?";
+        const r = await fetch(url + sep + "format=columnar", { cache: "no-cache" });
+        if (!r.ok) throw new Error("HTTP " + r.status);
+        const cols = await r.json();
+        if (!cols || !Array.isArray(cols.day))
+            throw new Error("Unexpected JSON shape");
+
+        const keys = Object.keys(cols).filter((k) => Array.isArray(cols[k]));
+        const days = cols.day.map((_, i) => {
+            const row = {};
+            for (const k of keys) row[k] = cols[k][i];
+            return row;
+        });
+
+        const out = { days };
+        for (const k of Object.keys(cols))
+            if (!Array.isArray(cols[k])) out[k] = cols[k];
+        return out;
+    }
+
     function normalizeRangeData(range) {
         return range.map((r) => ({
             t: new Date(r.time * 1000),
@@ -164,6 +187,7 @@
     global.CommonHistory = {
         buildHistoryURL,
         fetchHistory,
+        fetchDays,
         normalizeRangeData,
         autoScale,
         renderHistoryChart,
@@ -0,0 +1,194 @@
+// dest_windy.cpp - Windy PWS upload
+//  • metric fields (temp C, wind m/s, rain mm)
+//  • "too soon" rate-limit replies are not retried
+//  • queued observations go out in batches, one JSON POST per batch
+
+#include "destination.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using json = nlohmann::json;
+
+static const std::string WINDY_SOFTWARE_TYPE =
+    std::string("StellaPortaWS90-Windy-") + SOFTWARE_VERSION;
+
+static const char *WINDY_UPDATE_URL = "https://stations.windy.com/pws/update/";
+
+static constexpr size_t WINDY_MAX_BATCH = 100;   // observations per catch-up POST
+
+class WindyDestination : public Destination {
+public:
+    WindyDestination(std::string key, int interval)
+        : api_key_(std::move(key)), interval_sec_(interval) {}
+
+    const char *name() const override { return "windy"; }
+    int interval_sec() const override { return interval_sec_; }
+
+    bool observe(const json &j, std::string &q) override {
+        // Require basic fields
+        if (!j.contains("temperature_F") || !j.contains("humidity"))
+            return false;
+        if (!station_healthy(j))
+            return false;
+
+        double tempF = j.value("temperature_F", std::numeric_limits<double>::quiet_NaN());
+        if (std::isnan(tempF))
+            return false;
+
+        int humidity      = j.value("humidity", 0);
+        double wind_m     = j.value("wind_avg_m_s", 0.0);
+        double gust_m     = j.value("wind_max_m_s", 0.0);
+        int wind_dir      = j.value("wind_dir_deg", 0);
+
+        // Convert to Celsius for Windy
+        double tempC = (tempF - 32.0) * 5.0 / 9.0;
+
+        // Rain handling (inches -> mm)
+        double rain_mm = 0.0;
+        double dailyrain_mm = 0.0;
+
+        if (j.contains("rain") && j["rain"].is_object()) {
+            const auto &r = j["rain"];
+            double hourly_in = r.value("hourly_in", 0.0);
+            double daily_in  = r.value("daily_in", 0.0);
+
+            rain_mm      = hourly_in * 25.4;
+            dailyrain_mm = daily_in  * 25.4;
+        }
+
+        // UV and solar
+        double uv = j.value("uvi", 0.0);
+        double solar_wm2 = 0.0;
+
+        if (j.contains("light_lux")) {
+            double lux = j.value("light_lux", 0.0);
+            if (lux > 1.0)
+                solar_wm2 = lux * LUX_TO_WM2;
+        }
+
+        q.clear();
+
+        // Required / primary fields
+        q += "temp=" + std::to_string(tempC);
+        q += "&humidity=" + std::to_string(humidity);
+        q += "&windspeedms=" + std::to_string(wind_m);
+        q += "&windgustms=" + std::to_string(gust_m);
+        q += "&winddir=" + std::to_string(wind_dir);
+
+        // Optional rain
+        if (rain_mm > 0.0)
+            q += "&rain=" + std::to_string(rain_mm);
+        if (dailyrain_mm > 0.0)
+            q += "&dailyrain=" + std::to_string(dailyrain_mm);
+
+        // Optional UV and solar
+        if (uv > 0.0)
+            q += "&uv=" + std::to_string(uv);
+        if (solar_wm2 > 0.0)
+            q += "&solarradiation=" + std::to_string(solar_wm2);
+
+        // Software tag
+        q += "&softwaretype=" + url_encode(WINDY_SOFTWARE_TYPE);
+        return true;
+    }
+
+    void live_request(const Observation &obs, Request &req) override {
+        req.url = WINDY_UPDATE_URL + api_key_ + "?" + obs.fields + "&dateutc=now";
+    }
+
+    size_t max_batch() const override { return WINDY_MAX_BATCH; }
+
+    // Windy's bulk form: the same fields as JSON, one object per
+    // observation, each with its own time
+    size_t queued_request(const Observation *obs, size_t n, Request &req) override {
+        n = std::min(n, WINDY_MAX_BATCH);
+
+        json list = json::array();
+        for (size_t i = 0; i < n; i++) {
+            json o = query_to_json(obs[i].fields);
+            std::string t = format_utc(obs[i].ts);
+            t[10] = 'T';    // ISO 8601
+            o["station"] = 0;
+            o["dateutc"] = t;
+            list.push_back(std::move(o));
+        }
+
+        json doc;
+        doc["observations"] = std::move(list);
+
+        req.url          = WINDY_UPDATE_URL + api_key_;
+        req.body         = doc.dump();
+        req.content_type = "application/json";
+        return n;
+    }
+
+    bool accept_response(long status, const std::string &body) override {
+        // Transport-level error (already logged by the engine)
+        if (status == 0)
+            return false;
+
+        // Windy's 200 = OK
+        if (status == 200)
+            return true;
+
+        // Try parsing Windy's JSON body
+        json j = json::parse(body, nullptr, false);
+        if (j.is_discarded()) {
+            std::cerr << "[feeder] windy: invalid response: " << body << "\n";
+            return false;
+        }
+
+        // The station number is always a stringified integer
+        if (j.contains("result") && j["result"].is_object()) {
+            for (auto &entry : j["result"].items()) {
+                auto &obj = entry.value();
+
+                if (obj.contains("observations") &&
+                    obj["observations"].is_array() &&
+                    !obj["observations"].empty()) {
+
+                    auto &obs = obj["observations"][0];
+
+                    bool success = obs.value("success", true);
+
+                    if (!success) {
+                        std::string err = obs.value("error", "");
+
+                        // WINDY RATE LIMIT / TOO SOON CASE
+                        if (err.find("too soon") != std::string::npos ||
+                            err.find("interval") != std::string::npos) {
+
+                            std::cerr << "[feeder] windy: rate limit: " << err << "\n";
+
+                            // DO NOT retry
+                            return true; // Treat as handled
+                        }
+
+                        // OTHER windy-side errors
+                        std::cerr << "[feeder] windy: error: " << err << "\n";
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // Fallback: any HTTP 400 with no explicit error message
+        std::cerr << "[feeder] windy: HTTP " << status
+                  << " response='" << body << "'\n";
+        return false;
+    }
+
+private:
+    std::string api_key_;
+    int         interval_sec_;
+};
+
+std::unique_ptr<Destination> make_windy_destination(const json &cfg) {
+    std::string key = cfg.value("WINDY_API_KEY", "");
+    if (key.empty())
+        return nullptr;
+    return std::make_unique<WindyDestination>(key, cfg.value("WINDY_INTERVAL_SEC", 300));
+}
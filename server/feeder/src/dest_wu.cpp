@@ -0,0 +1,205 @@
+// dest_wu.cpp - Weather Underground PWS upload
+//  • interval rain from the backend's cumulative counter
+//  • rain rate over a trailing 10-minute window, whatever the upload interval
+//  • optional RapidFire (realtime) uploads
+//  • queued observations replayed one per request with their own dateutc
+//  • dewpoint from the backend (local fallback), with a guard
+//  • solar radiation threshold
+
+#include "destination.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <limits>
+
+using json  = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+static const std::string WU_SOFTWARE_TYPE =
+    std::string("StellaPortaWS90-") + SOFTWARE_VERSION;
+
+static const char *WU_BASE_URL =
+    "https://weatherstation.wunderground.com/weatherstation/updateweatherstation.php";
+static const char *WU_RAPIDFIRE_URL =
+    "https://rtupdate.wunderground.com/weatherstation/updateweatherstation.php";
+
+static constexpr int RAIN_RATE_WINDOW_SEC = 600;   // rainratein spans this much history
+
+class WuDestination : public Destination {
+public:
+    WuDestination(std::string id, std::string key, int interval, bool rapid_fire)
+        : station_id_(std::move(id)), station_key_(std::move(key)),
+          interval_sec_(interval), rapid_fire_(rapid_fire) {}
+
+    const char *name() const override { return "wu"; }
+    int interval_sec() const override { return interval_sec_; }
+    bool rapid_fire() const override { return rapid_fire_; }
+
+    bool observe(const json &j, std::string &q) override {
+        if (!j.contains("temperature_F") || !j.contains("humidity"))
+            return false;
+        if (!station_healthy(j))
+            return false;
+
+        double tempF = j.value("temperature_F", NAN);
+        int humidity = j.value("humidity", 0);
+        double wind_m = j.value("wind_avg_m_s", 0.0);
+        double gust_m = j.value("wind_max_m_s", 0.0);
+        int wind_dir = j.value("wind_dir_deg", 0);
+
+        double wind_mph = wind_m * MPH_PER_M_S;
+        double gust_mph = gust_m * MPH_PER_M_S;
+
+        double dailyrain_in = 0.0;
+        double counter_in   = std::numeric_limits<double>::quiet_NaN();
+
+        if (j.contains("rain")) {
+            const auto &r = j["rain"];
+            dailyrain_in = r.value("daily_in", 0.0);
+            counter_in   = r.value("counter_in", counter_in);
+        }
+
+        // Rain since the previous observation. The counter only grows, so
+        // nothing is lost to the hourly window expiring, and an observation
+        // that misses its upload is queued with its share. A smaller value
+        // means the backend lost its state; start over from there.
+        Clock::time_point now = Clock::now();
+        if (!std::isnan(counter_in) && !std::isnan(last_counter_in_) &&
+            counter_in < last_counter_in_) {
+            last_counter_in_ = std::numeric_limits<double>::quiet_NaN();
+            history_.clear();
+        }
+
+        double rain_interval_in = 0.0;
+        if (!std::isnan(counter_in) && !std::isnan(last_counter_in_))
+            rain_interval_in = counter_in - last_counter_in_;
+
+        // Rate over a trailing window of at least RAIN_RATE_WINDOW_SEC, so
+        // a single bucket tip between two uploads a few seconds apart is
+        // not reported as a downpour
+        double rain_rate_in_hr = 0.0;
+        if (!std::isnan(counter_in) && !history_.empty()) {
+            double span = std::chrono::duration<double>(now - history_.front().first).count();
+            span = std::max(span, (double)RAIN_RATE_WINDOW_SEC);
+            rain_rate_in_hr = (counter_in - history_.front().second) * 3600.0 / span;
+        }
+
+        if (!std::isnan(counter_in)) {
+            last_counter_in_ = counter_in;
+            history_.emplace_back(now, counter_in);
+            while (history_.size() > 1 &&
+                   now - history_[1].first >= std::chrono::seconds(RAIN_RATE_WINDOW_SEC))
+                history_.pop_front();
+        }
+
+        // rtfreq: seconds between updates, as actually observed
+        rt_freq_sec_ = interval_sec_;
+        if (have_last_)
+            rt_freq_sec_ = std::chrono::duration<double>(now - last_time_).count();
+        have_last_ = true;
+        last_time_ = now;
+
+        // Dew point: the backend's, computed at ingest; older backends
+        // have no "derived", so fall back to the same formula here
+        double dewF = NAN;
+        if (j.contains("derived") && j["derived"].is_object()) {
+            const auto &d = j["derived"];
+            if (d.contains("dew_point_F") && d["dew_point_F"].is_number())
+                dewF = d["dew_point_F"].get<double>();
+        }
+        if (std::isnan(dewF)) {
+            double tempC = (tempF - 32.0) * 5.0 / 9.0;
+            double rh = std::clamp<double>(humidity, 1.0, 100.0);
+            double gamma = std::log(rh / 100.0) + (17.625 * tempC) / (243.04 + tempC);
+            double dewC = 243.04 * gamma / (17.625 - gamma);
+            dewF = dewC * 9.0 / 5.0 + 32.0;
+        }
+
+        q.clear();
+        q += "tempf=" + std::to_string(tempF);
+        q += "&humidity=" + std::to_string(humidity);
+        q += "&windspeedmph=" + std::to_string(wind_mph);
+        q += "&windgustmph=" + std::to_string(gust_mph);
+        q += "&winddir=" + std::to_string(wind_dir);
+
+        if (humidity > 0)
+            q += "&dewptf=" + std::to_string(dewF);
+
+        q += "&rainin=" + std::to_string(rain_interval_in);
+        q += "&dailyrainin=" + std::to_string(dailyrain_in);
+        q += "&rainratein=" + std::to_string(rain_rate_in_hr);
+
+        if (j.contains("uvi"))
+            q += "&UV=" + std::to_string(j.value("uvi", 0.0));
+
+        if (j.contains("light_lux")) {
+            double lux = j.value("light_lux", 0.0);
+            if (lux > 1.0)
+                q += "&solarradiation=" + std::to_string(lux * LUX_TO_WM2);
+        }
+
+        q += "&softwaretype=" + url_encode(WU_SOFTWARE_TYPE);
+        return true;
+    }
+
+    void live_request(const Observation &obs, Request &req) override {
+        if (rapid_fire_) {
+            req.url = std::string(WU_RAPIDFIRE_URL) + "?" + auth() + "&dateutc=now&" +
+                      obs.fields + "&realtime=1&rtfreq=" + std::to_string(rt_freq_sec_);
+        } else {
+            req.url = std::string(WU_BASE_URL) + "?" + auth() + "&dateutc=now&" + obs.fields;
+        }
+    }
+
+    // WU has no bulk upload; each catch-up is one past-dated update
+    size_t queued_request(const Observation *obs, size_t, Request &req) override {
+        req.url = std::string(WU_BASE_URL) + "?" + auth() +
+                  "&dateutc=" + url_encode(format_utc(obs[0].ts)) + "&" + obs[0].fields;
+        return 1;
+    }
+
+    bool accept_response(long status, const std::string &body) override {
+        // Only log errors, stay silent on success
+        if (status != 200) {
+            std::cerr << "[feeder] wu: upload error: HTTP " << status
+                      << " response='" << body << "'\n";
+        }
+        return status == 200;
+    }
+
+private:
+    std::string station_id_;
+    std::string station_key_;
+    int         interval_sec_;
+    bool        rapid_fire_;
+
+    std::string auth() const {
+        return "ID=" + url_encode(station_id_) + "&PASSWORD=" + url_encode(station_key_) +
+               "&action=updateraw";
+    }
+
+    // Rain counter and time at the previous observation
+    double            last_counter_in_ = std::numeric_limits<double>::quiet_NaN();
+    Clock::time_point last_time_;
+    bool              have_last_   = false;
+    double            rt_freq_sec_ = 0.0;
+
+    // (time, counter) of the observations over the last RAIN_RATE_WINDOW_SEC
+    std::deque<std::pair<Clock::time_point, double>> history_;
+};
+
+std::unique_ptr<Destination> make_wu_destination(const json &cfg) {
+    std::string id  = cfg.value("WU_STATION_ID", "");
+    std::string key = cfg.value("WU_STATION_KEY", "");
+    if (id.empty() || key.empty())
+        return nullptr;
+
+    // RapidFire uploads follow the samples; the interval becomes a floor
+    bool rapid = cfg.value("WU_RAPIDFIRE", false);
+    int interval = rapid ? cfg.value("WU_RAPIDFIRE_MIN_SEC", 2)
+                         : cfg.value("WU_INTERVAL_SEC", 60);
+    return std::make_unique<WuDestination>(id, key, interval, rapid);
+}
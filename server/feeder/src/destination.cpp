@@ -0,0 +1,69 @@
+// destination.cpp - helpers shared by the upload destinations
+
+#include "destination.hpp"
+
+#include <cstdlib>
+
+#include <curl/curl.h>
+
+using json = nlohmann::json;
+
+std::string url_encode(const std::string &s) {
+    // The handle argument is unused by current libcurl
+    char *esc = curl_easy_escape(nullptr, s.c_str(), (int)s.size());
+    if (!esc) return "";
+    std::string out(esc);
+    curl_free(esc);
+    return out;
+}
+
+json query_to_json(const std::string &query) {
+    json out = json::object();
+    size_t p = 0;
+
+    while (p < query.size()) {
+        size_t amp = query.find('&', p);
+        if (amp == std::string::npos) amp = query.size();
+
+        std::string kv = query.substr(p, amp - p);
+        p = amp + 1;
+
+        size_t eq = kv.find('=');
+        if (eq == std::string::npos || eq == 0)
+            continue;
+
+        std::string key = kv.substr(0, eq);
+        std::string val = kv.substr(eq + 1);
+
+        char *end = nullptr;
+        double d = std::strtod(val.c_str(), &end);
+        if (!val.empty() && end && *end == 0) {
+            out[key] = d;
+            continue;
+        }
+
+        int len = 0;
+        char *dec = curl_easy_unescape(nullptr, val.c_str(), (int)val.size(), &len);
+        out[key] = dec ? std::string(dec, len) : val;
+        curl_free(dec);
+    }
+    return out;
+}
+
+std::string format_utc(std::time_t ts) {
+    struct tm tm{};
+    gmtime_r(&ts, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+    return buf;
+}
+
+bool station_healthy(const json &j) {
+    if (!j.contains("ws90_status") || !j["ws90_status"].is_object())
+        return true;
+
+    const auto &s = j["ws90_status"];
+    return s.value("http_ok", false) &&
+           s.value("rtlsdr_ok", false) &&
+           !s.value("stale", true);
+}
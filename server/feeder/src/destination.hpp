@@ -0,0 +1,100 @@
+// destination.hpp - upload targets for the feeder
+//
+// A destination turns one backend weather document into an observation,
+// turns observations into upload requests, and judges the provider's
+// reply. Everything else (scheduling, the curl handles, timeouts,
+// backoff, the offline queue, logging) belongs to the engine in
+// feeder.cpp, so adding a provider is one small file plus one line in
+// the DESTINATIONS table there.
+
+#pragma once
+
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "json.hpp"
+
+// One reading as a destination will send it: the capture time and the
+// provider's fields as a query string, without credentials or time.
+// This is what the offline queue stores.
+struct Observation {
+    std::time_t ts = 0;
+    std::string fields;
+};
+
+// An upload: a GET of url, or a POST of body when body is set
+struct Request {
+    std::string url;
+    std::string body;
+    std::string content_type;
+};
+
+class Destination {
+public:
+    virtual ~Destination() = default;
+
+    // Short name for logs, e.g. "wu"
+    virtual const char *name() const = 0;
+
+    // Seconds between uploads
+    virtual int interval_sec() const = 0;
+
+    // Rapid-fire: upload every new sample, as /api/v2/stream delivers
+    // it, instead of on a timer. interval_sec() is then the minimum
+    // spacing between two uploads.
+    virtual bool rapid_fire() const { return false; }
+
+    // Fill fields for this document. Returns false when there is nothing
+    // to send this cycle, e.g. the station is unhealthy. Every observation
+    // made is either delivered or queued, so state carried from one to the
+    // next (rain since the last one) advances here.
+    virtual bool observe(const nlohmann::json &weather, std::string &fields) = 0;
+
+    // The live upload of the observation just made
+    virtual void live_request(const Observation &obs, Request &req) = 0;
+
+    // Most queued observations one catch-up request can carry
+    virtual size_t max_batch() const { return 1; }
+
+    // A catch-up upload for obs[0..n), oldest first, each sent with its
+    // own timestamp. Returns how many of them the request carries (>= 1).
+    virtual size_t queued_request(const Observation *obs, size_t n, Request &req) = 0;
+
+    // Judge a finished upload, live or catch-up. status is 0 on a
+    // transport failure. Return true when the provider has the
+    // observations, or when retrying would not help (a rate-limit reply).
+    virtual bool accept_response(long status, const std::string &body) = 0;
+};
+
+// Each factory reads its own keys from config.json and returns nullptr
+// when they are absent, so a destination is enabled by configuring it.
+std::unique_ptr<Destination> make_wu_destination(const nlohmann::json &cfg);
+std::unique_ptr<Destination> make_windy_destination(const nlohmann::json &cfg);
+
+// ------------------------------------------------------------
+// Shared helpers (destination.cpp)
+// ------------------------------------------------------------
+
+#ifndef SOFTWARE_VERSION
+#define SOFTWARE_VERSION "dev"
+#endif
+
+static constexpr double LUX_TO_WM2 = 0.0079;
+
+// m/s to mph; one mph is exactly 0.44704 m/s (same as the backend)
+static constexpr double MPH_PER_M_S = 1.0 / 0.44704;
+
+// Percent-encode for a query string
+std::string url_encode(const std::string &s);
+
+// "k=v&k2=v2" as a JSON object: numbers where the value parses as one,
+// percent-decoded strings otherwise
+nlohmann::json query_to_json(const std::string &query);
+
+// ts as "YYYY-MM-DD HH:MM:SS" in UTC, the dateutc format
+std::string format_utc(std::time_t ts);
+
+// False when ws90_status says the reading is not live (ws90 down, SDR
+// stalled, stale sample). Documents without ws90_status pass.
+bool station_healthy(const nlohmann::json &j);
@@ -0,0 +1,571 @@
+// feeder.cpp - WS90 upload feeder (Weather Underground, Windy, ...)
+// Includes:
+//  • config.json-only configuration
+//  • one backend fetch per cycle, shared by every due destination
+//  • all transfers on one curl multi handle, no blocking sleeps
+//  • per-destination schedule and exponential backoff
+//  • rapid-fire destinations fed from /api/v2/stream, one upload per sample
+//  • bounded on-disk queue of missed observations, drained in batches
+//  • backend offline backoff logging
+//  • SOFTWARE_VERSION auto-injection support
+//
+// A slow or failing provider only delays its own next upload: each
+// destination has its own easy handle and schedule, and the single
+// event loop keeps driving every other transfer meanwhile.
+//
+// Rapid-fire destinations do not poll. While one is configured the
+// feeder holds the backend's event stream open and uploads whenever
+// sample_seq moves on, so the backend sees one idle connection however
+// short the upload interval is.
+//
+// An observation whose upload fails is queued on disk, and so is every
+// observation made while that destination stays offline. A second easy
+// handle per destination drains the queue oldest first, one request at
+// a time and at most one per DRAIN_GAP_MS, using the provider's batch
+// form when it has one. The first catch-up request that succeeds puts
+// the destination back online; live uploads never wait for the drain.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include <curl/curl.h>
+#include "json.hpp"
+#include "destination.hpp"
+#include "queue.hpp"
+
+using json  = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// ------------------------------------------------------------
+// CONSTANTS
+// ------------------------------------------------------------
+static constexpr long BACKEND_TIMEOUT_SEC = 5;
+static constexpr long UPLOAD_TIMEOUT_SEC  = 10;
+static constexpr int  BACKEND_RETRY_SEC   = 10;
+static constexpr int  RETRY_BASE_SEC      = 10;     // first retry after a failed upload
+static constexpr int  MAX_BACKOFF_SEC     = 600;    // retries double up to this
+static constexpr int  MAX_WAIT_MS         = 1000;
+static constexpr long STREAM_IDLE_SEC     = 60;     // backend publishes every 10 s
+static constexpr size_t MAX_EVENT_SIZE    = 1 << 20;
+static constexpr int  DRAIN_GAP_MS        = 1000;   // between two catch-up requests
+
+// Known destinations; each is enabled by its keys in config.json
+static const struct {
+    const char *name;
+    std::unique_ptr<Destination> (*make)(const json &cfg);
+} DESTINATIONS[] = {
+    { "wu",    make_wu_destination    },
+    { "windy", make_windy_destination },
+};
+
+// ------------------------------------------------------------
+// TRANSFER STATE
+// ------------------------------------------------------------
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto *out = static_cast<std::string *>(userdata);
+    out->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// One reusable easy handle and its receive buffer. The handle keeps its
+// options between transfers; only the request changes.
+struct Transfer {
+    CURL        *easy = nullptr;
+    std::string  body;
+    bool         busy = false;
+
+    std::string        post;                 // POST body, kept alive for curl
+    struct curl_slist *headers = nullptr;
+};
+
+struct Slot {
+    std::unique_ptr<Destination> dest;
+    Transfer          xfer;
+    Clock::time_point next_due;     // earliest next observation
+    Clock::time_point started;
+    Observation       live_obs;     // observation of the live upload in flight
+    bool              online = true;
+
+    // Rapid-fire: the sample being uploaded, and the last one handled
+    std::uint64_t     upload_seq = 0;
+    std::uint64_t     sent_seq   = 0;
+    bool              sent_any   = false;
+
+    // Offline queue and its catch-up transfer
+    std::unique_ptr<OfflineQueue> queue;
+    Transfer          drain;
+    size_t            drain_count = 0;  // observations in the request in flight
+    Clock::time_point drain_next;
+    int               drain_fails = 0;
+};
+
+struct Backend {
+    std::string       url;
+    Transfer          xfer;
+    Clock::time_point next_try;
+    int               fail_count = 0;
+};
+
+// Long-lived GET on /api/v2/stream. xfer.body collects the raw event
+// text; complete events are cut off the front after each perform.
+struct Stream {
+    std::string       url;
+    Transfer          xfer;
+    Clock::time_point next_try;
+    int               fail_count = 0;
+    bool              have   = false;   // doc holds a sample
+    json              doc;
+    std::uint64_t     seq    = 0;
+};
+
+static CURL *make_easy(Transfer &t, long timeout_sec, bool follow) {
+    CURL *c = curl_easy_init();
+    if (!c) return nullptr;
+
+    curl_easy_setopt(c, CURLOPT_TIMEOUT, timeout_sec);
+    curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, 3L);
+    curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, follow ? 1L : 0L);
+    curl_easy_setopt(c, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, &t.body);
+    curl_easy_setopt(c, CURLOPT_PRIVATE, &t);
+    return c;
+}
+
+static void start_transfer(CURLM *multi, Transfer &t, const Request &req) {
+    t.body.clear();
+    curl_easy_setopt(t.easy, CURLOPT_URL, req.url.c_str());
+
+    if (t.headers) {
+        curl_slist_free_all(t.headers);
+        t.headers = nullptr;
+    }
+    if (!req.body.empty()) {
+        t.post = req.body;
+        curl_easy_setopt(t.easy, CURLOPT_POSTFIELDS, t.post.c_str());
+        curl_easy_setopt(t.easy, CURLOPT_POSTFIELDSIZE, (long)t.post.size());
+        if (!req.content_type.empty())
+            t.headers = curl_slist_append(nullptr, ("Content-Type: " + req.content_type).c_str());
+    } else {
+        curl_easy_setopt(t.easy, CURLOPT_HTTPGET, 1L);
+    }
+    curl_easy_setopt(t.easy, CURLOPT_HTTPHEADER, t.headers);
+
+    curl_multi_add_handle(multi, t.easy);
+    t.busy = true;
+}
+
+static void start_transfer(CURLM *multi, Transfer &t, const std::string &url) {
+    Request req;
+    req.url = url;
+    start_transfer(multi, t, req);
+}
+
+static int backoff_sec(int fails) {
+    int d = RETRY_BASE_SEC;
+    for (int i = 1; i < fails && d < MAX_BACKOFF_SEC; i++)
+        d *= 2;
+    return std::min(d, MAX_BACKOFF_SEC);
+}
+
+// ------------------------------------------------------------
+// OBSERVATIONS
+// ------------------------------------------------------------
+
+// Observe doc for s. Returns false when the destination has nothing to
+// send (station not live); otherwise the observation is uploaded or, while
+// s is offline, queued for the drain.
+static bool take_observation(CURLM *multi, Slot &s, const json &doc, Clock::time_point now) {
+    Observation obs;
+    obs.ts = std::time(nullptr);
+    if (!s.dest->observe(doc, obs.fields))
+        return false;
+
+    s.started = now;
+    if (!s.online) {
+        s.queue->push(obs);
+        s.next_due = now + std::chrono::seconds(s.dest->interval_sec());
+        return true;
+    }
+
+    Request req;
+    s.dest->live_request(obs, req);
+    s.live_obs = std::move(obs);
+    start_transfer(multi, s.xfer, req);
+    return true;
+}
+
+// Start the next catch-up request if s has a backlog and may send
+static void drain_start(CURLM *multi, Slot &s, Clock::time_point now) {
+    if (s.drain.busy || s.drain_next > now)
+        return;
+
+    if (s.queue->size() == 0) {
+        // Nothing left to probe with: let the next live upload try
+        if (!s.online) {
+            s.online      = true;
+            s.drain_fails = 0;
+        }
+        return;
+    }
+
+    std::vector<Observation> batch;
+    if (s.queue->peek(s.dest->max_batch(), batch) == 0)
+        return;
+
+    Request req;
+    s.drain_count = s.dest->queued_request(batch.data(), batch.size(), req);
+    start_transfer(multi, s.drain, req);
+}
+
+// ------------------------------------------------------------
+// COMPLETIONS
+// ------------------------------------------------------------
+
+// One backend document per cycle: every destination that is due gets it
+static void backend_done(CURLM *multi, Backend &be, std::vector<Slot> &slots,
+                         CURLcode rc, long status) {
+    Clock::time_point now = Clock::now();
+
+    json j;
+    if (rc == CURLE_OK && status == 200)
+        j = json::parse(be.xfer.body, nullptr, false);
+
+    if (rc != CURLE_OK || status != 200 || j.is_discarded()) {
+        if (be.fail_count % 10 == 0)
+            std::cerr << "[feeder] backend offline (" << be.fail_count << " fails)\n";
+        be.fail_count++;
+        be.next_try = now + std::chrono::seconds(BACKEND_RETRY_SEC);
+        return;
+    }
+    be.fail_count = 0;
+
+    for (Slot &s : slots) {
+        if (s.dest->rapid_fire() || s.xfer.busy || s.next_due > now)
+            continue;
+
+        // Station not live: skip this cycle, as the old feeders did
+        if (!take_observation(multi, s, j, now))
+            s.next_due = now + std::chrono::seconds(s.dest->interval_sec());
+    }
+}
+
+// Pull complete events off the stream buffer and keep the newest
+// weather document. Events are "field: value" lines ending in a blank
+// line; only "data:" matters here.
+static void stream_drain(Stream &st) {
+    std::string &buf = st.xfer.body;
+    size_t start = 0;
+
+    for (size_t end; (end = buf.find("\n\n", start)) != std::string::npos; start = end + 2) {
+        std::string data;
+        for (size_t p = start; p < end; ) {
+            size_t nl = buf.find('\n', p);
+            if (nl == std::string::npos || nl > end) nl = end;
+            if (buf.compare(p, 6, "data: ") == 0)
+                data.append(buf, p + 6, nl - p - 6);
+            p = nl + 1;
+        }
+        if (data.empty())
+            continue;   // retry hint or comment
+
+        json j = json::parse(data, nullptr, false);
+        if (j.is_discarded() || !j.contains("sample_seq"))
+            continue;
+        st.doc  = std::move(j);
+        st.seq  = st.doc.value("sample_seq", (std::uint64_t)0);
+        st.have = true;
+        st.fail_count = 0;
+    }
+    buf.erase(0, start);
+
+    if (buf.size() > MAX_EVENT_SIZE) {
+        std::cerr << "[feeder] stream: oversized event dropped\n";
+        buf.clear();
+    }
+}
+
+// Start an upload on every idle, due rapid-fire slot behind the stream
+static void stream_dispatch(CURLM *multi, Stream &st, std::vector<Slot> &slots) {
+    if (!st.have)
+        return;
+    Clock::time_point now = Clock::now();
+
+    for (Slot &s : slots) {
+        if (!s.dest->rapid_fire() || s.xfer.busy || s.next_due > now)
+            continue;
+        if (s.sent_any && s.sent_seq == st.seq)
+            continue;
+
+        // Not live, or queued while offline: either way this sample is done
+        s.upload_seq = st.seq;
+        if (!take_observation(multi, s, st.doc, now) || !s.xfer.busy) {
+            s.sent_seq = st.seq;
+            s.sent_any = true;
+        }
+    }
+}
+
+static void stream_done(Stream &st, CURLcode rc, long status) {
+    if (st.fail_count % 10 == 0) {
+        std::cerr << "[feeder] stream closed (";
+        if (rc != CURLE_OK) std::cerr << curl_easy_strerror(rc);
+        else                std::cerr << "HTTP " << status;
+        std::cerr << "), reconnecting in " << BACKEND_RETRY_SEC << " sec\n";
+    }
+    st.fail_count++;
+    st.next_try = Clock::now() + std::chrono::seconds(BACKEND_RETRY_SEC);
+}
+
+static void upload_done(Slot &s, CURLcode rc, long status) {
+    Clock::time_point now = Clock::now();
+
+    if (rc != CURLE_OK) {
+        std::cerr << "[feeder] " << s.dest->name() << ": CURL error: "
+                  << curl_easy_strerror(rc) << "\n";
+        status = 0;
+    }
+
+    // Delivered or queued, the observation is handled and the schedule
+    // keeps its cadence
+    s.next_due = s.started + std::chrono::seconds(s.dest->interval_sec());
+    s.sent_seq = s.upload_seq;
+    s.sent_any = true;
+
+    if (s.dest->accept_response(status, s.xfer.body))
+        return;
+
+    s.queue->push(s.live_obs);
+    s.online      = false;
+    s.drain_fails = 1;
+    s.drain_next  = now + std::chrono::seconds(backoff_sec(s.drain_fails));
+    std::cerr << "[feeder] " << s.dest->name() << ": upload failed, offline: queueing ("
+              << s.queue->size() << " pending), retrying in "
+              << backoff_sec(s.drain_fails) << " sec\n";
+}
+
+static void drain_done(Slot &s, CURLcode rc, long status) {
+    Clock::time_point now = Clock::now();
+
+    if (rc != CURLE_OK) {
+        std::cerr << "[feeder] " << s.dest->name() << ": catch-up CURL error: "
+                  << curl_easy_strerror(rc) << "\n";
+        status = 0;
+    }
+
+    if (s.dest->accept_response(status, s.drain.body)) {
+        s.queue->pop(s.drain_count);
+        if (!s.online)
+            std::cerr << "[feeder] " << s.dest->name() << ": back online, "
+                      << s.queue->size() << " queued\n";
+        else if (s.queue->size() == 0)
+            std::cerr << "[feeder] " << s.dest->name() << ": caught up\n";
+        s.online      = true;
+        s.drain_fails = 0;
+        s.drain_next  = now + std::chrono::milliseconds(DRAIN_GAP_MS);
+        return;
+    }
+
+    // The provider refused these observations; resending won't change that
+    if (status >= 400 && status < 500) {
+        std::cerr << "[feeder] " << s.dest->name() << ": dropping " << s.drain_count
+                  << " rejected queued observations\n";
+        s.queue->pop(s.drain_count);
+        s.drain_next = now + std::chrono::milliseconds(DRAIN_GAP_MS);
+        return;
+    }
+
+    s.drain_fails++;
+    int wait = backoff_sec(s.drain_fails);
+    if (s.online)
+        std::cerr << "[feeder] " << s.dest->name() << ": catch-up failed, retrying in "
+                  << wait << " sec\n";
+    s.drain_next = now + std::chrono::seconds(wait);
+}
+
+// ------------------------------------------------------------
+// MAIN LOOP
+// ------------------------------------------------------------
+
+int main() {
+    json cfg;
+
+    try {
+        std::ifstream f("config.json");
+        if (!f.good()) {
+            std::cerr << "[feeder] ERROR: config.json not found\n";
+            return 1;
+        }
+        f >> cfg;
+    } catch (...) {
+        std::cerr << "[feeder] ERROR: invalid config.json\n";
+        return 1;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    Backend be;
+    be.url = cfg.value("BACKEND_URL", "http://localhost:8889/api/v2/weather");
+    be.xfer.easy = make_easy(be.xfer, BACKEND_TIMEOUT_SEC, false);
+
+    Stream stream;
+    stream.url = cfg.value("BACKEND_STREAM_URL", "http://localhost:8889/api/v2/stream");
+    stream.xfer.easy = make_easy(stream.xfer, 0, false);
+    if (stream.xfer.easy) {
+        // No overall timeout; a stream silent for STREAM_IDLE_SEC is dead
+        curl_easy_setopt(stream.xfer.easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(stream.xfer.easy, CURLOPT_LOW_SPEED_TIME, STREAM_IDLE_SEC);
+    }
+
+    std::vector<Slot> slots;
+    for (const auto &d : DESTINATIONS) {
+        std::unique_ptr<Destination> dest = d.make(cfg);
+        if (!dest)
+            continue;
+        slots.emplace_back();
+        slots.back().dest = std::move(dest);
+    }
+
+    if (slots.empty()) {
+        std::cerr << "[feeder] ERROR: no destination configured "
+                     "(set WU_STATION_ID/WU_STATION_KEY and/or WINDY_API_KEY)\n";
+        return 1;
+    }
+
+    CURLM *multi = curl_multi_init();
+    if (!multi || !be.xfer.easy || !stream.xfer.easy) {
+        std::cerr << "[feeder] ERROR: curl init failed\n";
+        return 1;
+    }
+
+    std::cout << "[feeder] starting\n";
+    std::cout << "  backend_url=" << be.url << "\n";
+
+    // Missed observations survive restarts here, one file per destination
+    std::string queue_dir = cfg.value("QUEUE_DIR", "queue");
+    size_t      queue_max = cfg.value("QUEUE_MAX", 5000);
+    if (mkdir(queue_dir.c_str(), 0755) != 0 && errno != EEXIST)
+        std::cerr << "[feeder] queue: cannot create " << queue_dir << ": "
+                  << std::strerror(errno) << "\n";
+    std::cout << "  queue_dir=" << queue_dir << " (max " << queue_max << " per destination)\n";
+
+    bool want_stream = false;
+    for (const Slot &s : slots)
+        if (s.dest->rapid_fire()) want_stream = true;
+    if (want_stream)
+        std::cout << "  stream_url=" << stream.url << "\n";
+
+    Clock::time_point start = Clock::now();
+    be.next_try     = start;
+    stream.next_try = start;
+    for (Slot &s : slots) {
+        // Handles last for the process; their pointers must not move
+        s.xfer.easy  = make_easy(s.xfer,  UPLOAD_TIMEOUT_SEC, true);
+        s.drain.easy = make_easy(s.drain, UPLOAD_TIMEOUT_SEC, true);
+        if (!s.xfer.easy || !s.drain.easy) {
+            std::cerr << "[feeder] ERROR: curl init failed\n";
+            return 1;
+        }
+        s.queue = std::make_unique<OfflineQueue>();
+        s.queue->open(queue_dir + "/" + s.dest->name() + ".queue", queue_max);
+        s.next_due   = start;
+        s.drain_next = start;
+        std::cout << "  " << s.dest->name() << ": interval="
+                  << s.dest->interval_sec() << " sec"
+                  << (s.dest->rapid_fire() ? " (rapid-fire)" : "") << "\n";
+    }
+
+    while (true) {
+        Clock::time_point now = Clock::now();
+
+        // Fetch a document once any idle destination is due
+        bool due = false;
+        for (const Slot &s : slots)
+            if (!s.dest->rapid_fire() && !s.xfer.busy && s.next_due <= now) due = true;
+        if (due && !be.xfer.busy && be.next_try <= now)
+            start_transfer(multi, be.xfer, be.url);
+
+        if (want_stream && !stream.xfer.busy && stream.next_try <= now)
+            start_transfer(multi, stream.xfer, stream.url);
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        if (want_stream)
+            stream_drain(stream);
+
+        int left = 0;
+        while (CURLMsg *msg = curl_multi_info_read(multi, &left)) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            CURL *easy     = msg->easy_handle;
+            CURLcode rc    = msg->data.result;
+            long status    = 0;
+            Transfer *t    = nullptr;
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &t);
+            curl_multi_remove_handle(multi, easy);
+            t->busy = false;
+
+            if (t == &be.xfer) {
+                backend_done(multi, be, slots, rc, status);
+                continue;
+            }
+            if (t == &stream.xfer) {
+                stream_drain(stream);
+                stream_done(stream, rc, status);
+                continue;
+            }
+            for (Slot &s : slots) {
+                if (t == &s.xfer)  upload_done(s, rc, status);
+                if (t == &s.drain) drain_done(s, rc, status);
+            }
+        }
+
+        // Uploads freed above may pick up a sample that is already here
+        if (want_stream)
+            stream_dispatch(multi, stream, slots);
+
+        now = Clock::now();
+        for (Slot &s : slots)
+            drain_start(multi, s, now);
+
+        // Sleep until a transfer has work or the next destination is due.
+        // New stream data wakes the poll by itself.
+        now = Clock::now();
+        Clock::time_point wake = now + std::chrono::milliseconds(MAX_WAIT_MS);
+        for (const Slot &s : slots) {
+            if (s.xfer.busy)
+                continue;
+            if (!s.dest->rapid_fire())
+                wake = std::min(wake, std::max(s.next_due, be.next_try));
+            else if (stream.have && !(s.sent_any && s.sent_seq == stream.seq))
+                wake = std::min(wake, s.next_due);
+        }
+        if (want_stream && !stream.xfer.busy)
+            wake = std::min(wake, stream.next_try);
+        for (const Slot &s : slots)
+            if (!s.drain.busy && s.queue->size() > 0)
+                wake = std::min(wake, s.drain_next);
+
+        int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+        curl_multi_poll(multi, nullptr, 0, std::max(wait_ms, 0), nullptr);
+    }
+
+    curl_multi_cleanup(multi);
+    curl_global_cleanup();
+    return 0;
+}
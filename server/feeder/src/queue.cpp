@@ -0,0 +1,207 @@
+// queue.cpp - bounded on-disk observation queue
+
+#include "queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File layout (host byte order, like the backend checkpoint):
+//   header: magic[4] "FQ01", u32 record_size, u64 head
+//   record: i64 ts, u16 len, fields[len], zero padding to RECORD_SIZE
+static const char   QUEUE_MAGIC[4] = { 'F', 'Q', '0', '1' };
+static constexpr size_t HEADER_SIZE   = 16;
+static constexpr size_t RECORD_HDR    = 10;
+static constexpr size_t MAX_FIELDS    = OfflineQueue::RECORD_SIZE - RECORD_HDR;
+static constexpr std::uint64_t COMPACT_MIN = 256;   // dead records before a rewrite
+
+static off_t record_off(std::uint64_t i) {
+    return (off_t)(HEADER_SIZE + i * OfflineQueue::RECORD_SIZE);
+}
+
+static bool write_header(int fd, std::uint64_t head) {
+    char hdr[HEADER_SIZE] = {};
+    std::uint32_t rs = OfflineQueue::RECORD_SIZE;
+    std::memcpy(hdr,     QUEUE_MAGIC, 4);
+    std::memcpy(hdr + 4, &rs,   4);
+    std::memcpy(hdr + 8, &head, 8);
+    return pwrite(fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr);
+}
+
+OfflineQueue::~OfflineQueue() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool OfflineQueue::open(const std::string &path, size_t max_records) {
+    path_ = path;
+    max_  = max_records;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[feeder] queue: cannot open " << path << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat sb;
+    if (fstat(fd_, &sb) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    char hdr[HEADER_SIZE];
+    std::uint32_t rs = 0;
+    bool valid = (size_t)sb.st_size >= HEADER_SIZE &&
+                 pread(fd_, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+                 std::memcmp(hdr, QUEUE_MAGIC, 4) == 0;
+    if (valid) {
+        std::memcpy(&rs,    hdr + 4, 4);
+        std::memcpy(&head_, hdr + 8, 8);
+        valid = (rs == RECORD_SIZE);
+    }
+
+    if (!valid) {
+        if (sb.st_size > 0)
+            std::cerr << "[feeder] queue: ignoring invalid " << path << "\n";
+        head_ = tail_ = 0;
+        if (ftruncate(fd_, 0) != 0 || !write_header(fd_, 0)) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    // A torn final append is dropped
+    tail_ = ((std::uint64_t)sb.st_size - HEADER_SIZE) / RECORD_SIZE;
+    if (ftruncate(fd_, record_off(tail_)) != 0) { /* keep going; tail_ bounds reads */ }
+    if (head_ > tail_) head_ = tail_;
+
+    if (size() > max_) {
+        std::cerr << "[feeder] queue: " << path << " holds " << size()
+                  << " records, keeping the newest " << max_ << "\n";
+        head_ = tail_ - max_;
+        write_head();
+    }
+    compact();
+
+    if (size() > 0)
+        std::cout << "[feeder] queue: " << size() << " pending in " << path << "\n";
+    return true;
+}
+
+bool OfflineQueue::push(const Observation &obs) {
+    if (fd_ < 0)
+        return false;
+    if (obs.fields.size() > MAX_FIELDS) {
+        std::cerr << "[feeder] queue: observation too large (" << obs.fields.size()
+                  << " bytes), not queued\n";
+        return false;
+    }
+
+    char rec[RECORD_SIZE] = {};
+    std::int64_t  ts  = (std::int64_t)obs.ts;
+    std::uint16_t len = (std::uint16_t)obs.fields.size();
+    std::memcpy(rec,     &ts,  8);
+    std::memcpy(rec + 8, &len, 2);
+    std::memcpy(rec + RECORD_HDR, obs.fields.data(), len);
+
+    if (pwrite(fd_, rec, sizeof(rec), record_off(tail_)) != (ssize_t)sizeof(rec)) {
+        std::cerr << "[feeder] queue: write failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    fdatasync(fd_);
+    tail_++;
+
+    if (size() > max_) {
+        if (dropped_++ % 100 == 0)
+            std::cerr << "[feeder] queue: " << path_ << " full, dropping oldest ("
+                      << dropped_ << " so far)\n";
+        head_++;
+        write_head();
+        compact();
+    }
+    return true;
+}
+
+size_t OfflineQueue::peek(size_t n, std::vector<Observation> &out) const {
+    out.clear();
+    if (fd_ < 0)
+        return 0;
+
+    n = std::min(n, size());
+    char rec[RECORD_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        if (pread(fd_, rec, sizeof(rec), record_off(head_ + i)) != (ssize_t)sizeof(rec))
+            break;
+
+        std::int64_t  ts;
+        std::uint16_t len;
+        std::memcpy(&ts,  rec,     8);
+        std::memcpy(&len, rec + 8, 2);
+        if (len > MAX_FIELDS)
+            len = 0;
+
+        Observation o;
+        o.ts = (std::time_t)ts;
+        o.fields.assign(rec + RECORD_HDR, len);
+        out.push_back(std::move(o));
+    }
+    return out.size();
+}
+
+void OfflineQueue::pop(size_t n) {
+    if (fd_ < 0)
+        return;
+
+    head_ += std::min(n, size());
+    if (head_ == tail_) {
+        // Drained: back to an empty file
+        head_ = tail_ = 0;
+        if (ftruncate(fd_, record_off(0)) != 0) { /* stale records past head are harmless */ }
+    }
+    write_head();
+    compact();
+}
+
+bool OfflineQueue::write_head() {
+    return write_header(fd_, head_);
+}
+
+// Rewrite the file without the delivered prefix, once it is at least
+// COMPACT_MIN records and half the file. The copy goes to a temp file
+// that replaces the queue in one rename, so a crash leaves either one.
+void OfflineQueue::compact() {
+    if (fd_ < 0 || head_ < COMPACT_MIN || head_ * 2 < tail_)
+        return;
+
+    std::string tmp = path_ + ".tmp";
+    int out = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+        return;
+
+    bool ok = write_header(out, 0);
+    char rec[RECORD_SIZE];
+    for (std::uint64_t i = head_; ok && i < tail_; i++) {
+        ok = pread(fd_, rec, sizeof(rec), record_off(i)) == (ssize_t)sizeof(rec) &&
+             pwrite(out, rec, sizeof(rec), record_off(i - head_)) == (ssize_t)sizeof(rec);
+    }
+    if (ok) ok = fsync(out) == 0;
+    if (!ok || std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        ::close(out);
+        ::unlink(tmp.c_str());
+        return;
+    }
+
+    ::close(fd_);
+    fd_    = out;
+    tail_ -= head_;
+    head_  = 0;
+}
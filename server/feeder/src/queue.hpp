@@ -0,0 +1,53 @@
+// queue.hpp - bounded on-disk queue of observations that missed their upload
+//
+// One file per destination: a small header, then fixed-size records
+// appended in capture order. Record i lives at HEADER + i * RECORD_SIZE,
+// so the file can be read with pread or mmap without parsing. Delivered
+// records are not rewritten; the header's head index moves past them, and
+// the file is compacted once the dead prefix is large. Past max_records
+// the oldest pending record is dropped.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "destination.hpp"
+
+class OfflineQueue {
+public:
+    static constexpr size_t RECORD_SIZE = 512;
+
+    OfflineQueue() = default;
+    ~OfflineQueue();
+    OfflineQueue(const OfflineQueue &) = delete;
+    OfflineQueue &operator=(const OfflineQueue &) = delete;
+
+    // Open or create path. Returns false (and logs) when the file can't
+    // be used; the queue then stays empty and push() fails.
+    bool open(const std::string &path, size_t max_records);
+
+    // Append one observation, synced to disk before returning
+    bool push(const Observation &obs);
+
+    // Copy up to n of the oldest pending observations into out
+    size_t peek(size_t n, std::vector<Observation> &out) const;
+
+    // Forget the n oldest pending observations
+    void pop(size_t n);
+
+    size_t size() const { return (size_t)(tail_ - head_); }
+
+private:
+    bool write_head();
+    void compact();
+
+    int           fd_   = -1;
+    std::string   path_;
+    size_t        max_  = 0;
+    std::uint64_t head_ = 0;     // first pending record
+    std::uint64_t tail_ = 0;     // records in the file
+    std::uint64_t dropped_ = 0;
+};
@@ -0,0 +1,223 @@
+/*
+    ws90_replay - feed a recorded rtl_433 stream through ws90_api
+
+    ws90_api.cpp is compiled into this program without its main(), so
+    the bytes go through the same process_fifo_bytes(), scanner, filters
+    and station table as FIFO reads do, with no FIFO, HTTP or push.
+
+    Input is a file of rtl_433 JSON lines (as written by -F json:<file>)
+    or a synthetic stream mixing WS90 frames with other sensors. Without
+    --rate the whole stream is fed as fast as possible in --chunk sized
+    reads, cut anywhere like a pipe would. With --rate, lines are fed on
+    a schedule of that many per second, and lag is how far the feed fell
+    behind it.
+
+    Prints one JSON object (also appended to --out).
+
+    Run:
+        ./bin/ws90_replay --synthetic 200000
+        ./bin/ws90_replay --file capture.json --repeat 20 --chunk 512
+        ./bin/ws90_replay --file capture.json --rate 2000 --id 52127
+*/
+
+#define WS90_API_NO_MAIN
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../src/ws90_api.cpp"
+#pragma GCC diagnostic pop
+
+#include <fstream>
+#include <sstream>
+
+struct ReplayOptions {
+    std::string file;
+    long        synthetic = 0;      // lines to generate when no file
+    double      rate      = 0;      // lines per second, 0 = unthrottled
+    size_t      chunk     = MAX_FIFO_CHUNK;
+    int         repeat    = 1;
+    std::string out;
+};
+
+// Roughly what a suburban 433 MHz band sounds like: one WS90 frame for
+// every three or four from a neighbour's sensors, some of which carry an
+// "id" field of their own
+static std::vector<std::string> synthetic_lines(long n) {
+    static const char *OTHERS[] = {
+        "{\"time\" : \"2025-12-08 18:21:%02d\", \"model\" : \"Acurite-Tower\", \"id\" : %d, "
+        "\"channel\" : \"A\", \"battery_ok\" : 1, \"temperature_C\" : 3.%d, \"humidity\" : 71, "
+        "\"mic\" : \"CHECKSUM\"}",
+        "{\"time\" : \"2025-12-08 18:21:%02d\", \"model\" : \"LaCrosse-TX141THBv2\", \"id\" : %d, "
+        "\"channel\" : 0, \"battery_ok\" : 1, \"temperature_C\" : 2.%d, \"humidity\" : 80, "
+        "\"test\" : \"No\"}",
+        "{\"time\" : \"2025-12-08 18:21:%02d\", \"model\" : \"Schrader-EG53MA4\", \"type\" : \"TPMS\", "
+        "\"flags\" : \"7c0200\", \"id\" : \"%d\", \"pressure_kPa\" : 22%d.000, "
+        "\"temperature_C\" : 9.000, \"mic\" : \"CHECKSUM\"}",
+    };
+
+    std::vector<std::string> lines;
+    lines.reserve((size_t)n);
+    char buf[512];
+    for (long i = 0; i < n; i++) {
+        int sec = (int)(i % 60);
+        if (i % 4 == 0) {
+            snprintf(buf, sizeof(buf),
+                "{\"time\" : \"2025-12-08 18:21:%02d\", \"model\" : \"Fineoffset-WS90\", "
+                "\"id\" : %d, \"battery_ok\" : 0.860, \"battery_mV\" : 3180, "
+                "\"temperature_C\" : 4.%d, \"humidity\" : 82, \"wind_dir_deg\" : %d, "
+                "\"wind_avg_m_s\" : 1.800, \"wind_max_m_s\" : 4.400, \"uvi\" : 0.000, "
+                "\"light_lux\" : 2725.000, \"flags\" : 130, \"rain_mm\" : %.1f, "
+                "\"supercap_V\" : 5.400, \"firmware\" : 126, "
+                "\"data\" : \"3fff000000------0000ff7ff70000\", \"mic\" : \"CRC\"}",
+                sec, i % 8 == 0 ? 52127 : 40211, (int)(i % 10), (int)(i * 7 % 360),
+                118.9 + 0.1 * (double)(i / 400));
+        } else {
+            snprintf(buf, sizeof(buf), OTHERS[i % 3], sec, (int)(1000 + i % 37), (int)(i % 10));
+        }
+        lines.push_back(buf);
+    }
+    return lines;
+}
+
+static bool read_lines(const std::string &path, std::vector<std::string> &lines) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string l;
+    while (std::getline(in, l)) {
+        if (!l.empty())
+            lines.push_back(l);
+    }
+    return true;
+}
+
+static double cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void replay_usage(const char *prog) {
+    std::fprintf(stderr,
+        "Usage:\n"
+        "  %s (--file <rtl_433 json> | --synthetic <lines>) [--rate <lines/s>]\n"
+        "     [--chunk <bytes>] [--repeat <n>] [--id <station>]... [--model <name>]...\n"
+        "     [--out <file>]\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--file" && more)            opt.file      = argv[++i];
+        else if (a == "--synthetic" && more)  opt.synthetic = std::atol(argv[++i]);
+        else if (a == "--rate" && more)       opt.rate      = std::atof(argv[++i]);
+        else if (a == "--chunk" && more)      opt.chunk     = (size_t)std::max(1L, std::atol(argv[++i]));
+        else if (a == "--repeat" && more)     opt.repeat    = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--out" && more)        opt.out       = argv[++i];
+        else if (a == "--id" && more)         filter_ids.insert(std::atol(argv[++i]));
+        else if (a == "--model" && more) {
+            const char *m = argv[++i];
+            if (std::strcmp(m, "any") == 0) any_model = true;
+            else filter_models.push_back(std::string("\"") + m + "\"");
+        } else {
+            replay_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<std::string> lines;
+    if (!opt.file.empty()) {
+        if (!read_lines(opt.file, lines)) {
+            std::fprintf(stderr, "replay: cannot read %s\n", opt.file.c_str());
+            return 1;
+        }
+    } else if (opt.synthetic > 0) {
+        lines = synthetic_lines(opt.synthetic);
+    } else {
+        replay_usage(argv[0]);
+        return 2;
+    }
+    if (lines.empty()) {
+        std::fprintf(stderr, "replay: no input lines\n");
+        return 1;
+    }
+
+    std::string stream;
+    for (const std::string &l : lines) {
+        stream += l;
+        stream += '\n';
+    }
+
+    auto t0   = std::chrono::steady_clock::now();
+    double c0 = cpu_seconds();
+    double max_lag = 0;
+
+    if (opt.rate <= 0) {
+        for (int r = 0; r < opt.repeat; r++) {
+            for (size_t off = 0; off < stream.size(); off += opt.chunk)
+                process_fifo_bytes(stream.data() + off,
+                                   (ssize_t)std::min(opt.chunk, stream.size() - off));
+        }
+    } else {
+        long k = 0;
+        for (int r = 0; r < opt.repeat; r++) {
+            for (const std::string &l : lines) {
+                auto due = t0 + std::chrono::duration<double>((double)k++ / opt.rate);
+                auto now = std::chrono::steady_clock::now();
+                if (due > now)
+                    std::this_thread::sleep_until(due);
+                else
+                    max_lag = std::max(max_lag, std::chrono::duration<double>(now - due).count());
+
+                std::string one = l + "\n";
+                for (size_t off = 0; off < one.size(); off += opt.chunk)
+                    process_fifo_bytes(one.data() + off,
+                                       (ssize_t)std::min(opt.chunk, one.size() - off));
+            }
+        }
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double cpu  = cpu_seconds() - c0;
+
+    unsigned long long published = 0;
+    for (const auto &kv : stations)
+        published += kv.second.frames;
+    auto get = [](const Counter &c) { return c.load(std::memory_order_relaxed); };
+
+    json r;
+    r["suite"]            = "ws90_replay";
+    r["input"]            = opt.file.empty() ? "synthetic" : opt.file;
+    r["lines"]            = lines.size() * (size_t)opt.repeat;
+    r["rate"]             = opt.rate;
+    r["chunk"]            = opt.chunk;
+    r["bytes"]            = get(m_fifo_bytes);
+    r["reads"]            = get(m_fifo_reads);
+    r["frames"]           = get(m_frames);
+    r["frames_filtered"]  = get(m_frames_filtered);
+    r["parse_failures"]   = get(m_parse_failures);
+    r["frames_truncated"] = get(m_frames_truncated);
+    r["frames_oversized"] = get(m_frames_oversized);
+    r["published"]        = published;
+    r["stations"]         = stations.size();
+    r["wall_s"]           = wall;
+    r["cpu_s"]            = cpu;
+    r["cpu_pct"]          = wall > 0 ? 100.0 * cpu / wall : 0.0;
+    r["mb_per_cpu_s"]     = cpu > 0 ? (double)get(m_fifo_bytes) / 1e6 / cpu : 0.0;
+    r["ns_per_frame"]     = get(m_frames) ? cpu * 1e9 / (double)get(m_frames) : 0.0;
+    if (opt.rate > 0)
+        r["max_lag_ms"]   = max_lag * 1000.0;
+
+    std::string out = r.dump();
+    std::printf("%s\n", out.c_str());
+    if (!opt.out.empty()) {
+        std::FILE *f = std::fopen(opt.out.c_str(), "a");
+        if (f) {
+            std::fprintf(f, "%s\n", out.c_str());
+            std::fclose(f);
+        }
+    }
+    return 0;
+}
@@ -54,8 +54,52 @@ cleanup() {
 
 trap cleanup INT TERM
 
+# ----------------------------------------------------------------------
+# STATIONS
+#
+# WS90_IDS is a comma list of WS90 ids to keep (default 52127); set it to
+# "any" to keep every WS90 heard. Each one is served as /ws90/<id>, and
+# /ws90 serves the newest frame of any of them. EXTRA_MODELS adds other
+# rtl_433 models (comma list, or "any"), served under /stations:
+#
+#     environment:
+#       - WS90_IDS=52127,40211
+#       - EXTRA_MODELS=Acurite-Tower
+#
+# ----------------------------------------------------------------------
+set --
+WS90_IDS="${WS90_IDS:-52127}"
+if [ "$WS90_IDS" != "any" ]; then
+    for id in $(echo "$WS90_IDS" | tr ',' ' '); do
+        set -- "$@" --id "$id"
+    done
+fi
+for model in $(echo "${EXTRA_MODELS:-}" | tr ',' ' '); do
+    set -- "$@" --model "$model"
+done
+
+# ----------------------------------------------------------------------
+# OPTIONAL PUSH MODE
+#
+# By default the backend polls ws90_api every 10 s. Set PUSH_URL to have
+# ws90_api POST every frame to the backend the moment it is decoded
+# (the backend must have "ws90_mode": "push" in its config.json):
+#
+#     environment:
+#       - PUSH_URL=http://172.17.0.1:8889/ws90
+#       - PUSH_TOKEN=...        # only if ws90_push_token is set
+#
+# ----------------------------------------------------------------------
+if [ -n "$PUSH_URL" ]; then
+    echo "[entrypoint] pushing frames to $PUSH_URL"
+    set -- "$@" --push "$PUSH_URL"
+    if [ -n "$PUSH_TOKEN" ]; then
+        set -- "$@" --push-token "$PUSH_TOKEN"
+    fi
+fi
+
 echo "[entrypoint] starting ws90_api"
-/usr/local/bin/ws90_api --id 52127
+/usr/local/bin/ws90_api "$@"
 
 echo "[entrypoint] ws90_api exited, cleaning up"
 cleanup
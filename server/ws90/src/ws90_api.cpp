@@ -11,15 +11,19 @@
         * Reads FIFO /tmp/ws90.fifo from rtl_433
         * Handles partial JSON fragments
         * Extracts **complete JSON objects** safely
-        * Optionally filters by --id <station_id>
+        * Keeps the latest frame of every station heard (model + id)
+        * Optionally filters by --model <name> and --id <station_id>
+        * Optionally pushes each frame to the backend (--push <url>)
         * Provides small REST HTTP server on port 7890
+        * Single epoll loop: FIFO and HTTP clients, no polling
         * Structured JSON error responses
+        * Prometheus counters on /metrics
         * CORS support
         * Detects stale data
         * MIT open source
 
     Compile:
-        g++ -O2 -Wall -Wextra -std=c++17 \
+        g++ -O2 -Wall -Wextra -std=c++17 -pthread \
             -o ws90_api ws90_api.cpp
 
     FIFO setup:
@@ -32,26 +36,41 @@
     Run:
         ./ws90_api                (promiscuous mode)
         ./ws90_api --id 52127     (filter WS90 device)
+        ./ws90_api --id 52127 --id 40211
+                                  (two WS90s, served as /ws90/<id>)
+        ./ws90_api --model any    (every rtl_433 sensor, see /stations)
+        ./ws90_api --id 52127 --push http://172.17.0.1:8889/ws90
+                                  (also POST every frame to the backend)
 */
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <signal.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <cstdarg>
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
 #include <optional>
+#include <memory>
 #include <ctime>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <strings.h>
 
 #include "json.hpp"       // nlohmann::json
 
@@ -62,34 +81,54 @@ using json = nlohmann::json;
 #define STALE_SECONDS 30
 #define MAX_FIFO_CHUNK 2048
 #define MAX_JSON_SIZE 8192
+#define MAX_STATIONS 64
 
-static std::string latest_json;
-static bool have_json = false;
+#define WS90_MODEL "Fineoffset-WS90"
+
+static std::shared_ptr<const std::string> latest_json;    // newest WS90 frame, any id
 static time_t last_update = 0;
 
-static std::optional<int> filter_id;
+// Scan-time filters. WS90 is always kept, --model adds more. --id
+// applies to WS90 frames only; none given keeps every WS90.
+static std::vector<std::string> filter_models = { "\"" WS90_MODEL "\"" };  // quoted
+static bool                     any_model = false;
+static std::set<long>           filter_ids;
 
 // ---------------------------------------------------------
-// Safe socket writer
+// Metrics (/metrics)
+//
+// Relaxed atomic counters, so the push thread can count without a lock
+// and a scrape never stalls the FIFO. The push time histogram has fixed
+// buckets; the station table is read at scrape time.
 // ---------------------------------------------------------
-static void sock_printf(int fd, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    vdprintf(fd, fmt, ap);
-    va_end(ap);
+using Counter = std::atomic<unsigned long long>;
+
+static Counter m_fifo_bytes{0};
+static Counter m_fifo_reads{0};
+static Counter m_frames{0};            // complete objects seen on the FIFO
+static Counter m_frames_filtered{0};   // ... not matching --model / --id
+static Counter m_parse_failures{0};    // ... wanted but not valid JSON
+static Counter m_frames_truncated{0};  // cut short by a newline
+static Counter m_frames_oversized{0};  // past MAX_JSON_SIZE
+static Counter m_pushes{0};            // POSTs answered 2xx
+static Counter m_push_rejected{0};     // POSTs answered otherwise
+static Counter m_push_failures{0};     // connection errors
+
+static const double PUSH_BOUNDS_SEC[] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                          0.1, 0.25, 0.5, 1, 2.5 };
+static constexpr size_t PUSH_NBOUNDS = sizeof(PUSH_BOUNDS_SEC) / sizeof(PUSH_BOUNDS_SEC[0]);
+static Counter m_push_buckets[PUSH_NBOUNDS + 1];   // last is +Inf
+static Counter m_push_sum_us{0};
+
+static void count(Counter &c, unsigned long long n = 1) {
+    c.fetch_add(n, std::memory_order_relaxed);
 }
 
-// ---------------------------------------------------------
-// Unified JSON response
-// ---------------------------------------------------------
-static void send_json_response(int client, int code, const char *reason, const std::string &body) {
-    sock_printf(client,
-        "HTTP/1.1 %d %s\r\n"
-        "Access-Control-Allow-Origin: *\r\n"
-        "Content-Type: application/json\r\n"
-        "Connection: close\r\n\r\n"
-        "%s\n",
-        code, reason, body.c_str());
+static void observe_push(double sec) {
+    size_t i = 0;
+    while (i < PUSH_NBOUNDS && sec > PUSH_BOUNDS_SEC[i]) i++;
+    count(m_push_buckets[i]);
+    count(m_push_sum_us, (unsigned long long)(sec * 1e6));
 }
 
 // ---------------------------------------------------------
@@ -121,144 +160,860 @@ static int setup_fifo() {
 // ---------------------------------------------------------
 // JSON extraction from FIFO stream
 //
-// rtl_433 may send partial objects or more than one.
-// We scan for '{' … '}' balanced objects and parse them.
+// rtl_433 writes one JSON object per line, for every device it hears,
+// and reads may split or join objects anywhere. FrameScanner keeps its
+// brace/string state across reads and copies each object's bytes once,
+// span by span, into a reused buffer. A complete object goes through a
+// text prefilter on "model" and "id"; only frames that pass it are
+// validated with json::accept, which builds no DOM. Sensors nobody asked
+// for cost one string search each.
+// ---------------------------------------------------------
+using Frame = std::shared_ptr<const std::string>;
+
+static void publish_frame(const std::string &model, long id, std::string &&obj);
+
+struct FrameScanner {
+    std::string obj;            // object being collected
+    int         depth   = 0;    // 0 = between objects
+    bool        in_str  = false;
+    bool        escaped = false;
+    bool        skip    = false; // oversized: drop until the object ends
+
+    void feed(const char *data, size_t len) {
+        size_t span = 0;        // start of the bytes not yet copied to obj
+        for (size_t i = 0; i < len; i++) {
+            char ch = data[i];
+
+            if (depth == 0) {
+                if (ch == '{') {
+                    depth = 1;
+                    span  = i;
+                    obj.clear();
+                    skip  = false;
+                }
+                continue;
+            }
+
+            if (ch == '\n') {
+                // Objects never span lines (JSON strings can't hold a raw
+                // newline either): this one was cut short
+                count(m_frames_truncated);
+                reset();
+                continue;
+            }
+
+            if (in_str) {
+                if (escaped)          escaped = false;
+                else if (ch == '\\')  escaped = true;
+                else if (ch == '"')   in_str  = false;
+                continue;
+            }
+
+            if (ch == '"') {
+                in_str = true;
+            } else if (ch == '{') {
+                depth++;
+            } else if (ch == '}') {
+                if (--depth == 0) {
+                    append(data + span, i + 1 - span);
+                    count(m_frames);
+                    if (skip)
+                        count(m_frames_oversized);
+                    else
+                        frame_complete();
+                }
+            }
+        }
+
+        if (depth > 0)
+            append(data + span, len - span);
+    }
+
+private:
+    void append(const char *p, size_t n) {
+        if (skip) return;
+        if (obj.size() + n > MAX_JSON_SIZE) {
+            skip = true;
+            obj.clear();
+            return;
+        }
+        obj.append(p, n);
+    }
+
+    void reset() {
+        depth   = 0;
+        in_str  = false;
+        escaped = false;
+        obj.clear();
+    }
+
+    void frame_complete() {
+        std::string model;
+        long id = 0;
+        bool wanted = frame_wanted(obj, model, id);
+        if (!wanted || !json::accept(obj)) {
+            count(wanted ? m_parse_failures : m_frames_filtered);
+            obj.clear();            // keeps its capacity for the next one
+            return;
+        }
+        publish_frame(model, id, std::move(obj));
+        obj = std::string();
+        obj.reserve(512);
+    }
+
+    // Value text following "key" : in obj, or nullptr
+    static const char *find_value(const std::string &s, const char *key) {
+        size_t klen = strlen(key);
+        size_t pos = 0;
+        while ((pos = s.find(key, pos)) != std::string::npos) {
+            const char *p = s.c_str() + pos + klen;
+            pos += klen;
+            while (*p == ' ' || *p == '\t') p++;
+            if (*p != ':') continue;        // the text was a value, not a key
+            p++;
+            while (*p == ' ' || *p == '\t') p++;
+            return p;
+        }
+        return nullptr;
+    }
+
+    // Match "model" against the allowed list, then a WS90's "id" against
+    // the id filter. Sets model (unquoted) and id (0 if not an integer).
+    static bool frame_wanted(const std::string &s, std::string &model, long &id) {
+        const char *m = find_value(s, "\"model\"");
+        if (!m || *m != '"')
+            return false;
+
+        if (!any_model) {
+            bool ok = false;
+            for (const std::string &f : filter_models) {
+                if (strncmp(m, f.c_str(), f.size()) == 0) { ok = true; break; }
+            }
+            if (!ok)
+                return false;
+        }
+
+        const char *end_q = strchr(m + 1, '"');
+        if (!end_q)
+            return false;
+        model.assign(m + 1, end_q - m - 1);
+
+        id = 0;
+        const char *v = find_value(s, "\"id\"");
+        if (v) {
+            char *end = nullptr;
+            long n = strtol(v, &end, 10);
+            if (end != v && *end != '.')
+                id = n;
+        }
+        return filter_ids.empty() || model != WS90_MODEL || filter_ids.count(id) != 0;
+    }
+};
+
+static FrameScanner scanner;
+
+// ---------------------------------------------------------
+// Station table
+//
+// Latest frame per (model, id), with simple receive statistics. rtl_433
+// repeats each transmission, so interval_sec (a moving average of the
+// gap between frames) sits below the sensor's real period.
 // ---------------------------------------------------------
+struct Station {
+    Frame  latest;
+    time_t first_seen   = 0;
+    time_t last_update  = 0;
+    unsigned long long frames = 0;
+    double interval_sec = 0.0;
+};
+
+using StationKey = std::pair<std::string, long>;   // model, id
+
+static std::map<StationKey, Station> stations;
+
+// Entry for key, evicting the longest-silent station when the table is full
+static Station &station_slot(const StationKey &key) {
+    auto it = stations.find(key);
+    if (it != stations.end())
+        return it->second;
+
+    if (stations.size() >= MAX_STATIONS) {
+        auto oldest = stations.begin();
+        for (auto s = stations.begin(); s != stations.end(); ++s)
+            if (s->second.last_update < oldest->second.last_update)
+                oldest = s;
+        stations.erase(oldest);
+    }
+    return stations[key];
+}
+
+static bool station_is_stale(const Station &st) {
+    return !st.latest || time(nullptr) - st.last_update > STALE_SECONDS;
+}
+
 static void process_fifo_bytes(const char *data, ssize_t len) {
-    static std::string buf;
+    count(m_fifo_reads);
+    count(m_fifo_bytes, (unsigned long long)len);
+    scanner.feed(data, (size_t)len);
+}
+
+// ---------------------------------------------------------
+// Push mode
+//
+// Each WS90 frame is POSTed to the backend over one keep-alive
+// connection, owned by a sender thread. The FIFO loop only drops the
+// newest frame into a mailbox with one slot per station id, so a slow or
+// dead backend can never stall rtl_433; frames that arrive mid-POST
+// coalesce to the latest one of each station.
+// ---------------------------------------------------------
+#define PUSH_IO_TIMEOUT_SEC 3
+#define PUSH_RETRY_SEC      2
+
+struct PushTarget {
+    std::string host;
+    std::string port  = "80";
+    std::string path  = "/ws90";
+    std::string token;          // sent as X-WS90-Token when set
+    std::string url;            // as given, for logging
+};
+
+static std::optional<PushTarget> push_target;
+
+static std::mutex              push_mu;
+static std::condition_variable push_cv;
+static std::map<long, Frame>   push_pending;     // by WS90 id, guarded by push_mu
+
+static void queue_push(long id, const Frame &obj) {
+    if (!push_target)
+        return;
+    {
+        std::lock_guard<std::mutex> lk(push_mu);
+        push_pending[id] = obj;
+    }
+    push_cv.notify_one();
+}
+
+// The frame is moved, not copied: the station table, the WS90 endpoint
+// and the push mailbox share one immutable string
+static void publish_frame(const std::string &model, long id, std::string &&obj) {
+    Frame f = std::make_shared<const std::string>(std::move(obj));
+    time_t now = time(nullptr);
+
+    Station &st = station_slot(StationKey(model, id));
+    if (st.frames == 0) {
+        st.first_seen = now;
+    } else {
+        double gap = (double)(now - st.last_update);
+        st.interval_sec = (st.frames == 1) ? gap : 0.8 * st.interval_sec + 0.2 * gap;
+    }
+    st.frames++;
+    st.latest      = f;
+    st.last_update = now;
+
+    // The backend only understands WS90 frames
+    if (model == WS90_MODEL) {
+        latest_json = f;
+        last_update = now;
+        queue_push(id, f);
+    }
+}
+
+// http://host[:port][/path]
+static bool parse_push_url(const char *url, PushTarget &t) {
+    const char *p = url;
+    if (strncmp(p, "http://", 7) != 0)
+        return false;
+    p += 7;
+
+    const char *slash = strchr(p, '/');
+    std::string hostport = slash ? std::string(p, slash - p) : std::string(p);
+    if (slash)
+        t.path = slash;
+
+    size_t colon = hostport.rfind(':');
+    if (colon != std::string::npos) {
+        t.host = hostport.substr(0, colon);
+        t.port = hostport.substr(colon + 1);
+    } else {
+        t.host = hostport;
+    }
 
-    buf.append(data, len);
-    if (buf.size() > MAX_JSON_SIZE * 4) {
-        buf.erase(0, buf.size() - MAX_JSON_SIZE);
+    t.url = url;
+    return !t.host.empty() && !t.port.empty();
+}
+
+static int push_connect(const PushTarget &t) {
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *res = nullptr;
+    int rc = getaddrinfo(t.host.c_str(), t.port.c_str(), &hints, &res);
+    if (rc != 0) {
+        std::fprintf(stderr, "push: resolve %s: %s\n", t.host.c_str(), gai_strerror(rc));
+        return -1;
     }
 
-    size_t start = 0;
-    while (true) {
-        size_t open = buf.find('{', start);
-        if (open == std::string::npos)
+    int fd = -1;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        timeval tv = {PUSH_IO_TIMEOUT_SEC, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
             break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
 
-        int depth = 0;
-        bool valid = false;
+    if (fd < 0)
+        std::fprintf(stderr, "push: connect %s:%s failed\n", t.host.c_str(), t.port.c_str());
+    return fd;
+}
 
-        for (size_t i = open; i < buf.size(); i++) {
-            if (buf[i] == '{') depth++;
-            if (buf[i] == '}') depth--;
+static bool send_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
 
-            if (depth == 0) {
-                size_t end = i + 1;
+// One POST on an open connection. Returns the HTTP status, or 0 if the
+// connection failed. keep_alive is cleared if the server is closing.
+static int push_post(int fd, const PushTarget &t, const std::string &body, bool &keep_alive) {
+    std::string req;
+    req.reserve(body.size() + 256);
+    req += "POST " + t.path + " HTTP/1.1\r\n";
+    req += "Host: " + t.host + ":" + t.port + "\r\n";
+    req += "Content-Type: application/json\r\n";
+    req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    if (!t.token.empty())
+        req += "X-WS90-Token: " + t.token + "\r\n";
+    req += "\r\n";
+    req += body;
 
-                std::string obj = buf.substr(open, end - open);
+    if (!send_all(fd, req.data(), req.size()))
+        return 0;
 
-                try {
-                    json j = json::parse(obj);
+    // Read the status line and headers, then drain any body
+    std::string resp;
+    size_t hdr_end = std::string::npos;
+    char tmp[1024];
+    while (hdr_end == std::string::npos) {
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0 || resp.size() > 16384)
+            return 0;
+        resp.append(tmp, n);
+        hdr_end = resp.find("\r\n\r\n");
+    }
 
-                    // Check for WS90 model
-                    if (!j.contains("model"))
-                        continue;
+    int status = 0;
+    if (sscanf(resp.c_str(), "HTTP/%*s %d", &status) != 1)
+        return 0;
 
-                    if (j["model"] != "Fineoffset-WS90")
-                        continue;
+    size_t content_len = 0;
+    keep_alive = true;
 
-                    // If ID filtering enabled
-                    if (filter_id.has_value()) {
-                        if (!j.contains("id"))
-                            continue;
-                        if (!j["id"].is_number_integer())
-                            continue;
-                        if ((int)j["id"] != *filter_id)
-                            continue;
-                    }
+    size_t pos = resp.find("\r\n");
+    while (pos < hdr_end) {
+        size_t next = resp.find("\r\n", pos + 2);
+        std::string line = resp.substr(pos + 2, next - pos - 2);
+        if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0)
+            content_len = (size_t)strtoul(line.c_str() + 15, nullptr, 10);
+        else if (strncasecmp(line.c_str(), "Connection:", 11) == 0 &&
+                 strcasestr(line.c_str() + 11, "close"))
+            keep_alive = false;
+        pos = next;
+    }
 
-                    latest_json = obj;
-                    have_json = true;
-                    last_update = time(nullptr);
+    size_t have = resp.size() - (hdr_end + 4);
+    while (have < content_len) {
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0)
+            return 0;
+        have += (size_t)n;
+    }
+
+    return status;
+}
+
+static void push_thread_func() {
+    const PushTarget &t = *push_target;
+    int fd = -1;
+
+    while (1) {
+        std::map<long, Frame> batch;
+        {
+            std::unique_lock<std::mutex> lk(push_mu);
+            push_cv.wait(lk, [] { return !push_pending.empty(); });
+            batch.swap(push_pending);
+        }
 
-                } catch (...) {
-                    // Ignore malformed JSON
+        for (const auto &kv : batch) {
+            const Frame &body = kv.second;
+
+            // A reused connection may have been closed by the server's idle
+            // timeout; retry once on a fresh one before giving up
+            int status = 0;
+            bool keep_alive = false;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int attempt = 0; attempt < 2 && status == 0; attempt++) {
+                if (fd < 0)
+                    fd = push_connect(t);
+                if (fd < 0)
+                    break;
+
+                status = push_post(fd, t, *body, keep_alive);
+                if (status == 0 || !keep_alive) {
+                    close(fd);
+                    fd = -1;
                 }
+            }
 
-                start = end;
-                valid = true;
+            if (status == 0) {
+                count(m_push_failures);
+            } else {
+                observe_push(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - t0).count());
+                count(status >= 200 && status <= 299 ? m_pushes : m_push_rejected);
+            }
+
+            if (status == 0) {
+                // Backend unreachable: back off; newer frames replace these
+                std::this_thread::sleep_for(std::chrono::seconds(PUSH_RETRY_SEC));
                 break;
+            } else if (status < 200 || status > 299) {
+                std::fprintf(stderr, "push: %s returned HTTP %d\n", t.url.c_str(), status);
             }
         }
-
-        if (!valid)
-            break; // Await more data
-    }
-
-    // Trim buffer to avoid infinite growth
-    if (start > 0 && start < buf.size()) {
-        buf.erase(0, start);
     }
 }
 
 // ---------------------------------------------------------
-static int read_fifo(int fd) {
+// Drain the FIFO. Returns false on EOF (all writers gone).
+// ---------------------------------------------------------
+static bool read_fifo(int fd) {
     char tmp[MAX_FIFO_CHUNK];
-    ssize_t n = read(fd, tmp, sizeof(tmp));
-    if (n > 0) {
-        process_fifo_bytes(tmp, n);
+    while (1) {
+        ssize_t n = read(fd, tmp, sizeof(tmp));
+        if (n > 0) {
+            process_fifo_bytes(tmp, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n != 0;          // EAGAIN: drained
     }
-    return n;
 }
 
 // ---------------------------------------------------------
 static bool data_is_stale() {
-    return (!have_json || time(nullptr) - last_update > STALE_SECONDS);
+    return (!latest_json || time(nullptr) - last_update > STALE_SECONDS);
+}
+
+// /stations: one entry per station in the table
+static std::string stations_json() {
+    time_t now = time(nullptr);
+    json list = json::array();
+    for (const auto &kv : stations) {
+        const Station &st = kv.second;
+        json e;
+        e["model"]        = kv.first.first;
+        e["id"]           = kv.first.second;
+        e["frames"]       = st.frames;
+        e["first_seen"]   = (long long)st.first_seen;
+        e["last_update"]  = (long long)st.last_update;
+        e["age_sec"]      = (long long)(now - st.last_update);
+        e["interval_sec"] = st.interval_sec;
+        e["stale"]        = station_is_stale(st);
+        e["path"]         = kv.first.first == WS90_MODEL
+                                ? "/ws90/" + std::to_string(kv.first.second)
+                                : "/stations/" + kv.first.first + "/" +
+                                  std::to_string(kv.first.second);
+        list.push_back(std::move(e));
+    }
+    json out;
+    out["stations"] = std::move(list);
+    return out.dump();
+}
+
+// /metrics: Prometheus text format 0.0.4
+static void metric(std::string &out, const char *name, const char *type,
+                   const char *help, unsigned long long v) {
+    out += std::string("# HELP ") + name + " " + help + "\n";
+    out += std::string("# TYPE ") + name + " " + type + "\n";
+    out += std::string(name) + " " + std::to_string(v) + "\n";
+}
+
+static std::string metrics_text() {
+    auto get = [](const Counter &c) { return c.load(std::memory_order_relaxed); };
+    std::string out;
+    out.reserve(4096);
+
+    metric(out, "ws90_fifo_bytes_total", "counter", "Bytes read from the FIFO", get(m_fifo_bytes));
+    metric(out, "ws90_fifo_reads_total", "counter", "read() calls that returned data", get(m_fifo_reads));
+    metric(out, "ws90_frames_total", "counter", "Complete JSON objects seen on the FIFO", get(m_frames));
+    metric(out, "ws90_frames_filtered_total", "counter",
+           "Frames dropped by the --model/--id filter", get(m_frames_filtered));
+    metric(out, "ws90_parse_failures_total", "counter",
+           "Wanted frames that were not valid JSON", get(m_parse_failures));
+    metric(out, "ws90_frames_truncated_total", "counter",
+           "Objects cut short by a newline", get(m_frames_truncated));
+    metric(out, "ws90_frames_oversized_total", "counter",
+           "Objects dropped for exceeding MAX_JSON_SIZE", get(m_frames_oversized));
+    metric(out, "ws90_push_total", "counter", "Frames pushed and answered 2xx", get(m_pushes));
+    metric(out, "ws90_push_rejected_total", "counter",
+           "Frames pushed and answered with another status", get(m_push_rejected));
+    metric(out, "ws90_push_failures_total", "counter",
+           "Push attempts that could not reach the backend", get(m_push_failures));
+
+    out += "# HELP ws90_push_duration_seconds Time of one answered push\n";
+    out += "# TYPE ws90_push_duration_seconds histogram\n";
+    unsigned long long cum = 0;
+    char le[32];
+    for (size_t i = 0; i <= PUSH_NBOUNDS; i++) {
+        cum += get(m_push_buckets[i]);
+        if (i < PUSH_NBOUNDS) snprintf(le, sizeof(le), "%g", PUSH_BOUNDS_SEC[i]);
+        else                  snprintf(le, sizeof(le), "+Inf");
+        out += std::string("ws90_push_duration_seconds_bucket{le=\"") + le + "\"} " +
+               std::to_string(cum) + "\n";
+    }
+    snprintf(le, sizeof(le), "%.6f", (double)get(m_push_sum_us) / 1e6);
+    out += std::string("ws90_push_duration_seconds_sum ") + le + "\n";
+    out += "ws90_push_duration_seconds_count " + std::to_string(cum) + "\n";
+
+    time_t now = time(nullptr);
+    out += "# HELP ws90_station_frames_total Frames published per station\n";
+    out += "# TYPE ws90_station_frames_total counter\n";
+    for (const auto &kv : stations) {
+        out += "ws90_station_frames_total{model=\"" + kv.first.first + "\",id=\"" +
+               std::to_string(kv.first.second) + "\"} " + std::to_string(kv.second.frames) + "\n";
+    }
+    out += "# HELP ws90_station_age_seconds Seconds since the station's last frame\n";
+    out += "# TYPE ws90_station_age_seconds gauge\n";
+    for (const auto &kv : stations) {
+        out += "ws90_station_age_seconds{model=\"" + kv.first.first + "\",id=\"" +
+               std::to_string(kv.first.second) + "\"} " +
+               std::to_string((long long)(now - kv.second.last_update)) + "\n";
+    }
+    out += "# HELP ws90_stations Stations in the table\n";
+    out += "# TYPE ws90_stations gauge\n";
+    out += "ws90_stations " + std::to_string(stations.size()) + "\n";
+    return out;
 }
 
 // ---------------------------------------------------------
-// Handle HTTP request
+// HTTP clients
+//
+// Every client socket is non-blocking and driven by the epoll loop:
+// bytes are read as they arrive until the header block is complete,
+// the whole response is built in memory and written as the socket
+// accepts it. A slow or stuck client only holds its own buffer and can
+// never delay FIFO draining. Connections are kept alive (HTTP/1.1
+// default) so the backend poller can reuse one socket.
 // ---------------------------------------------------------
-static void handle_http(int client) {
-    char req[512] = {0};
-    read(client, req, sizeof(req) - 1);
-
-    char method[8], path[256];
-    if (sscanf(req, "%7s %255s", method, path) != 2) {
-        send_json_response(client, 400, "Bad Request",
-            "{\"error\":\"bad_request\",\"message\":\"Unable to parse request\"}");
-        return;
+#define MAX_CLIENTS       64
+#define MAX_REQUEST_SIZE  4096
+#define CLIENT_IDLE_SEC   30
+
+struct Client {
+    std::string in;
+    std::string out;
+    size_t      out_off    = 0;
+    bool        keep_alive = true;
+    time_t      last_io    = 0;
+};
+
+static std::map<int, Client> clients;
+
+static std::string json_response(int code, const char *reason,
+                                 const std::string &body, bool keep_alive,
+                                 const char *content_type = "application/json") {
+    bool nl = body.empty() || body.back() != '\n';
+    std::string r;
+    r.reserve(body.size() + 180);
+    r += "HTTP/1.1 " + std::to_string(code) + " " + reason + "\r\n";
+    r += "Access-Control-Allow-Origin: *\r\n";
+    r += std::string("Content-Type: ") + content_type + "\r\n";
+    r += "Content-Length: " + std::to_string(body.size() + (nl ? 1 : 0)) + "\r\n";
+    r += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    r += body;
+    if (nl)
+        r += "\n";
+    return r;
+}
+
+// Build the response to one complete request head. keep_alive comes in
+// as the client's preference and may be cleared.
+static std::string handle_http(const std::string &head, bool &keep_alive) {
+    char method[8], path[256], version[16] = "";
+    if (sscanf(head.c_str(), "%7s %255s %15s", method, path, version) < 2) {
+        keep_alive = false;
+        return json_response(400, "Bad Request",
+            "{\"error\":\"bad_request\",\"message\":\"Unable to parse request\"}", false);
+    }
+
+    // HTTP/1.1 keeps the connection unless told otherwise; 1.0 the reverse
+    keep_alive = (strcmp(version, "HTTP/1.1") == 0);
+    size_t pos = head.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < head.size()) {
+        size_t next = head.find("\r\n", pos + 2);
+        std::string line = head.substr(pos + 2, next == std::string::npos ? std::string::npos
+                                                                          : next - pos - 2);
+        if (strncasecmp(line.c_str(), "Connection:", 11) == 0) {
+            if (strcasestr(line.c_str() + 11, "close"))
+                keep_alive = false;
+            else if (strcasestr(line.c_str() + 11, "keep-alive"))
+                keep_alive = true;
+        }
+        pos = next;
     }
 
     if (strcmp(method, "GET") != 0) {
-        send_json_response(client, 405, "Method Not Allowed",
-            "{\"error\":\"method_not_allowed\",\"message\":\"Only GET is supported\"}");
-        return;
+        // Any request body is not read, so the connection can't continue
+        keep_alive = false;
+        return json_response(405, "Method Not Allowed",
+            "{\"error\":\"method_not_allowed\",\"message\":\"Only GET is supported\"}", false);
     }
 
-    if (!(strcmp(path, "/") == 0 || strcmp(path, "/ws90") == 0)) {
-        send_json_response(client, 404, "Not Found",
-            "{\"error\":\"not_found\",\"message\":\"Unknown endpoint\"}");
-        return;
+    if (strcmp(path, "/stations") == 0)
+        return json_response(200, "OK", stations_json(), keep_alive);
+
+    if (strcmp(path, "/metrics") == 0)
+        return json_response(200, "OK", metrics_text(), keep_alive,
+                             "text/plain; version=0.0.4");
+
+    // /ws90/<id> and /stations/<model>/<id>
+    const Station *st = nullptr;
+    std::string model = WS90_MODEL;
+    const char *id_text = nullptr;
+    if (strncmp(path, "/ws90/", 6) == 0) {
+        id_text = path + 6;
+    } else if (strncmp(path, "/stations/", 10) == 0) {
+        const char *slash = strrchr(path + 10, '/');
+        if (slash) {
+            model.assign(path + 10, slash - path - 10);
+            id_text = slash + 1;
+        }
     }
 
-    if (!have_json) {
-        send_json_response(client, 503, "Service Unavailable",
-            "{\"error\":\"no_data\",\"message\":\"WS90 data not yet available\"}");
-        return;
+    if (id_text) {
+        char *end = nullptr;
+        long id = strtol(id_text, &end, 10);
+        auto it = (end != id_text && *end == '\0')
+                      ? stations.find(StationKey(model, id)) : stations.end();
+        if (it == stations.end()) {
+            return json_response(404, "Not Found",
+                "{\"error\":\"unknown_station\",\"message\":\"No frames from this station\"}",
+                keep_alive);
+        }
+        st = &it->second;
+    } else if (!(strcmp(path, "/") == 0 || strcmp(path, "/ws90") == 0)) {
+        return json_response(404, "Not Found",
+            "{\"error\":\"not_found\",\"message\":\"Unknown endpoint\"}", keep_alive);
+    }
+
+    if (st) {
+        if (station_is_stale(*st)) {
+            return json_response(503, "Service Unavailable",
+                "{\"error\":\"stale_data\",\"message\":\"Station data is stale\"}", keep_alive);
+        }
+        return json_response(200, "OK", *st->latest, keep_alive);
+    }
+
+    // Plain / and /ws90 serve the newest WS90 frame, whichever id
+    if (!latest_json) {
+        return json_response(503, "Service Unavailable",
+            "{\"error\":\"no_data\",\"message\":\"WS90 data not yet available\"}", keep_alive);
     }
 
     if (data_is_stale()) {
-        send_json_response(client, 503, "Service Unavailable",
-            "{\"error\":\"stale_data\",\"message\":\"WS90 data is stale\"}");
+        return json_response(503, "Service Unavailable",
+            "{\"error\":\"stale_data\",\"message\":\"WS90 data is stale\"}", keep_alive);
+    }
+
+    return json_response(200, "OK", *latest_json, keep_alive);
+}
+
+static void close_client(int ep, int fd) {
+    epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+static void watch_client(int ep, int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events  = events;
+    ev.data.fd = fd;
+    epoll_ctl(ep, EPOLL_CTL_MOD, fd, &ev);
+}
+
+// If a full request head is buffered and nothing is being sent, answer it
+static void serve_next(int ep, int fd, Client &c) {
+    if (c.out_off < c.out.size())
+        return;
+
+    size_t end = c.in.find("\r\n\r\n");
+    if (end == std::string::npos)
         return;
+
+    std::string head = c.in.substr(0, end);
+    c.in.erase(0, end + 4);
+
+    c.out     = handle_http(head, c.keep_alive);
+    c.out_off = 0;
+    watch_client(ep, fd, EPOLLIN | EPOLLOUT);
+}
+
+// Returns false once the client is closed
+static bool client_write(int ep, int fd, Client &c) {
+    while (c.out_off < c.out.size()) {
+        ssize_t n = send(fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out_off += (size_t)n;
+            c.last_io  = time(nullptr);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;        // wait for EPOLLOUT
+        close_client(ep, fd);
+        return false;
     }
 
-    send_json_response(client, 200, "OK", latest_json);
+    // Response fully sent
+    c.out.clear();
+    c.out_off = 0;
+    if (!c.keep_alive) {
+        close_client(ep, fd);
+        return false;
+    }
+    watch_client(ep, fd, EPOLLIN);
+    serve_next(ep, fd, c);      // a pipelined request may already be here
+    return true;
+}
+
+static void client_read(int ep, int fd, Client &c) {
+    char tmp[1024];
+    bool eof = false;
+    while (1) {
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n > 0) {
+            c.in.append(tmp, (size_t)n);
+            c.last_io = time(nullptr);
+            if (c.in.size() > MAX_REQUEST_SIZE) {
+                close_client(ep, fd);
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n == 0) {
+            eof = true;         // half-closed: still answer what was sent
+            break;
+        }
+        close_client(ep, fd);
+        return;
+    }
+
+    serve_next(ep, fd, c);
+    if (eof) {
+        if (c.out_off >= c.out.size()) {
+            close_client(ep, fd);
+            return;
+        }
+        c.keep_alive = false;
+    }
+    if (c.out_off < c.out.size())
+        client_write(ep, fd, c);
+}
+
+static void accept_clients(int ep, int server) {
+    while (1) {
+        int fd = accept4(server, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            return;             // EAGAIN: backlog empty
+        }
+
+        if (clients.size() >= MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        clients[fd].last_io = time(nullptr);
+    }
 }
 
+// Close clients idle past CLIENT_IDLE_SEC. Returns the epoll timeout
+// (ms) until the next one would expire, or -1 with no clients.
+static int reap_idle_clients(int ep) {
+    if (clients.empty())
+        return -1;
+
+    time_t now  = time(nullptr);
+    time_t next = CLIENT_IDLE_SEC;
+    for (auto it = clients.begin(); it != clients.end(); ) {
+        time_t idle = now - it->second.last_io;
+        int fd = it->first;
+        ++it;
+        if (idle >= CLIENT_IDLE_SEC)
+            close_client(ep, fd);
+        else if (CLIENT_IDLE_SEC - idle < next)
+            next = CLIENT_IDLE_SEC - idle;
+    }
+    return clients.empty() ? -1 : (int)next * 1000;
+}
+
+// Everything above is also compiled into bench/ws90_replay.cpp, which
+// supplies its own main
+#ifndef WS90_API_NO_MAIN
+
 // ---------------------------------------------------------
 // Usage helper
 // ---------------------------------------------------------
 static void print_usage(const char *prog) {
     std::fprintf(stderr,
         "Usage:\n"
-        "  %s                 # promiscuous WS90 mode\n"
-        "  %s --id <station>  # filter for specific WS90 id\n",
-        prog, prog);
+        "  %s [--id <station>]... [--model <name>]... [--push <url> [--push-token <token>]]\n"
+        "\n"
+        "  --id <station>        keep only this WS90 id; repeat for several\n"
+        "                        (default: every WS90)\n"
+        "  --model <name>        also keep this rtl_433 model (" WS90_MODEL "\n"
+        "                        is always kept); repeat for several, 'any' for all\n"
+        "  --push <url>          also POST each frame to url, e.g.\n"
+        "                        http://172.17.0.1:8889/ws90\n"
+        "  --push-token <token>  sent as X-WS90-Token with each push\n",
+        prog);
 }
 
 // ---------------------------------------------------------
@@ -266,26 +1021,57 @@ int main(int argc, char **argv) {
     signal(SIGPIPE, SIG_IGN);
 
     // --- argument parsing ---
-    if (argc == 1) {
-        // promiscuous mode, no filter_id
-    } else if (argc == 3 && std::strcmp(argv[1], "--id") == 0) {
-        char *end = nullptr;
-        long val = std::strtol(argv[2], &end, 10);
-        if (*end != '\0' || val <= 0 || val > INT32_MAX) {
-            std::fprintf(stderr, "Invalid station id: %s\n", argv[2]);
+    // no --id: promiscuous mode, every WS90 id
+    const char *push_token = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--id") == 0 && i + 1 < argc) {
+            const char *arg = argv[++i];
+            char *end = nullptr;
+            long val = std::strtol(arg, &end, 10);
+            if (*end != '\0' || val <= 0 || val > INT32_MAX) {
+                std::fprintf(stderr, "Invalid station id: %s\n", arg);
+                print_usage(argv[0]);
+                return 1;
+            }
+            filter_ids.insert(val);
+            std::cout << "Filtering WS90 ID = " << val << "\n";
+        } else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            const char *arg = argv[++i];
+            if (std::strcmp(arg, "any") == 0)
+                any_model = true;
+            else
+                filter_models.push_back(std::string("\"") + arg + "\"");
+        } else if (std::strcmp(argv[i], "--push") == 0 && i + 1 < argc) {
+            PushTarget t;
+            if (!parse_push_url(argv[++i], t)) {
+                std::fprintf(stderr, "Invalid push url: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            push_target = t;
+        } else if (std::strcmp(argv[i], "--push-token") == 0 && i + 1 < argc) {
+            push_token = argv[++i];
+        } else {
             print_usage(argv[0]);
             return 1;
         }
-        filter_id = (int)val;
-        std::cout << "Filtering WS90 ID = " << *filter_id << "\n";
-    } else {
-        print_usage(argv[0]);
-        return 1;
+    }
+
+    if (!any_model) {
+        for (const std::string &m : filter_models)
+            std::cout << "Keeping model " << m << "\n";
+    }
+
+    if (push_target) {
+        if (push_token)
+            push_target->token = push_token;
+        std::cout << "Pushing WS90 frames to " << push_target->url << "\n";
+        std::thread(push_thread_func).detach();
     }
 
     int fifo_fd = setup_fifo();
 
-    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int server = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server < 0) {
         perror("socket");
         return 1;
@@ -308,32 +1094,68 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = fifo_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, fifo_fd, &ev);
+    ev.data.fd = server;
+    epoll_ctl(ep, EPOLL_CTL_ADD, server, &ev);
+
     std::cout << "WS90 API running on port " << HTTP_PORT
               << " FIFO=" << FIFO_PATH << "\n";
 
+    // Sleeps until the FIFO or a socket has work: no timer while idle
+    // (only to expire idle keep-alive clients when there are any)
+    epoll_event events[32];
+    int timeout_ms = -1;
+
     while (1) {
-        // Read FIFO
-        int n = read_fifo(fifo_fd);
-        if (n == 0) {
-            close(fifo_fd);
-            fifo_fd = open(FIFO_PATH, O_RDONLY | O_NONBLOCK);
+        int n = epoll_wait(ep, events, 32, timeout_ms);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return 1;
         }
 
-        // HTTP
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(server, &fds);
-
-        timeval tv = {0, 200000};
-        int r = select(server + 1, &fds, nullptr, nullptr, &tv);
-        if (r > 0 && FD_ISSET(server, &fds)) {
-            int client = accept(server, nullptr, nullptr);
-            if (client >= 0) {
-                handle_http(client);
-                close(client);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == fifo_fd) {
+                if (!read_fifo(fifo_fd)) {
+                    // All writers gone: reopen so rtl_433 can reconnect
+                    epoll_ctl(ep, EPOLL_CTL_DEL, fifo_fd, nullptr);
+                    close(fifo_fd);
+                    fifo_fd = open(FIFO_PATH, O_RDONLY | O_NONBLOCK);
+                    ev.events  = EPOLLIN;
+                    ev.data.fd = fifo_fd;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, fifo_fd, &ev);
+                }
+            } else if (fd == server) {
+                accept_clients(ep, server);
+            } else {
+                auto it = clients.find(fd);
+                if (it == clients.end())
+                    continue;
+                uint32_t e = events[i].events;
+                if (e & (EPOLLERR | EPOLLHUP)) {
+                    close_client(ep, fd);
+                } else if (e & EPOLLIN) {
+                    client_read(ep, fd, it->second);
+                } else if (e & EPOLLOUT) {
+                    client_write(ep, fd, it->second);
+                }
             }
         }
+
+        timeout_ms = reap_idle_clients(ep);
     }
 
     return 0;
 }
+
+#endif // WS90_API_NO_MAIN